@@ -0,0 +1,117 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "BatchSimulator.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "WorkStealingPool.h"
+
+namespace
+{
+	//player decisions come from their own family of streams so they never correlate with the sequence
+	constexpr uint64_t PLAYER_STREAM_SALT = 0x5DEECE66Dull;
+
+	//uniform in [0, 1)
+	[[nodiscard]]
+	float UnitFloat(uint64_t value) noexcept
+	{
+		return (float)(value >> 40) * (1.0f / (1 << 24));
+	}
+}
+
+void SimulationStats::Add(const GameResult& result) noexcept
+{
+	games++;
+	totalScore += result.score;
+	totalDuration += result.duration;
+	maxScore = std::max(maxScore, result.score);
+	scoreHistogram[std::min(result.score, SCORE_HISTOGRAM_SIZE - 1)]++;
+}
+
+void SimulationStats::Merge(const SimulationStats& other) noexcept
+{
+	games += other.games;
+	totalScore += other.totalScore;
+	totalDuration += other.totalDuration;
+	maxScore = std::max(maxScore, other.maxScore);
+
+	for (int i = 0; i < SCORE_HISTOGRAM_SIZE; i++)
+		scoreHistogram[i] += other.scoreHistogram[i];
+}
+
+int SimulationStats::ScorePercentile(double fraction) const noexcept
+{
+	const uint64_t target = (uint64_t)(games * fraction);
+	uint64_t seen = 0;
+
+	for (int i = 0; i < SCORE_HISTOGRAM_SIZE; i++)
+	{
+		seen += scoreHistogram[i];
+		if (seen > target)
+			return i;
+	}
+	return SCORE_HISTOGRAM_SIZE - 1;
+}
+
+GameResult SimulateGame(const GameTimings& timings, int64_t frequency, const PlayerModel& player, uint64_t seed, uint64_t gameIndex) noexcept
+{
+	GameCore game(timings, 0, SplitMix64(seed + gameIndex));
+
+	const CounterRng decisions = CounterRng::ForStream(seed ^ PLAYER_STREAM_SALT, gameIndex);
+	uint64_t decisionIndex = 0;
+
+	const float litSeconds = (float)timings.ButtonLitTicks / frequency;
+	const float litPenalty = std::max(1.0f, player.comfortableLitSeconds / std::max(litSeconds, 1e-3f));
+
+	int64_t now = 0;
+	game.StartGame(now);
+
+	while (true)
+	{
+		if (game.gameState != GAME_STATE_INPUT || game.bOutstandingTimer)
+		{
+			now = game.NextDeadline();
+			game.Tick(now, {});
+			continue;
+		}
+
+		const float reaction = player.reactionSeconds + player.reactionJitterSeconds * (UnitFloat(decisions(decisionIndex++)) * 2 - 1);
+		now += std::max((int64_t)(reaction * frequency), (int64_t)1);
+
+		const float mistakeChance = (player.mistakeChance + player.mistakeChancePerStep * game.playbackLength) * litPenalty;
+		const int expected = game.ButtonAt(game.playbackLocation);
+		const bool bMistake = UnitFloat(decisions(decisionIndex++)) < mistakeChance;
+
+		const int score = game.Score();
+
+		if (bMistake)
+			return { .score = score, .duration = now };
+
+		game.Tick(now, { .hoveredButton = expected, .clicked = true });
+
+		if (game.Score() >= player.maxScore)
+			return { .score = game.Score(), .duration = now };
+	}
+}
+
+SimulationStats SimulateGames(WorkStealingPool& pool, const GameTimings& timings, int64_t frequency, const PlayerModel& player, uint64_t seed, uint32_t gameCount) noexcept
+{
+	std::vector<SimulationStats> workerStats(pool.ThreadCount());
+
+	pool.ParallelFor(gameCount, 256, [&](uint32_t begin, uint32_t end, uint32_t worker)
+		{
+			SimulationStats& stats = workerStats[worker];
+			for (uint32_t i = begin; i < end; i++)
+				stats.Add(SimulateGame(timings, frequency, player, seed, i));
+		});
+
+	SimulationStats total;
+	for (const SimulationStats& stats : workerStats)
+		total.Merge(stats);
+	return total;
+}
@@ -0,0 +1,64 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "SimonCore.h"
+
+class WorkStealingPool;
+
+//headless games that jump from deadline to deadline instead of waiting for repaints
+
+constexpr int SCORE_HISTOGRAM_SIZE = 64;
+
+//probabilistic player, a mistake chance of 0 with no length penalty is a scripted perfect player
+struct PlayerModel
+{
+	//chance of pressing a wrong button on any step
+	float mistakeChance = .005f;
+	//added to mistakeChance for every step already in the sequence
+	float mistakeChancePerStep = .002f;
+	//mistakes scale with how much shorter a button is lit than this
+	float comfortableLitSeconds = .4f;
+	float reactionSeconds = .35f;
+	float reactionJitterSeconds = .15f;
+	//a game that reaches this score counts as won and stops
+	int maxScore = 1000;
+};
+
+struct GameResult
+{
+	int score;
+	//simulated clock ticks from pressing play to the final press
+	int64_t duration;
+};
+
+struct alignas(CACHE_LINE_SIZE) SimulationStats
+{
+	uint64_t games = 0;
+	uint64_t totalScore = 0;
+	int64_t totalDuration = 0;
+	int maxScore = 0;
+	//the last bucket also counts every higher score
+	uint64_t scoreHistogram[SCORE_HISTOGRAM_SIZE] = {};
+
+	void Add(const GameResult& result) noexcept;
+	void Merge(const SimulationStats& other) noexcept;
+
+	//score below which the given fraction of games ended
+	[[nodiscard]]
+	int ScorePercentile(double fraction) const noexcept;
+};
+
+//one game, fully determined by (seed, gameIndex)
+[[nodiscard]]
+GameResult SimulateGame(const GameTimings& timings, int64_t frequency, const PlayerModel& player, uint64_t seed, uint64_t gameIndex) noexcept;
+
+//games [0, gameCount) spread over the pool, every worker fills its own stats and they are merged at the end
+[[nodiscard]]
+SimulationStats SimulateGames(WorkStealingPool& pool, const GameTimings& timings, int64_t frequency, const PlayerModel& player, uint64_t seed, uint32_t gameCount) noexcept;
@@ -0,0 +1,496 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "BoardGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+BoardLayout BoardLayout::FromClientSize(float windowWidth, float windowHeight) noexcept
+{
+	const float left = .205f / 2 * windowWidth;
+	const float top = (.1f / .8f) * windowHeight;
+	const float right = windowWidth - .205f / 2 * windowWidth;
+
+	const float boardWidth = right - left;
+	const float fullRadius = boardWidth / 2;
+	const float innerCircleRadius = boardWidth * .2f;
+	const float outerRimRadius = fullRadius - innerCircleRadius;
+
+	return
+	{
+		.left = left,
+		.top = top,
+		.boardWidth = boardWidth,
+		.fullRadius = fullRadius,
+		.innerCircleRadius = innerCircleRadius,
+		.lateralMargin = outerRimRadius * .05f,
+		.centerX = left + fullRadius,
+		.centerY = top + fullRadius
+	};
+}
+
+namespace
+{
+	//function(std::integral_constant<size_t, i>()) for every i in [0, Count), unrolled at compile time
+	template <size_t Count, typename Function>
+	inline void Unroll(Function&& function) noexcept
+	{
+		[&]<size_t... I>(std::index_sequence<I...>)
+		{
+			(function(std::integral_constant<size_t, I>()), ...);
+		}(std::make_index_sequence<Count>());
+	}
+}
+
+template <int PanelCount>
+WedgeOutline Board<PanelCount>::BuildWedgeOutline(const BoardLayout& layout, int panel) noexcept
+{
+	float radii[(size_t)WedgeRadius::Count];
+	radii[(size_t)WedgeRadius::Full] = layout.fullRadius;
+	radii[(size_t)WedgeRadius::FullInset] = layout.fullRadius - layout.lateralMargin;
+	radii[(size_t)WedgeRadius::FullBulge] = layout.fullRadius * FULL_BULGE;
+	radii[(size_t)WedgeRadius::Inner] = layout.innerCircleRadius;
+	radii[(size_t)WedgeRadius::InnerInset] = layout.innerCircleRadius + layout.lateralMargin;
+	radii[(size_t)WedgeRadius::InnerBulge] = layout.innerCircleRadius * INNER_BULGE;
+
+	//the directions were turned to each panel at compile time
+	const std::array<Point2, WEDGE_CONTROL_POINT_COUNT>& directions = PANEL_DIRECTIONS[panel];
+
+	Point2 points[WEDGE_CONTROL_POINT_COUNT];
+
+	for (size_t i = 0; i < WEDGE_CONTROL_POINT_COUNT; i++)
+	{
+		const Point2 direction = directions[i];
+		const float radius = radii[(size_t)CONTROL_POINTS[i].radius];
+
+		points[i] =
+		{
+			.x = layout.centerX + direction.x * radius,
+			.y = layout.centerY + direction.y * radius
+		};
+	}
+
+	WedgeOutline outline;
+	outline.start = points[0];
+	for (int i = 0; i < WEDGE_SEGMENT_COUNT; i++)
+	{
+		outline.segments[i] =
+		{
+			.point1 = points[1 + i * 3],
+			.point2 = points[2 + i * 3],
+			.point3 = points[3 + i * 3]
+		};
+	}
+
+	return outline;
+}
+
+WedgeOutline BuildWedgeOutline(const BoardLayout& layout, int button) noexcept
+{
+	return Board<BUTTON_COUNT>::BuildWedgeOutline(layout, button);
+}
+
+namespace
+{
+	//the rim beziers bulge slightly past their nominal radius, by about this much halfway along,
+	//on every board since Board<> matches each rim's bulge to the four panel one
+	constexpr float OUTER_RIM_BULGE = 1.003f;
+	constexpr float INNER_RIM_BULGE = 1.01f;
+
+	//half plane a * along + b * distance > c
+	struct EdgeLine
+	{
+		float a;
+		float b;
+		float c;
+
+		//points to the right of from -> to are inside
+		[[nodiscard]]
+		static EdgeLine Through(Point2 from, Point2 to) noexcept
+		{
+			const float a = to.y - from.y;
+			const float b = from.x - to.x;
+			return { .a = a, .b = b, .c = a * from.x + b * from.y };
+		}
+	};
+
+	//wedge corners folded onto one side: x is the distance along the nearest boundary, y the distance from it
+	[[nodiscard]]
+	inline Point2 FoldedCorner(const Point2& unitCorner, float radius) noexcept
+	{
+		return { .x = radius * unitCorner.x, .y = radius * unitCorner.y };
+	}
+
+	[[nodiscard]]
+	constexpr Point2 UnitCorner(double degrees) noexcept
+	{
+		const Point2 direction = WedgeDirection(degrees);
+		return { .x = -direction.y, .y = -direction.x };
+	}
+
+	constexpr Point2 unitOuterBevel = UnitCorner(OUTER_SLICE_MARGIN + OUTER_CIRCLE_BEVEL);
+	constexpr Point2 unitOuterEdge = UnitCorner(OUTER_SLICE_MARGIN);
+	constexpr Point2 unitInnerEdge = UnitCorner(INNER_SLICE_MARGIN);
+	constexpr Point2 unitInnerBevel = UnitCorner(INNER_SLICE_MARGIN + INNER_CIRCLE_BEVEL);
+
+	//a point is inside a wedge when its radius is between the rims and its distance from
+	//the nearest boundary clears the gap between wedges. the gap edge is the straight line from
+	//OUTER_SLICE_MARGIN on the outer rim to INNER_SLICE_MARGIN on the inner rim, and the
+	//bevels at both ends of it are cut off with one more line each
+	//none of it depends on the panel count, the margins are measured from the boundary
+	struct HitParameters
+	{
+		float centerX;
+		float centerY;
+		float innerRadius2;
+		float outerRadius2;
+		EdgeLine edges[3];
+
+		explicit HitParameters(const BoardLayout& layout) noexcept
+		{
+			const Point2 outerBevel = FoldedCorner(unitOuterBevel, layout.fullRadius);
+			const Point2 outerEdge = FoldedCorner(unitOuterEdge, layout.fullRadius - layout.lateralMargin);
+			const Point2 innerEdge = FoldedCorner(unitInnerEdge, layout.innerCircleRadius + layout.lateralMargin);
+			const Point2 innerBevel = FoldedCorner(unitInnerBevel, layout.innerCircleRadius);
+
+			centerX = layout.centerX;
+			centerY = layout.centerY;
+			innerRadius2 = layout.innerCircleRadius * INNER_RIM_BULGE * layout.innerCircleRadius * INNER_RIM_BULGE;
+			outerRadius2 = layout.fullRadius * OUTER_RIM_BULGE * layout.fullRadius * OUTER_RIM_BULGE;
+			edges[0] = EdgeLine::Through(outerBevel, outerEdge);
+			edges[1] = EdgeLine::Through(outerEdge, innerEdge);
+			edges[2] = EdgeLine::Through(innerEdge, innerBevel);
+		}
+	};
+
+	template <int PanelCount>
+	[[nodiscard]]
+	inline int HitTestPanel(const HitParameters& hit, float x, float y) noexcept
+	{
+		using Panels = Board<PanelCount>;
+
+		const float dx = x - hit.centerX;
+		const float dy = y - hit.centerY;
+		const float radius2 = dx * dx + dy * dy;
+
+		if (radius2 <= hit.innerRadius2 || radius2 >= hit.outerRadius2)
+			return NO_BUTTON;
+
+		float along;
+		float distance;
+		int panel;
+
+		if constexpr (PanelCount == 4)
+		{
+			//the boundaries are the axes, so folding is abs, min and max
+			along = std::max(fabsf(dx), fabsf(dy));
+			distance = std::min(fabsf(dx), fabsf(dy));
+
+			//0 is the upper left quadrant, counting counterclockwise
+			const int down = dy >= 0;
+			panel = dx < 0 ? down : 3 - down;
+		}
+		else
+		{
+			//how far counterclockwise of each boundary the point is, its panel is the one it is
+			//past the start of and short of the end of, folded onto the nearer of the two
+			float across[PanelCount];
+			Unroll<PanelCount>([&](auto j)
+				{
+					across[j] = dx * Panels::BOUNDARY_NORMALS[j].x + dy * Panels::BOUNDARY_NORMALS[j].y;
+				});
+
+			along = 0;
+			distance = 0;
+			panel = 0;
+			Unroll<PanelCount>([&](auto k)
+				{
+					constexpr size_t next = (k + 1) % PanelCount;
+					if (across[k] >= 0 && across[next] < 0)
+					{
+						const bool bNearStart = across[k] < -across[next];
+						const Point2 boundary = bNearStart ? Panels::BOUNDARY_DIRECTIONS[k] : Panels::BOUNDARY_DIRECTIONS[next];
+						along = dx * boundary.x + dy * boundary.y;
+						distance = bNearStart ? across[k] : -across[next];
+						panel = (int)k;
+					}
+				});
+		}
+
+		for (const EdgeLine& edge : hit.edges)
+		{
+			if (edge.a * along + edge.b * distance <= edge.c)
+				return NO_BUTTON;
+		}
+
+		return panel;
+	}
+}
+
+template <int PanelCount>
+int Board<PanelCount>::HitTest(const BoardLayout& layout, float x, float y) noexcept
+{
+	return HitTestPanel<PanelCount>(HitParameters(layout), x, y);
+}
+
+template <int PanelCount>
+void Board<PanelCount>::HitTestBatch(const BoardLayout& layout, const float* x, const float* y, uint8_t* panels, size_t count) noexcept
+{
+	const HitParameters hit(layout);
+
+	size_t i = 0;
+
+#if defined(__AVX2__)
+	const __m256 centerX = _mm256_set1_ps(hit.centerX);
+	const __m256 centerY = _mm256_set1_ps(hit.centerY);
+	const __m256 innerRadius2 = _mm256_set1_ps(hit.innerRadius2);
+	const __m256 outerRadius2 = _mm256_set1_ps(hit.outerRadius2);
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256i three = _mm256_set1_epi32(3);
+	const __m256i noButton = _mm256_set1_epi32(NO_BUTTON);
+
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), centerX);
+		const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), centerY);
+		const __m256 radius2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+
+		__m256 along;
+		__m256 distance;
+		__m256i panel;
+
+		if constexpr (PanelCount == 4)
+		{
+			const __m256 absX = _mm256_and_ps(dx, absMask);
+			const __m256 absY = _mm256_and_ps(dy, absMask);
+			along = _mm256_max_ps(absX, absY);
+			distance = _mm256_min_ps(absX, absY);
+
+			//all ones lanes are -1, so subtracting the mask adds one
+			const __m256i down = _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_castps_si256(_mm256_cmp_ps(dy, zero, _CMP_GE_OQ)));
+			const __m256i left = _mm256_castps_si256(_mm256_cmp_ps(dx, zero, _CMP_LT_OQ));
+			panel = _mm256_blendv_epi8(_mm256_sub_epi32(three, down), down, left);
+		}
+		else
+		{
+			//HitTestPanel's fold with every panel's candidate blended in where the point is in it
+			__m256 across[PanelCount];
+			Unroll<PanelCount>([&](auto j)
+				{
+					across[j] = _mm256_add_ps(
+						_mm256_mul_ps(dx, _mm256_set1_ps(BOUNDARY_NORMALS[j].x)),
+						_mm256_mul_ps(dy, _mm256_set1_ps(BOUNDARY_NORMALS[j].y)));
+				});
+
+			along = zero;
+			distance = zero;
+			panel = _mm256_setzero_si256();
+			Unroll<PanelCount>([&](auto k)
+				{
+					constexpr size_t next = (k + 1) % PanelCount;
+					const __m256 acrossEnd = _mm256_sub_ps(zero, across[next]);
+					const __m256 inPanel = _mm256_and_ps(_mm256_cmp_ps(across[k], zero, _CMP_GE_OQ), _mm256_cmp_ps(across[next], zero, _CMP_LT_OQ));
+					const __m256 nearStart = _mm256_cmp_ps(across[k], acrossEnd, _CMP_LT_OQ);
+
+					const __m256 boundaryX = _mm256_blendv_ps(_mm256_set1_ps(BOUNDARY_DIRECTIONS[next].x), _mm256_set1_ps(BOUNDARY_DIRECTIONS[k].x), nearStart);
+					const __m256 boundaryY = _mm256_blendv_ps(_mm256_set1_ps(BOUNDARY_DIRECTIONS[next].y), _mm256_set1_ps(BOUNDARY_DIRECTIONS[k].y), nearStart);
+					const __m256 panelAlong = _mm256_add_ps(_mm256_mul_ps(dx, boundaryX), _mm256_mul_ps(dy, boundaryY));
+
+					along = _mm256_blendv_ps(along, panelAlong, inPanel);
+					distance = _mm256_blendv_ps(distance, _mm256_blendv_ps(acrossEnd, across[k], nearStart), inPanel);
+					panel = _mm256_blendv_epi8(panel, _mm256_set1_epi32((int)k), _mm256_castps_si256(inPanel));
+				});
+		}
+
+		__m256 inside = _mm256_and_ps(_mm256_cmp_ps(radius2, innerRadius2, _CMP_GT_OQ), _mm256_cmp_ps(radius2, outerRadius2, _CMP_LT_OQ));
+
+		for (const EdgeLine& edge : hit.edges)
+		{
+			const __m256 side = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edge.a), along), _mm256_mul_ps(_mm256_set1_ps(edge.b), distance));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(side, _mm256_set1_ps(edge.c), _CMP_GT_OQ));
+		}
+
+		const __m256i button = _mm256_blendv_epi8(noButton, panel, _mm256_castps_si256(inside));
+
+		const __m128i packed16 = _mm_packs_epi32(_mm256_castsi256_si128(button), _mm256_extracti128_si256(button, 1));
+		_mm_storel_epi64((__m128i*)(panels + i), _mm_packus_epi16(packed16, packed16));
+	}
+#elif defined(__SSE2__) || defined(_M_X64)
+	const __m128 centerX = _mm_set1_ps(hit.centerX);
+	const __m128 centerY = _mm_set1_ps(hit.centerY);
+	const __m128 innerRadius2 = _mm_set1_ps(hit.innerRadius2);
+	const __m128 outerRadius2 = _mm_set1_ps(hit.outerRadius2);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 zero = _mm_setzero_ps();
+	const __m128i three = _mm_set1_epi32(3);
+	const __m128i noButton = _mm_set1_epi32(NO_BUTTON);
+
+	//SSE2 has no blend, mask ? whenTrue : whenFalse
+	const auto select = [](__m128 mask, __m128 whenTrue, __m128 whenFalse)
+		{
+			return _mm_or_ps(_mm_and_ps(mask, whenTrue), _mm_andnot_ps(mask, whenFalse));
+		};
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), centerX);
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), centerY);
+		const __m128 radius2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+		__m128 along;
+		__m128 distance;
+		__m128i panel;
+
+		if constexpr (PanelCount == 4)
+		{
+			const __m128 absX = _mm_and_ps(dx, absMask);
+			const __m128 absY = _mm_and_ps(dy, absMask);
+			along = _mm_max_ps(absX, absY);
+			distance = _mm_min_ps(absX, absY);
+
+			//all ones lanes are -1, so subtracting the mask adds one
+			const __m128i down = _mm_sub_epi32(_mm_setzero_si128(), _mm_castps_si128(_mm_cmpge_ps(dy, zero)));
+			const __m128i left = _mm_castps_si128(_mm_cmplt_ps(dx, zero));
+			panel = _mm_or_si128(_mm_and_si128(left, down), _mm_andnot_si128(left, _mm_sub_epi32(three, down)));
+		}
+		else
+		{
+			//HitTestPanel's fold with every panel's candidate selected where the point is in it
+			__m128 across[PanelCount];
+			Unroll<PanelCount>([&](auto j)
+				{
+					across[j] = _mm_add_ps(
+						_mm_mul_ps(dx, _mm_set1_ps(BOUNDARY_NORMALS[j].x)),
+						_mm_mul_ps(dy, _mm_set1_ps(BOUNDARY_NORMALS[j].y)));
+				});
+
+			along = zero;
+			distance = zero;
+			__m128 panelBits = zero;
+			Unroll<PanelCount>([&](auto k)
+				{
+					constexpr size_t next = (k + 1) % PanelCount;
+					const __m128 acrossEnd = _mm_sub_ps(zero, across[next]);
+					const __m128 inPanel = _mm_and_ps(_mm_cmpge_ps(across[k], zero), _mm_cmplt_ps(across[next], zero));
+					const __m128 nearStart = _mm_cmplt_ps(across[k], acrossEnd);
+
+					const __m128 boundaryX = select(nearStart, _mm_set1_ps(BOUNDARY_DIRECTIONS[k].x), _mm_set1_ps(BOUNDARY_DIRECTIONS[next].x));
+					const __m128 boundaryY = select(nearStart, _mm_set1_ps(BOUNDARY_DIRECTIONS[k].y), _mm_set1_ps(BOUNDARY_DIRECTIONS[next].y));
+					const __m128 panelAlong = _mm_add_ps(_mm_mul_ps(dx, boundaryX), _mm_mul_ps(dy, boundaryY));
+
+					along = select(inPanel, panelAlong, along);
+					distance = select(inPanel, select(nearStart, across[k], acrossEnd), distance);
+					panelBits = select(inPanel, _mm_castsi128_ps(_mm_set1_epi32((int)k)), panelBits);
+				});
+			panel = _mm_castps_si128(panelBits);
+		}
+
+		__m128 inside = _mm_and_ps(_mm_cmpgt_ps(radius2, innerRadius2), _mm_cmplt_ps(radius2, outerRadius2));
+
+		for (const EdgeLine& edge : hit.edges)
+		{
+			const __m128 side = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge.a), along), _mm_mul_ps(_mm_set1_ps(edge.b), distance));
+			inside = _mm_and_ps(inside, _mm_cmpgt_ps(side, _mm_set1_ps(edge.c)));
+		}
+
+		const __m128i insideMask = _mm_castps_si128(inside);
+		const __m128i button = _mm_or_si128(_mm_and_si128(insideMask, panel), _mm_andnot_si128(insideMask, noButton));
+
+		const __m128i packed16 = _mm_packs_epi32(button, button);
+		const int packed8 = _mm_cvtsi128_si32(_mm_packus_epi16(packed16, packed16));
+		std::copy_n((const uint8_t*)&packed8, 4, panels + i);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		panels[i] = (uint8_t)HitTestPanel<PanelCount>(hit, x[i], y[i]);
+	}
+}
+
+template struct Board<3>;
+template struct Board<4>;
+template struct Board<5>;
+template struct Board<6>;
+template struct Board<7>;
+template struct Board<8>;
+
+int HitTestButton(const BoardLayout& layout, float x, float y) noexcept
+{
+	return Board<BUTTON_COUNT>::HitTest(layout, x, y);
+}
+
+void HitTestButtons(const BoardLayout& layout, const float* x, const float* y, uint8_t* buttons, size_t count) noexcept
+{
+	Board<BUTTON_COUNT>::HitTestBatch(layout, x, y, buttons, count);
+}
+
+std::vector<Point2> FlattenWedgeOutline(const WedgeOutline& outline, int stepsPerSegment) noexcept
+{
+	std::vector<Point2> polygon;
+	polygon.reserve(1 + WEDGE_SEGMENT_COUNT * (stepsPerSegment + 1));
+	polygon.push_back(outline.start);
+
+	for (const BezierSegment& segment : outline.segments)
+	{
+		//segments start from wherever the previous one ended
+		const Point2 p0 = polygon.back();
+
+		for (int step = 1; step <= stepsPerSegment; step++)
+		{
+			const float t = (float)step / stepsPerSegment;
+			const float u = 1 - t;
+
+			const float w0 = u * u * u;
+			const float w1 = 3 * u * u * t;
+			const float w2 = 3 * u * t * t;
+			const float w3 = t * t * t;
+
+			polygon.push_back(
+				{
+					.x = w0 * p0.x + w1 * segment.point1.x + w2 * segment.point2.x + w3 * segment.point3.x,
+					.y = w0 * p0.y + w1 * segment.point1.y + w2 * segment.point2.y + w3 * segment.point3.y
+				});
+		}
+	}
+
+	return polygon;
+}
+
+bool PolygonContainsPoint(const std::vector<Point2>& polygon, float x, float y) noexcept
+{
+	int winding = 0;
+
+	for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+	{
+		const Point2& a = polygon[j];
+		const Point2& b = polygon[i];
+
+		const float side = (b.x - a.x) * (y - a.y) - (x - a.x) * (b.y - a.y);
+
+		if (a.y <= y)
+		{
+			if (b.y > y && side > 0)
+				winding++;
+		}
+		else if (b.y <= y && side < 0)
+		{
+			winding--;
+		}
+	}
+
+	return winding != 0;
+}
@@ -0,0 +1,400 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SimonCore.h"
+
+//board layout, button outlines and hit testing, shared by every renderer
+
+[[nodiscard]]
+constexpr float frad(float degrees) noexcept {
+	return degrees * 3.14159265359f / 180.0f;
+}
+
+//only for building tables at compile time, std::sin is not constexpr
+[[nodiscard]]
+constexpr double ConstexprSin(double radians) noexcept
+{
+	constexpr double pi = 3.14159265358979323846;
+
+	while (radians > pi)
+		radians -= 2 * pi;
+	while (radians < -pi)
+		radians += 2 * pi;
+
+	double term = radians;
+	double sum = radians;
+	for (int i = 1; i < 12; i++)
+	{
+		term *= -radians * radians / ((2 * i) * (2 * i + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+[[nodiscard]]
+constexpr double ConstexprCos(double radians) noexcept
+{
+	return ConstexprSin(radians + 3.14159265358979323846 / 2);
+}
+
+struct Point2
+{
+	float x;
+	float y;
+};
+
+struct BezierSegment
+{
+	Point2 point1;
+	Point2 point2;
+	Point2 point3;
+};
+
+constexpr int WEDGE_SEGMENT_COUNT = 6;
+
+//one closed figure: start, outer rim (3 segments), inner rim (3 segments)
+//each segment continues from where the previous one ended, the last one is closed back to start with a line
+struct WedgeOutline
+{
+	Point2 start;
+	BezierSegment segments[WEDGE_SEGMENT_COUNT];
+};
+
+//all angles are in degrees, measured counterclockwise from straight up
+constexpr float OUTER_CIRCLE_BEVEL = 2.5f;
+constexpr float INNER_CIRCLE_BEVEL = 4.2f;
+constexpr float OUTER_SLICE_MARGIN = 3.f;
+constexpr float INNER_SLICE_MARGIN = 11.f;
+
+//the outline of panel 0 as unit directions, every other panel is the same outline turned by a whole wedge
+//directions point from the board center, (-sin, -cos) of the angle, so 0 is up and 90 is left
+enum class WedgeRadius : uint8_t
+{
+	Full,
+	FullInset,
+	FullBulge,
+	Inner,
+	InnerInset,
+	InnerBulge,
+	Count
+};
+
+struct WedgeControlPoint
+{
+	Point2 direction;
+	WedgeRadius radius;
+};
+
+[[nodiscard]]
+constexpr Point2 WedgeDirection(double degrees) noexcept
+{
+	const double radians = degrees * 3.14159265358979323846 / 180.0;
+	return { .x = (float)-ConstexprSin(radians), .y = (float)-ConstexprCos(radians) };
+}
+
+constexpr size_t WEDGE_CONTROL_POINT_COUNT = 1 + WEDGE_SEGMENT_COUNT * 3;
+
+//start followed by the three control points of every segment, for a wedge of wedgeDegrees
+[[nodiscard]]
+constexpr std::array<WedgeControlPoint, WEDGE_CONTROL_POINT_COUNT> WedgeControlPoints(float wedgeDegrees) noexcept
+{
+	const float middle = wedgeDegrees / 2;
+
+	return
+	{ {
+		{ WedgeDirection(wedgeDegrees - OUTER_SLICE_MARGIN), WedgeRadius::FullInset },
+
+		//outer rim
+		{ WedgeDirection(wedgeDegrees - OUTER_SLICE_MARGIN), WedgeRadius::FullInset },
+		{ WedgeDirection(wedgeDegrees - OUTER_SLICE_MARGIN), WedgeRadius::Full },
+		{ WedgeDirection(wedgeDegrees - OUTER_SLICE_MARGIN - OUTER_CIRCLE_BEVEL), WedgeRadius::Full },
+
+		{ WedgeDirection(wedgeDegrees - OUTER_SLICE_MARGIN - OUTER_CIRCLE_BEVEL), WedgeRadius::Full },
+		{ WedgeDirection(middle), WedgeRadius::FullBulge },
+		{ WedgeDirection(OUTER_SLICE_MARGIN + OUTER_CIRCLE_BEVEL), WedgeRadius::Full },
+
+		{ WedgeDirection(OUTER_SLICE_MARGIN + OUTER_CIRCLE_BEVEL), WedgeRadius::Full },
+		{ WedgeDirection(OUTER_SLICE_MARGIN), WedgeRadius::Full },
+		{ WedgeDirection(OUTER_SLICE_MARGIN), WedgeRadius::FullInset },
+
+		//inner rim
+		{ WedgeDirection(INNER_SLICE_MARGIN), WedgeRadius::InnerInset },
+		{ WedgeDirection(INNER_SLICE_MARGIN), WedgeRadius::Inner },
+		{ WedgeDirection(INNER_SLICE_MARGIN + INNER_CIRCLE_BEVEL), WedgeRadius::Inner },
+
+		{ WedgeDirection(INNER_SLICE_MARGIN + INNER_CIRCLE_BEVEL), WedgeRadius::Inner },
+		{ WedgeDirection(middle), WedgeRadius::InnerBulge },
+		{ WedgeDirection(wedgeDegrees - INNER_SLICE_MARGIN - INNER_CIRCLE_BEVEL), WedgeRadius::Inner },
+
+		{ WedgeDirection(wedgeDegrees - INNER_SLICE_MARGIN - INNER_CIRCLE_BEVEL), WedgeRadius::Inner },
+		{ WedgeDirection(wedgeDegrees - INNER_SLICE_MARGIN), WedgeRadius::Inner },
+		{ WedgeDirection(wedgeDegrees - INNER_SLICE_MARGIN), WedgeRadius::InnerInset }
+	} };
+}
+
+//cos or sin of a whole number of wedges, exactly -1, 0 or 1 where it should be so quarter turns stay exact
+[[nodiscard]]
+constexpr double SnapUnit(double value) noexcept
+{
+	for (const double exact : { -1.0, 0.0, 1.0 })
+	{
+		if (value - exact < 1e-12 && exact - value < 1e-12)
+			return exact;
+	}
+	return value;
+}
+
+//the middle rim segment of a wedge is a bezier from the end of one bevel to the start of the other whose first
+//control point is its start and whose second is bulge times the unit direction halfway between, this is the
+//largest squared radius it reaches on a unit circle
+[[nodiscard]]
+constexpr double RimPeak(double fromDegrees, double toDegrees, double bulge) noexcept
+{
+	const Point2 from = WedgeDirection(fromDegrees);
+	const Point2 to = WedgeDirection(toDegrees);
+	const Point2 middle = WedgeDirection((fromDegrees + toDegrees) / 2);
+
+	constexpr int steps = 256;
+	double peak = 0;
+	for (int step = 0; step <= steps; step++)
+	{
+		const double t = (double)step / steps;
+		const double u = 1 - t;
+		const double start = u * u * u + 3 * u * u * t;
+		const double control = 3 * u * t * t * bulge;
+		const double end = t * t * t;
+
+		const double x = start * from.x + control * middle.x + end * to.x;
+		const double y = start * from.y + control * middle.y + end * to.y;
+		peak = x * x + y * y > peak ? x * x + y * y : peak;
+	}
+	return peak;
+}
+
+//the bulge a rim spanning fromDegrees to toDegrees needs to peak as far out as one spanning referenceFrom to
+//referenceTo does with referenceBulge, the peak only grows with the bulge so it is found by bisection
+//far too many steps to run while compiling, RIM_BULGES holds what it gives and HitTestBench checks it
+[[nodiscard]]
+constexpr float MatchRimBulge(double fromDegrees, double toDegrees, double referenceFrom, double referenceTo, float referenceBulge) noexcept
+{
+	const double target = RimPeak(referenceFrom, referenceTo, referenceBulge);
+
+	double low = .5;
+	double high = 4;
+	for (int i = 0; i < 52; i++)
+	{
+		const double bulge = (low + high) / 2;
+		if (RimPeak(fromDegrees, toDegrees, bulge) < target)
+			low = bulge;
+		else
+			high = bulge;
+	}
+	return (float)((low + high) / 2);
+}
+
+//the four panel board's rims were tuned by eye, every other count bulges its rims as far past the circle,
+//MatchRimBulge() for the outer and the inner rim of every count from 3 to 8
+struct RimBulge
+{
+	float full;
+	float inner;
+};
+
+constexpr RimBulge RIM_BULGES[] =
+{
+	{ .full = 1.53874588f, .inner = 1.39573932f },
+	{ .full = 1.3f, .inner = 1.2f },
+	{ .full = 1.18880415f, .inner = 1.11778319f },
+	{ .full = 1.12990606f, .inner = 1.07840562f },
+	{ .full = 1.09540939f, .inner = 1.05812585f },
+	{ .full = 1.07365894f, .inner = 1.04733717f }
+};
+
+constexpr int RIM_BULGES_FIRST_PANEL_COUNT = 3;
+
+struct BoardLayout
+{
+	float left;
+	float top;
+	float boardWidth;
+	float fullRadius;
+	float innerCircleRadius;
+	float lateralMargin;
+	float centerX;
+	float centerY;
+
+	[[nodiscard]]
+	static BoardLayout FromClientSize(float windowWidth, float windowHeight) noexcept;
+
+	bool operator==(const BoardLayout&) const = default;
+};
+
+//a board of PanelCount wedges, everything that depends on the count is worked out at compile time and the
+//per panel loops are unrolled, Board<BUTTON_COUNT> is the one the game draws and hit tests
+//panels count counterclockwise from the one whose wedge starts straight up
+template <int PanelCount>
+struct Board
+{
+	static_assert(PanelCount >= 3 && PanelCount <= 8, "the gaps between wedges leave room for 3 to 8 panels");
+
+	static constexpr int PANEL_COUNT = PanelCount;
+	static constexpr float WEDGE_DEGREES = 360.f / PanelCount;
+
+	static constexpr float FULL_BULGE = RIM_BULGES[PanelCount - RIM_BULGES_FIRST_PANEL_COUNT].full;
+	static constexpr float INNER_BULGE = RIM_BULGES[PanelCount - RIM_BULGES_FIRST_PANEL_COUNT].inner;
+
+	static constexpr std::array<WedgeControlPoint, WEDGE_CONTROL_POINT_COUNT> CONTROL_POINTS = WedgeControlPoints(WEDGE_DEGREES);
+
+	//CONTROL_POINTS turned to every panel
+	static constexpr std::array<std::array<Point2, WEDGE_CONTROL_POINT_COUNT>, PanelCount> PANEL_DIRECTIONS = []
+		{
+			std::array<std::array<Point2, WEDGE_CONTROL_POINT_COUNT>, PanelCount> directions = {};
+			for (int panel = 0; panel < PanelCount; panel++)
+			{
+				const double radians = panel * (2 * 3.14159265358979323846 / PanelCount);
+				const double turnCos = SnapUnit(ConstexprCos(radians));
+				const double turnSin = SnapUnit(ConstexprSin(radians));
+
+				for (size_t i = 0; i < WEDGE_CONTROL_POINT_COUNT; i++)
+				{
+					const double x = CONTROL_POINTS[i].direction.x;
+					const double y = CONTROL_POINTS[i].direction.y;
+					directions[panel][i] = { .x = (float)(x * turnCos + y * turnSin), .y = (float)(y * turnCos - x * turnSin) };
+				}
+			}
+			return directions;
+		}();
+
+	//unit direction of the boundary each panel's wedge starts at, the previous panel's ends there
+	static constexpr std::array<Point2, PanelCount> BOUNDARY_DIRECTIONS = []
+		{
+			std::array<Point2, PanelCount> directions = {};
+			for (int panel = 0; panel < PanelCount; panel++)
+				directions[panel] = WedgeDirection(panel * (360.0 / PanelCount));
+			return directions;
+		}();
+
+	//unit normal of each boundary, pointing into the wedge that starts there
+	static constexpr std::array<Point2, PanelCount> BOUNDARY_NORMALS = []
+		{
+			std::array<Point2, PanelCount> normals = {};
+			for (int panel = 0; panel < PanelCount; panel++)
+				normals[panel] = { .x = BOUNDARY_DIRECTIONS[panel].y, .y = -BOUNDARY_DIRECTIONS[panel].x };
+			return normals;
+		}();
+
+	[[nodiscard]]
+	static WedgeOutline BuildWedgeOutline(const BoardLayout& layout, int panel) noexcept;
+
+	//the panel under (x, y), or NO_BUTTON
+	//closed form on angle and radius, no path flattening
+	[[nodiscard]]
+	static int HitTest(const BoardLayout& layout, float x, float y) noexcept;
+
+	//HitTest for count points at once, vectorized where available
+	static void HitTestBatch(const BoardLayout& layout, const float* x, const float* y, uint8_t* panels, size_t count) noexcept;
+};
+
+//built once in BoardGeometry.cpp
+extern template struct Board<3>;
+extern template struct Board<4>;
+extern template struct Board<5>;
+extern template struct Board<6>;
+extern template struct Board<7>;
+extern template struct Board<8>;
+
+[[nodiscard]]
+WedgeOutline BuildWedgeOutline(const BoardLayout& layout, int button) noexcept;
+
+struct GeometryKey
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t dpi;
+
+	bool operator==(const GeometryKey&) const = default;
+};
+
+//keeps the geometry of the last few board sizes around, so moving between monitors
+//or resizing back to an earlier size never rebuilds it
+//Key is anything default constructible and equality comparable that identifies one geometry
+template <typename Geometry, size_t Capacity = 8, typename Key = GeometryKey>
+class GeometryCache
+{
+public:
+	//build(Geometry&) only runs on a miss, it reuses the least recently used slot
+	template <typename Build>
+	Geometry& GetOrBuild(const Key& key, Build build)
+	{
+		useCounter++;
+
+		Entry* victim = &entries[0];
+		for (Entry& entry : entries)
+		{
+			if (entry.bValid && entry.key == key)
+			{
+				entry.lastUse = useCounter;
+				return entry.geometry;
+			}
+
+			if (!entry.bValid || (victim->bValid && entry.lastUse < victim->lastUse))
+				victim = &entry;
+		}
+
+		build(victim->geometry);
+		victim->key = key;
+		victim->lastUse = useCounter;
+		victim->bValid = true;
+		buildCount++;
+
+		return victim->geometry;
+	}
+
+	void Clear() noexcept
+	{
+		for (Entry& entry : entries)
+			entry.bValid = false;
+	}
+
+	[[nodiscard]]
+	uint64_t BuildCount() const noexcept { return buildCount; }
+
+private:
+	struct Entry
+	{
+		Key key = {};
+		Geometry geometry = {};
+		uint64_t lastUse = 0;
+		bool bValid = false;
+	};
+
+	std::array<Entry, Capacity> entries;
+	uint64_t useCounter = 0;
+	uint64_t buildCount = 0;
+};
+
+//the button under (x, y), or NO_BUTTON
+//closed form on angle and radius, no path flattening
+[[nodiscard]]
+int HitTestButton(const BoardLayout& layout, float x, float y) noexcept;
+
+//HitTestButton for count points at once, vectorized where available
+void HitTestButtons(const BoardLayout& layout, const float* x, const float* y, uint8_t* buttons, size_t count) noexcept;
+
+//reference implementation, flattens the bezier outline into a polygon
+[[nodiscard]]
+std::vector<Point2> FlattenWedgeOutline(const WedgeOutline& outline, int stepsPerSegment) noexcept;
+
+//nonzero winding, matching D2D1_FILL_MODE_WINDING
+[[nodiscard]]
+bool PolygonContainsPoint(const std::vector<Point2>& polygon, float x, float y) noexcept;
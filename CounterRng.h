@@ -0,0 +1,50 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+//counter based generator, value i of a stream is a pure function of (key, i)
+//there is no state to advance, so any step can be regenerated in O(1)
+//and every thread can read its own stream without locking
+
+//the splitmix64 finalizer, a bijection on 64 bits
+[[nodiscard]]
+constexpr uint64_t SplitMix64(uint64_t value) noexcept
+{
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
+
+struct CounterRng
+{
+	uint64_t key;
+
+	//independent streams of one seed, e.g. one per game or per simulated session
+	[[nodiscard]]
+	static constexpr CounterRng ForStream(uint64_t seed, uint64_t stream) noexcept
+	{
+		return { .key = SplitMix64(seed ^ SplitMix64(stream + 0x9E3779B97F4A7C15ull)) };
+	}
+
+	//the same value splitmix64 seeded with key returns on call i + 1
+	[[nodiscard]]
+	constexpr uint64_t operator()(uint64_t index) const noexcept
+	{
+		return SplitMix64(key + (index + 1) * 0x9E3779B97F4A7C15ull);
+	}
+
+	//top two bits, unbiased because 4 divides 2^64
+	[[nodiscard]]
+	constexpr int Button(uint64_t index) const noexcept
+	{
+		return (int)((*this)(index) >> 62);
+	}
+};
+
+static_assert(CounterRng{ .key = 1234567 }(0) == 6457827717110365317ull, "must match reference splitmix64 seeded with 1234567");
@@ -0,0 +1,56 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "DeviceResources.h"
+
+#include <cmath>
+
+void DeviceResources::Update(ResourceFactory& factory, uint32_t pixelWidth, uint32_t pixelHeight, uint32_t dpi) noexcept
+{
+	sceneWidth = (uint32_t)lroundf(PixelsToDips((float)pixelWidth, dpi));
+	sceneHeight = (uint32_t)lroundf(PixelsToDips((float)pixelHeight, dpi));
+
+	if (!bDeviceResources)
+	{
+		factory.CreateRenderTarget(pixelWidth, pixelHeight, dpi);
+		counters.renderTargetsCreated++;
+
+		for (size_t i = 0; i < (size_t)Paint::Count; i++)
+		{
+			factory.CreateBrush((Paint)i);
+			counters.brushesCreated++;
+		}
+
+		bDeviceResources = true;
+	}
+	else if (pixelWidth != this->pixelWidth || pixelHeight != this->pixelHeight || dpi != this->dpi)
+	{
+		factory.ResizeRenderTarget(pixelWidth, pixelHeight, dpi);
+		counters.renderTargetResizes++;
+	}
+
+	this->pixelWidth = pixelWidth;
+	this->pixelHeight = pixelHeight;
+	this->dpi = dpi;
+
+	//font sizes follow the scene height in dips, which a dpi change leaves alone
+	if (textFormatHeight != sceneHeight)
+	{
+		for (size_t i = 0; i < (size_t)TextStyle::Count; i++)
+		{
+			factory.CreateTextFormat((TextStyle)i, TEXT_STYLE_SIZE[i] * sceneHeight);
+			counters.textFormatsCreated++;
+		}
+
+		textFormatHeight = sceneHeight;
+	}
+}
+
+void DeviceResources::DeviceLost(ResourceFactory& factory) noexcept
+{
+	factory.ReleaseDeviceResources();
+	bDeviceResources = false;
+}
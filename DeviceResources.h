@@ -0,0 +1,86 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "RenderBackend.h"
+
+//which graphics resources have to exist for a window size and dpi, and which can be kept
+//scenes are laid out in device independent pixels (1/96 inch), so a dpi change only resizes the
+//render target, text formats depend on the scene height in dips and brushes only on the device
+
+constexpr uint32_t DEFAULT_DPI = 96;
+
+//every resource the policy asked the platform to create, for tests and the profiler overlay
+struct ResourceCounters
+{
+	uint32_t renderTargetsCreated = 0;
+	uint32_t renderTargetResizes = 0;
+	uint32_t brushesCreated = 0;
+	uint32_t textFormatsCreated = 0;
+
+	bool operator==(const ResourceCounters&) const = default;
+};
+
+//the platform half, Direct2D in the game and a recording mock in the tools
+struct ResourceFactory
+{
+	virtual ~ResourceFactory() = default;
+
+	//sizes are in physical pixels, drawing happens in dips
+	virtual void CreateRenderTarget(uint32_t pixelWidth, uint32_t pixelHeight, uint32_t dpi) noexcept = 0;
+	virtual void ResizeRenderTarget(uint32_t pixelWidth, uint32_t pixelHeight, uint32_t dpi) noexcept = 0;
+	virtual void CreateBrush(Paint paint) noexcept = 0;
+	virtual void CreateTextFormat(TextStyle style, float fontSize) noexcept = 0;
+
+	//the render target and everything created from it
+	virtual void ReleaseDeviceResources() noexcept = 0;
+};
+
+[[nodiscard]]
+constexpr float PixelsToDips(float pixels, uint32_t dpi) noexcept
+{
+	return pixels * DEFAULT_DPI / dpi;
+}
+
+class DeviceResources
+{
+public:
+	//creates what is missing and resizes the render target in place when only the size or dpi changed
+	void Update(ResourceFactory& factory, uint32_t pixelWidth, uint32_t pixelHeight, uint32_t dpi) noexcept;
+
+	//after the device was lost, the next Update recreates the render target and brushes only
+	void DeviceLost(ResourceFactory& factory) noexcept;
+
+	[[nodiscard]]
+	bool HasRenderTarget() const noexcept { return bDeviceResources; }
+
+	//size of the scene in dips
+	[[nodiscard]]
+	uint32_t SceneWidth() const noexcept { return sceneWidth; }
+
+	[[nodiscard]]
+	uint32_t SceneHeight() const noexcept { return sceneHeight; }
+
+	[[nodiscard]]
+	const ResourceCounters& Counters() const noexcept { return counters; }
+
+private:
+	bool bDeviceResources = false;
+	uint32_t pixelWidth = 0;
+	uint32_t pixelHeight = 0;
+	uint32_t dpi = DEFAULT_DPI;
+
+	uint32_t sceneWidth = 0;
+	uint32_t sceneHeight = 0;
+
+	//text formats were made for this scene height, 0 if there are none yet
+	uint32_t textFormatHeight = 0;
+
+	ResourceCounters counters;
+};
@@ -0,0 +1,147 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "EventLoop.h"
+
+#include <algorithm>
+#include <chrono>
+
+WakeReason ConditionEventLoop::WaitUntil(int64_t deadline) noexcept
+{
+	std::unique_lock lock(wakeMutex);
+
+	while (!bWakeRequested)
+	{
+		if (deadline == NO_DEADLINE)
+		{
+			wakeCondition.wait(lock);
+			continue;
+		}
+
+		const int64_t remaining = deadline - clock.Now();
+		if (remaining <= 0)
+			return WakeReason::Deadline;
+
+		//round up so we never wake just before the deadline and spin
+		const double nanoseconds = (double)remaining * 1e9 / (double)frequency;
+		wakeCondition.wait_for(lock, std::chrono::nanoseconds((int64_t)std::min(nanoseconds + 1, 1e15)));
+	}
+
+	bWakeRequested = false;
+	return WakeReason::Event;
+}
+
+void ConditionEventLoop::Wake() noexcept
+{
+	{
+		std::lock_guard lock(wakeMutex);
+		bWakeRequested = true;
+	}
+	wakeCondition.notify_one();
+}
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+EpollEventLoop::EpollEventLoop() noexcept
+{
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	FATAL_ON_NEGATIVE(epollFd);
+
+	timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	FATAL_ON_NEGATIVE(timerFd);
+
+	wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	FATAL_ON_NEGATIVE(wakeFd);
+
+	epoll_event timerEvent =
+	{
+		.events = EPOLLIN,
+		.data = {.fd = timerFd }
+	};
+	FATAL_ON_NEGATIVE(epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &timerEvent));
+
+	epoll_event wakeEvent =
+	{
+		.events = EPOLLIN,
+		.data = {.fd = wakeFd }
+	};
+	FATAL_ON_NEGATIVE(epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &wakeEvent));
+}
+
+EpollEventLoop::~EpollEventLoop()
+{
+	close(wakeFd);
+	close(timerFd);
+	close(epollFd);
+}
+
+WakeReason EpollEventLoop::WaitUntil(int64_t deadline) noexcept
+{
+	if (deadline != armedDeadline)
+	{
+		//an all zero it_value disarms the timer, so a deadline of 0 is nudged forward
+		const int64_t expiry = deadline == NO_DEADLINE ? 0 : (deadline > 0 ? deadline : 1);
+
+		itimerspec timerSpec =
+		{
+			.it_interval = {},
+			.it_value =
+			{
+				.tv_sec = (time_t)(expiry / 1'000'000'000),
+				.tv_nsec = (long)(expiry % 1'000'000'000)
+			}
+		};
+
+		FATAL_ON_NEGATIVE(timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &timerSpec, nullptr));
+		armedDeadline = deadline;
+	}
+
+	epoll_event events[2];
+	int eventCount;
+
+	do
+	{
+		eventCount = epoll_wait(epollFd, events, 2, -1);
+	} while (eventCount < 0 && errno == EINTR);
+
+	FATAL_ON_NEGATIVE(eventCount);
+
+	wakeups++;
+
+	WakeReason reason = WakeReason::Deadline;
+
+	for (int i = 0; i < eventCount; i++)
+	{
+		uint64_t counter;
+		if (events[i].data.fd == wakeFd)
+		{
+			if (read(wakeFd, &counter, sizeof(counter)) == sizeof(counter))
+				reason = WakeReason::Event;
+		}
+		else if (read(timerFd, &counter, sizeof(counter)) == sizeof(counter))
+		{
+			//the timer is one-shot and now disarmed
+			armedDeadline = NO_DEADLINE;
+		}
+	}
+
+	return reason;
+}
+
+void EpollEventLoop::Wake() noexcept
+{
+	const uint64_t one = 1;
+	FATAL_ON_NEGATIVE(write(wakeFd, &one, sizeof(one)));
+}
+
+#endif
@@ -0,0 +1,84 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "SimonCore.h"
+
+//sleeps until the next deadline or until an input event arrives
+//instead of spinning, deadlines are in the ticks of the clock the loop was built for
+
+enum class WakeReason : int
+{
+	Deadline,
+	Event
+};
+
+struct EventLoop
+{
+	virtual ~EventLoop() = default;
+
+	//blocks until deadline has passed or Wake() was called, NO_DEADLINE waits for events only
+	[[nodiscard]]
+	virtual WakeReason WaitUntil(int64_t deadline) noexcept = 0;
+
+	//safe to call from any thread
+	virtual void Wake() noexcept = 0;
+};
+
+//portable loop for threads without a message queue of their own, deadlines are in the ticks of clock
+class ConditionEventLoop final : public EventLoop
+{
+public:
+	explicit ConditionEventLoop(GameClock& clock) noexcept : clock(clock), frequency(clock.Frequency()) {}
+
+	[[nodiscard]]
+	WakeReason WaitUntil(int64_t deadline) noexcept override;
+
+	void Wake() noexcept override;
+
+private:
+	GameClock& clock;
+	int64_t frequency;
+
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+	bool bWakeRequested = false;
+};
+
+#ifdef __linux__
+
+//timerfd + eventfd behind one epoll instance, deadlines are CLOCK_MONOTONIC nanoseconds (SteadyClock ticks)
+class EpollEventLoop final : public EventLoop
+{
+public:
+	EpollEventLoop() noexcept;
+	~EpollEventLoop() override;
+
+	EpollEventLoop(const EpollEventLoop&) = delete;
+	EpollEventLoop& operator=(const EpollEventLoop&) = delete;
+
+	[[nodiscard]]
+	WakeReason WaitUntil(int64_t deadline) noexcept override;
+
+	void Wake() noexcept override;
+
+	[[nodiscard]]
+	uint64_t WakeupCount() const noexcept { return wakeups; }
+
+private:
+	int epollFd = -1;
+	int timerFd = -1;
+	int wakeFd = -1;
+	int64_t armedDeadline = NO_DEADLINE;
+	uint64_t wakeups = 0;
+};
+
+#endif
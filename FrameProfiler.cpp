@@ -0,0 +1,163 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cwchar>
+
+#include "RenderBackend.h"
+
+namespace
+{
+	LatencyHistogram phaseHistograms[(size_t)ProfilePhase::Count];
+
+	//a line of overlay text is about this many times the font size tall
+	constexpr float OVERLAY_LINE_HEIGHT = 1.4f;
+	constexpr float OVERLAY_WIDTH = .5f;
+	constexpr int OVERLAY_LINE_LENGTH = 64;
+}
+
+uint32_t LatencyHistogram::BucketIndex(uint64_t value) noexcept
+{
+	if (value < SUB_BUCKET_COUNT)
+		return (uint32_t)value;
+
+	//the top SUB_BUCKET_BITS + 1 bits pick the bucket
+	const uint32_t exponent = (uint32_t)std::bit_width(value) - (SUB_BUCKET_BITS + 1);
+	return (exponent + 1) * SUB_BUCKET_COUNT + (uint32_t)(value >> exponent) - SUB_BUCKET_COUNT;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(uint32_t index) noexcept
+{
+	if (index < SUB_BUCKET_COUNT)
+		return index;
+
+	const uint32_t exponent = index / SUB_BUCKET_COUNT - 1;
+	const uint64_t subBucket = index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+	return ((subBucket + 1) << exponent) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value) noexcept
+{
+	counts[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+
+	uint64_t currentMax = max.load(std::memory_order_relaxed);
+	while (value > currentMax && !max.compare_exchange_weak(currentMax, value, std::memory_order_relaxed))
+	{
+	}
+}
+
+uint64_t LatencyHistogram::Count() const noexcept
+{
+	uint64_t total = 0;
+	for (const std::atomic<uint64_t>& count : counts)
+		total += count.load(std::memory_order_relaxed);
+	return total;
+}
+
+uint64_t LatencyHistogram::Percentile(double fraction) const noexcept
+{
+	const uint64_t total = Count();
+	if (total == 0)
+		return 0;
+
+	const uint64_t target = std::min((uint64_t)(total * fraction), total - 1);
+	uint64_t seen = 0;
+
+	for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+	{
+		seen += counts[i].load(std::memory_order_relaxed);
+		if (seen > target)
+			return std::min(BucketUpperBound(i), Max());
+	}
+	return Max();
+}
+
+void LatencyHistogram::Reset() noexcept
+{
+	for (std::atomic<uint64_t>& count : counts)
+		count.store(0, std::memory_order_relaxed);
+	max.store(0, std::memory_order_relaxed);
+}
+
+LatencyHistogram& PhaseHistogram(ProfilePhase phase) noexcept
+{
+	return phaseHistograms[(size_t)phase];
+}
+
+bool WriteProfileReport(const char* path) noexcept
+{
+	FILE* file = fopen(path, "w");
+	if (file == nullptr)
+		return false;
+
+	fprintf(file, "phase,count,p50_ns,p99_ns,max_ns\n");
+
+	for (size_t i = 0; i < (size_t)ProfilePhase::Count; i++)
+	{
+		const LatencyHistogram& histogram = phaseHistograms[i];
+		fprintf(file, "%s,%llu,%llu,%llu,%llu\n",
+			PROFILE_PHASE_NAMES[i],
+			(unsigned long long)histogram.Count(),
+			(unsigned long long)histogram.Percentile(.5),
+			(unsigned long long)histogram.Percentile(.99),
+			(unsigned long long)histogram.Max());
+	}
+
+	return fclose(file) == 0;
+}
+
+void DrawProfileOverlay(RenderBackend& backend, float windowWidth, float windowHeight) noexcept
+{
+	const float lineHeight = TEXT_STYLE_SIZE[(size_t)TextStyle::Overlay] * windowHeight * OVERLAY_LINE_HEIGHT;
+	constexpr int lineCount = (int)ProfilePhase::Count + 1;
+
+	const Rect area =
+	{
+		.left = 0,
+		.top = floorf(windowHeight - lineHeight * lineCount),
+		.right = floorf(windowWidth * OVERLAY_WIDTH),
+		.bottom = windowHeight
+	};
+
+	backend.BeginDraw();
+	backend.PushClip(area);
+	backend.Clear();
+
+	wchar_t line[OVERLAY_LINE_LENGTH];
+
+	auto DrawLine = [&](int index, int length)
+		{
+			const Rect lineArea = { area.left, area.top + lineHeight * index, area.right, area.top + lineHeight * (index + 1) };
+			backend.DrawString(line, (uint32_t)std::clamp(length, 0, OVERLAY_LINE_LENGTH - 1), TextStyle::Overlay, lineArea, Paint::LightGray);
+		};
+
+	DrawLine(0, swprintf(line, OVERLAY_LINE_LENGTH, L"phase us p50 p99 max"));
+
+	for (int i = 0; i < (int)ProfilePhase::Count; i++)
+	{
+		const LatencyHistogram& histogram = phaseHistograms[i];
+
+		//phase names are ascii, widened by hand since %s means different things to msvc and glibc in wide printf
+		int length = 0;
+		for (const char* name = PROFILE_PHASE_NAMES[i]; *name != '\0'; name++)
+			line[length++] = (wchar_t)*name;
+
+		const int numbersLength = swprintf(line + length, OVERLAY_LINE_LENGTH - length, L" %.1f %.1f %.1f",
+			histogram.Percentile(.5) / 1e3,
+			histogram.Percentile(.99) / 1e3,
+			histogram.Max() / 1e3);
+
+		DrawLine(i + 1, numbersLength < 0 ? length : length + numbersLength);
+	}
+
+	backend.PopClip();
+	backend.EndDraw();
+}
@@ -0,0 +1,124 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+struct RenderBackend;
+
+//scoped timing probes around the expensive phases of a frame
+//build with SIMON_PROFILING=0 and PROFILE_SCOPE expands to nothing
+
+#ifndef SIMON_PROFILING
+#define SIMON_PROFILING 0
+#endif
+
+enum class ProfilePhase : uint8_t
+{
+	Frame,
+	Input,
+	HitTest,
+	CreateAssets,
+	GeometryBuild,
+	Scene,
+	BeginDraw,
+	EndDraw,
+	Text,
+	Count
+};
+
+constexpr const char* PROFILE_PHASE_NAMES[(size_t)ProfilePhase::Count] =
+{
+	"frame",
+	"input",
+	"hit_test",
+	"create_assets",
+	"geometry_build",
+	"scene",
+	"begin_draw",
+	"end_draw",
+	"text"
+};
+
+//log-linear buckets like an HDR histogram, 16 sub-buckets per power of two keeps every
+//value within 1/16 of its bucket, recording is one relaxed fetch_add so any thread may record
+class LatencyHistogram
+{
+public:
+	static constexpr uint32_t SUB_BUCKET_BITS = 4;
+	static constexpr uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	static constexpr uint32_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+	void Record(uint64_t value) noexcept;
+
+	[[nodiscard]]
+	uint64_t Count() const noexcept;
+
+	//largest value the bucket holding the given fraction of samples can contain
+	[[nodiscard]]
+	uint64_t Percentile(double fraction) const noexcept;
+
+	[[nodiscard]]
+	uint64_t Max() const noexcept { return max.load(std::memory_order_relaxed); }
+
+	void Reset() noexcept;
+
+	[[nodiscard]]
+	static uint32_t BucketIndex(uint64_t value) noexcept;
+
+	[[nodiscard]]
+	static uint64_t BucketUpperBound(uint32_t index) noexcept;
+
+private:
+	std::atomic<uint64_t> counts[BUCKET_COUNT] = {};
+	std::atomic<uint64_t> max = 0;
+};
+
+//nanoseconds spent in each phase since startup
+[[nodiscard]]
+LatencyHistogram& PhaseHistogram(ProfilePhase phase) noexcept;
+
+class ScopedProbe
+{
+public:
+	explicit ScopedProbe(ProfilePhase phase) noexcept :
+		phase(phase),
+		start(std::chrono::steady_clock::now())
+	{
+	}
+
+	~ScopedProbe()
+	{
+		PhaseHistogram(phase).Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	ScopedProbe(const ScopedProbe&) = delete;
+	ScopedProbe& operator=(const ScopedProbe&) = delete;
+
+private:
+	ProfilePhase phase;
+	std::chrono::steady_clock::time_point start;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#if SIMON_PROFILING
+#define PROFILE_SCOPE(phase) const ScopedProbe PROFILE_CONCAT(profileProbe, __LINE__)(phase)
+#else
+#define PROFILE_SCOPE(phase) ((void)0)
+#endif
+
+//phase,count,p50_ns,p99_ns,max_ns as csv, false if the file could not be written
+[[nodiscard]]
+bool WriteProfileReport(const char* path) noexcept;
+
+//p50/p99/max of every phase in a box at the bottom left of the window
+void DrawProfileOverlay(RenderBackend& backend, float windowWidth, float windowHeight) noexcept;
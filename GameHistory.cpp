@@ -0,0 +1,643 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "GameHistory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+namespace
+{
+	constexpr uint64_t COLUMN_ALIGNMENT = 64;
+
+	[[nodiscard]]
+	uint64_t AlignColumn(uint64_t bytes) noexcept
+	{
+		return (bytes + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+	}
+
+	//offsets of every column from the start of its segment, all follow from the game and press counts
+	struct SegmentLayout
+	{
+		uint64_t seed;
+		uint64_t gameNumber;
+		uint64_t playbackLength;
+		uint64_t failureStep;
+		uint64_t pressEnd;
+		uint64_t reactionMilliseconds;
+		uint64_t bytes;
+	};
+
+	[[nodiscard]]
+	SegmentLayout LayoutFor(uint64_t games, uint64_t presses) noexcept
+	{
+		SegmentLayout layout;
+		uint64_t offset = sizeof(HistorySegmentHeader);
+
+		layout.seed = offset;
+		offset += AlignColumn(games * sizeof(uint64_t));
+		layout.gameNumber = offset;
+		offset += AlignColumn(games * sizeof(uint64_t));
+		layout.playbackLength = offset;
+		offset += AlignColumn(games * sizeof(uint32_t));
+		layout.failureStep = offset;
+		offset += AlignColumn(games * sizeof(int32_t));
+		layout.pressEnd = offset;
+		offset += AlignColumn(games * sizeof(uint32_t));
+		layout.reactionMilliseconds = offset;
+		offset += AlignColumn(presses * sizeof(uint16_t));
+		layout.bytes = offset;
+
+		return layout;
+	}
+
+	[[nodiscard]]
+	uint32_t SegmentChecksum(const HistorySegmentHeader& header) noexcept
+	{
+		uint64_t hash = SplitMix64(header.magic + 0x9E3779B97F4A7C15ull);
+		hash = SplitMix64(hash ^ header.games);
+		hash = SplitMix64(hash ^ header.presses);
+		hash = SplitMix64(hash ^ header.segmentBytes);
+		hash = SplitMix64(hash ^ ((uint64_t)header.buttonLitMicroseconds << 32 | header.allButtonsOffMicroseconds));
+		hash = SplitMix64(hash ^ ((uint64_t)header.gameStateChangedMicroseconds << 32 | header.maxPlaybackLength));
+		return (uint32_t)hash | 1;
+	}
+
+	//a segment that starts at offset and ends by fileBytes, whose header is intact and agrees with its size
+	[[nodiscard]]
+	bool ValidSegment(const HistorySegmentHeader& header, uint64_t offset, uint64_t fileBytes) noexcept
+	{
+		return
+			header.magic == SEGMENT_MAGIC &&
+			header.checksum == SegmentChecksum(header) &&
+			header.games != 0 &&
+			header.presses <= UINT32_MAX &&
+			header.segmentBytes == LayoutFor(header.games, header.presses).bytes &&
+			header.segmentBytes <= fileBytes - offset;
+	}
+
+	[[nodiscard]]
+	bool ValidHeader(const HistoryHeader& header) noexcept
+	{
+		return memcmp(header.magic, HISTORY_MAGIC, sizeof(header.magic)) == 0 && header.version == HISTORY_VERSION && header.segmentHeaderBytes == sizeof(HistorySegmentHeader);
+	}
+
+	[[nodiscard]]
+	uint32_t ToMicroseconds(int64_t ticks, int64_t frequency) noexcept
+	{
+		return (uint32_t)std::clamp<int64_t>(ticks * 1'000'000 / frequency, 0, UINT32_MAX);
+	}
+
+	[[nodiscard]]
+	uint16_t ToReactionMilliseconds(int64_t ticks, int64_t frequency) noexcept
+	{
+		return (uint16_t)std::clamp<int64_t>(ticks * 1'000 / frequency, 0, MAX_REACTION_MILLISECONDS);
+	}
+
+	//a better than b on the leaderboard
+	[[nodiscard]]
+	bool Ranks(const LeaderboardEntry& a, const LeaderboardEntry& b) noexcept
+	{
+		return a.score != b.score ? a.score > b.score : a.index < b.index;
+	}
+}
+
+GameHistoryWriter::~GameHistoryWriter()
+{
+	(void)Close();
+}
+
+bool GameHistoryWriter::Open(const char* path, int64_t frequency) noexcept
+{
+	(void)Close();
+
+	this->frequency = frequency;
+
+	//everything past the last complete segment is what a crash left of the one being written
+	uint64_t validBytes = 0;
+	uint64_t fileBytes = 0;
+
+	if (FILE* existing = fopen(path, "rb"))
+	{
+		std::error_code error;
+		fileBytes = (uint64_t)std::filesystem::file_size(path, error);
+		if (error)
+		{
+			fclose(existing);
+			return false;
+		}
+
+		if (fileBytes != 0)
+		{
+			HistoryHeader header;
+			if (fread(&header, sizeof(header), 1, existing) != 1 || !ValidHeader(header))
+			{
+				fclose(existing);
+				return false;
+			}
+
+			validBytes = sizeof(HistoryHeader);
+
+			//headers are read in order, each segment is skipped over without reading its columns
+			HistorySegmentHeader segmentHeader;
+			while (fileBytes - validBytes >= sizeof(segmentHeader) &&
+				fread(&segmentHeader, sizeof(segmentHeader), 1, existing) == 1 &&
+				ValidSegment(segmentHeader, validBytes, fileBytes))
+			{
+				validBytes += segmentHeader.segmentBytes;
+
+#if defined(_WIN32)
+				if (_fseeki64(existing, (int64_t)validBytes, SEEK_SET) != 0)
+#else
+				if (fseeko(existing, (off_t)validBytes, SEEK_SET) != 0)
+#endif
+					break;
+			}
+		}
+
+		fclose(existing);
+	}
+
+	if (validBytes < fileBytes)
+	{
+		std::error_code error;
+		std::filesystem::resize_file(path, validBytes, error);
+		if (error)
+			return false;
+	}
+
+	file = fopen(path, "ab");
+	if (file == nullptr)
+		return false;
+
+	bFailed = false;
+
+	if (validBytes == 0)
+	{
+		HistoryHeader header = {};
+		memcpy(header.magic, HISTORY_MAGIC, sizeof(header.magic));
+		header.version = HISTORY_VERSION;
+		header.segmentHeaderBytes = sizeof(HistorySegmentHeader);
+		bFailed |= fwrite(&header, sizeof(header), 1, file) != 1;
+	}
+
+	return !bFailed;
+}
+
+bool GameHistoryWriter::Close() noexcept
+{
+	if (file == nullptr)
+		return true;
+
+	if (!seeds.empty())
+		WriteSegment();
+
+	bFailed |= fclose(file) != 0;
+	file = nullptr;
+
+	return !bFailed;
+}
+
+void GameHistoryWriter::Append(const HistoryGame& game) noexcept
+{
+	if (file == nullptr)
+		return;
+
+	const bool bTimingsChanged =
+		game.buttonLitMicroseconds != segment.buttonLitMicroseconds ||
+		game.allButtonsOffMicroseconds != segment.allButtonsOffMicroseconds ||
+		game.gameStateChangedMicroseconds != segment.gameStateChangedMicroseconds;
+
+	if (!seeds.empty() && (bTimingsChanged || seeds.size() == SEGMENT_GAMES || reactions.size() + game.presses > SEGMENT_PRESSES))
+		WriteSegment();
+
+	if (seeds.empty())
+	{
+		segment = {};
+		segment.buttonLitMicroseconds = game.buttonLitMicroseconds;
+		segment.allButtonsOffMicroseconds = game.allButtonsOffMicroseconds;
+		segment.gameStateChangedMicroseconds = game.gameStateChangedMicroseconds;
+	}
+
+	seeds.push_back(game.seed);
+	gameNumbers.push_back(game.gameNumber);
+	playbackLengths.push_back(game.playbackLength);
+	failureSteps.push_back(game.failureStep);
+	reactions.insert(reactions.end(), game.reactionMilliseconds, game.reactionMilliseconds + game.presses);
+	pressEnds.push_back((uint32_t)reactions.size());
+
+	segment.maxPlaybackLength = std::max(segment.maxPlaybackLength, game.playbackLength);
+	gamesAppended++;
+}
+
+void GameHistoryWriter::Observe(const GameCore& game) noexcept
+{
+	//a tick judges at most one press, and a wrong one belongs to the game it ends
+	if (game.presses != observedPresses)
+	{
+		currentReactions.push_back(ToReactionMilliseconds(game.lastReactionTicks, frequency));
+		observedPresses = game.presses;
+	}
+
+	if (game.finishedGames != observedGames)
+	{
+		const FinishedGame& finished = game.lastFinished;
+
+		Append(
+			{
+				.seed = finished.seed,
+				.gameNumber = finished.gameNumber,
+				.playbackLength = (uint32_t)finished.playbackLength,
+				.failureStep = finished.failureStep,
+				.buttonLitMicroseconds = ToMicroseconds(game.timings.ButtonLitTicks, frequency),
+				.allButtonsOffMicroseconds = ToMicroseconds(game.timings.AllButtonsOffTicks, frequency),
+				.gameStateChangedMicroseconds = ToMicroseconds(game.timings.GameStateChangedTicks, frequency),
+				.reactionMilliseconds = currentReactions.data(),
+				.presses = (uint32_t)currentReactions.size()
+			});
+
+		currentReactions.clear();
+		observedGames = game.finishedGames;
+
+		//games played live are written in short segments, so a crash loses only the last few of them
+		if (seeds.size() == 1)
+			segmentStartTime = finished.endTime;
+
+		if (!seeds.empty() && (seeds.size() >= LIVE_SEGMENT_GAMES || finished.endTime - segmentStartTime >= LIVE_SEGMENT_SECONDS * frequency))
+			WriteSegment();
+	}
+}
+
+void GameHistoryWriter::WriteSegment() noexcept
+{
+	static const uint8_t padding[COLUMN_ALIGNMENT] = {};
+
+	const SegmentLayout layout = LayoutFor(seeds.size(), reactions.size());
+
+	segment.magic = SEGMENT_MAGIC;
+	segment.games = (uint32_t)seeds.size();
+	segment.presses = reactions.size();
+	segment.segmentBytes = layout.bytes;
+	segment.checksum = SegmentChecksum(segment);
+
+	//a crash part way leaves a segment shorter than its header says, which the next Open() cuts off
+	auto write = [this](const void* data, size_t bytes)
+		{
+			bFailed |= bytes != 0 && fwrite(data, 1, bytes, file) != bytes;
+			bFailed |= fwrite(padding, 1, AlignColumn(bytes) - bytes, file) != AlignColumn(bytes) - bytes;
+		};
+
+	write(&segment, sizeof(segment));
+	write(seeds.data(), seeds.size() * sizeof(uint64_t));
+	write(gameNumbers.data(), gameNumbers.size() * sizeof(uint64_t));
+	write(playbackLengths.data(), playbackLengths.size() * sizeof(uint32_t));
+	write(failureSteps.data(), failureSteps.size() * sizeof(int32_t));
+	write(pressEnds.data(), pressEnds.size() * sizeof(uint32_t));
+	write(reactions.data(), reactions.size() * sizeof(uint16_t));
+
+	seeds.clear();
+	gameNumbers.clear();
+	playbackLengths.clear();
+	failureSteps.clear();
+	pressEnds.clear();
+	reactions.clear();
+
+	//handed to the os, so a process that dies later loses nothing written up to here
+	bFailed |= fflush(file) != 0;
+}
+
+uint32_t Histogram::Percentile(double fraction) const noexcept
+{
+	if (total == 0)
+		return 0;
+
+	const uint64_t rank = std::clamp<uint64_t>((uint64_t)std::ceil(fraction * (double)total), 1, total);
+
+	uint64_t seen = 0;
+	for (size_t value = 0; value < counts.size(); value++)
+	{
+		seen += counts[value];
+		if (seen >= rank)
+			return (uint32_t)value;
+	}
+
+	return (uint32_t)counts.size() - 1;
+}
+
+GameHistoryReader::~GameHistoryReader()
+{
+	Close();
+}
+
+bool GameHistoryReader::Open(const char* path) noexcept
+{
+	Close();
+
+	//the whole file is mapped at once, address space is no concern on 64 bit and the page cache does the rest
+#if defined(__linux__)
+	const int fileDescriptor = open(path, O_RDONLY | O_CLOEXEC);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) != 0 || (uint64_t)fileStatus.st_size < sizeof(HistoryHeader))
+	{
+		close(fileDescriptor);
+		return false;
+	}
+	viewBytes = (uint64_t)fileStatus.st_size;
+
+	void* mapped = mmap(nullptr, viewBytes, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	close(fileDescriptor);
+	if (mapped == MAP_FAILED)
+		return false;
+	view = (const uint8_t*)mapped;
+#elif defined(_WIN32)
+	const HANDLE fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || (uint64_t)fileSize.QuadPart < sizeof(HistoryHeader))
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+	viewBytes = (uint64_t)fileSize.QuadPart;
+
+	//the view keeps the mapping and the file alive once both handles are closed
+	const HANDLE mapping = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(fileHandle);
+	if (mapping == nullptr)
+		return false;
+
+	view = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == nullptr)
+		return false;
+#else
+	(void)path;
+	return false;
+#endif
+
+	if (!ValidHeader(*(const HistoryHeader*)view))
+	{
+		Close();
+		return false;
+	}
+
+	uint64_t offset = sizeof(HistoryHeader);
+	while (viewBytes - offset >= sizeof(HistorySegmentHeader))
+	{
+		const HistorySegmentHeader& header = *(const HistorySegmentHeader*)(view + offset);
+		if (!ValidSegment(header, offset, viewBytes))
+			break;
+
+		const uint8_t* base = view + offset;
+		const SegmentLayout layout = LayoutFor(header.games, header.presses);
+
+		segments.push_back(
+			{
+				.header = &header,
+				.seed = (const uint64_t*)(base + layout.seed),
+				.gameNumber = (const uint64_t*)(base + layout.gameNumber),
+				.playbackLength = (const uint32_t*)(base + layout.playbackLength),
+				.failureStep = (const int32_t*)(base + layout.failureStep),
+				.pressEnd = (const uint32_t*)(base + layout.pressEnd),
+				.reactionMilliseconds = (const uint16_t*)(base + layout.reactionMilliseconds)
+			});
+		firstGame.push_back(games);
+
+		games += header.games;
+		presses += header.presses;
+		maxPlaybackLength = std::max(maxPlaybackLength, header.maxPlaybackLength);
+		offset += header.segmentBytes;
+	}
+
+	return true;
+}
+
+void GameHistoryReader::Close() noexcept
+{
+	if (view != nullptr)
+	{
+#if defined(__linux__)
+		munmap((void*)view, viewBytes);
+#elif defined(_WIN32)
+		UnmapViewOfFile(view);
+#endif
+	}
+
+	view = nullptr;
+	viewBytes = 0;
+	games = 0;
+	presses = 0;
+	maxPlaybackLength = 0;
+	segments.clear();
+	firstGame.clear();
+}
+
+Histogram GameHistoryReader::ScoreHistogram(WorkStealingPool& pool) const noexcept
+{
+	std::vector<std::vector<uint64_t>> perWorker(pool.ThreadCount(), std::vector<uint64_t>(std::max(maxPlaybackLength, 1u)));
+
+	pool.ParallelFor((uint32_t)segments.size(), 1, [&](uint32_t begin, uint32_t end, uint32_t worker)
+		{
+			uint64_t* counts = perWorker[worker].data();
+
+			for (uint32_t s = begin; s < end; s++)
+			{
+				const HistorySegment& segment = segments[s];
+				for (uint32_t i = 0; i < segment.header->games; i++)
+					counts[std::max(segment.playbackLength[i], 1u) - 1]++;
+			}
+		});
+
+	Histogram histogram = { .counts = std::move(perWorker[0]), .total = games };
+	for (size_t worker = 1; worker < perWorker.size(); worker++)
+	{
+		for (size_t value = 0; value < histogram.counts.size(); value++)
+			histogram.counts[value] += perWorker[worker][value];
+	}
+
+	return histogram;
+}
+
+Histogram GameHistoryReader::ReactionHistogram(WorkStealingPool& pool) const noexcept
+{
+	//most presses take about as long as the one before, so four interleaved counters per value keep
+	//consecutive increments of the same value from waiting on each other
+	constexpr size_t LANES = 4;
+	std::vector<std::vector<uint64_t>> perWorker(pool.ThreadCount(), std::vector<uint64_t>((MAX_REACTION_MILLISECONDS + 1) * LANES));
+
+	pool.ParallelFor((uint32_t)segments.size(), 1, [&](uint32_t begin, uint32_t end, uint32_t worker)
+		{
+			uint64_t* counts = perWorker[worker].data();
+
+			for (uint32_t s = begin; s < end; s++)
+			{
+				const HistorySegment& segment = segments[s];
+				const uint16_t* reactions = segment.reactionMilliseconds;
+				const uint64_t count = segment.header->presses;
+
+				uint64_t i = 0;
+				for (; i + LANES <= count; i += LANES)
+				{
+					counts[reactions[i] * LANES]++;
+					counts[reactions[i + 1] * LANES + 1]++;
+					counts[reactions[i + 2] * LANES + 2]++;
+					counts[reactions[i + 3] * LANES + 3]++;
+				}
+				for (; i < count; i++)
+					counts[reactions[i] * LANES]++;
+			}
+		});
+
+	Histogram histogram = { .counts = std::vector<uint64_t>(MAX_REACTION_MILLISECONDS + 1), .total = presses };
+	for (const std::vector<uint64_t>& counts : perWorker)
+	{
+		for (size_t value = 0; value < histogram.counts.size(); value++)
+			histogram.counts[value] += counts[value * LANES] + counts[value * LANES + 1] + counts[value * LANES + 2] + counts[value * LANES + 3];
+	}
+
+	//nothing past the slowest press
+	while (histogram.counts.size() > 1 && histogram.counts.back() == 0)
+		histogram.counts.pop_back();
+
+	return histogram;
+}
+
+std::vector<PositionErrors> GameHistoryReader::PositionErrorRates(WorkStealingPool& pool) const noexcept
+{
+	//presses per step go in as differences, so a game costs the same whatever its length:
+	//a game of playback length L completed rounds 1 to L - 1, which pressed step p L - 1 - p times for p < L - 1,
+	//kept as L - 1 in constant and 1 in slope over [0, L - 1), then its last round pressed steps [0, f) once more
+	struct Accumulator
+	{
+		std::vector<int64_t> constant;
+		std::vector<int64_t> slope;
+		std::vector<uint64_t> errors;
+	};
+
+	const size_t steps = (size_t)maxPlaybackLength + 1;
+	std::vector<Accumulator> perWorker(pool.ThreadCount(), { std::vector<int64_t>(steps), std::vector<int64_t>(steps), std::vector<uint64_t>(steps) });
+
+	pool.ParallelFor((uint32_t)segments.size(), 1, [&](uint32_t begin, uint32_t end, uint32_t worker)
+		{
+			Accumulator& accumulator = perWorker[worker];
+
+			for (uint32_t s = begin; s < end; s++)
+			{
+				const HistorySegment& segment = segments[s];
+				uint32_t previousEnd = 0;
+
+				for (uint32_t i = 0; i < segment.header->games; i++)
+				{
+					const uint64_t length = std::max(segment.playbackLength[i], 1u);
+					const uint64_t gamePresses = segment.pressEnd[i] - previousEnd;
+					previousEnd = segment.pressEnd[i];
+
+					const uint64_t completedPresses = length * (length - 1) / 2;
+					const uint64_t lastRound = std::min(gamePresses - std::min(gamePresses, completedPresses), length);
+
+					accumulator.constant[0] += (int64_t)(length - 1 + (lastRound != 0));
+					accumulator.constant[length - 1] -= (int64_t)(length - 1);
+					accumulator.constant[lastRound] -= lastRound != 0;
+					accumulator.slope[0] += 1;
+					accumulator.slope[length - 1] -= 1;
+
+					const int32_t failure = segment.failureStep[i];
+					if (failure >= 0 && (uint64_t)failure < length)
+						accumulator.errors[(size_t)failure]++;
+				}
+			}
+		});
+
+	std::vector<PositionErrors> rates(maxPlaybackLength);
+	int64_t constant = 0;
+	int64_t slope = 0;
+
+	for (size_t step = 0; step < rates.size(); step++)
+	{
+		for (const Accumulator& accumulator : perWorker)
+		{
+			constant += accumulator.constant[step];
+			slope += accumulator.slope[step];
+			rates[step].errors += accumulator.errors[step];
+		}
+
+		rates[step].presses = (uint64_t)(constant - slope * (int64_t)step);
+	}
+
+	return rates;
+}
+
+std::vector<LeaderboardEntry> GameHistoryReader::TopScores(WorkStealingPool& pool, uint32_t count) const noexcept
+{
+	if (count == 0)
+		return {};
+
+	//one heap per worker with its worst entry on top, a segment whose best game cannot beat a full heap is skipped
+	std::vector<std::vector<LeaderboardEntry>> perWorker(pool.ThreadCount());
+
+	pool.ParallelFor((uint32_t)segments.size(), 1, [&](uint32_t begin, uint32_t end, uint32_t worker)
+		{
+			std::vector<LeaderboardEntry>& heap = perWorker[worker];
+
+			for (uint32_t s = begin; s < end; s++)
+			{
+				const HistorySegment& segment = segments[s];
+				const uint32_t bestScore = std::max(segment.header->maxPlaybackLength, 1u) - 1;
+
+				if (heap.size() == count && bestScore < heap.front().score)
+					continue;
+
+				for (uint32_t i = 0; i < segment.header->games; i++)
+				{
+					const uint32_t score = std::max(segment.playbackLength[i], 1u) - 1;
+					if (heap.size() == count && score < heap.front().score)
+						continue;
+
+					//segments are not visited in order, so a tie can still beat the worst entry
+					const LeaderboardEntry entry = { .score = score, .seed = segment.seed[i], .gameNumber = segment.gameNumber[i], .index = firstGame[s] + i };
+					if (heap.size() == count && !Ranks(entry, heap.front()))
+						continue;
+
+					heap.push_back(entry);
+					std::push_heap(heap.begin(), heap.end(), Ranks);
+
+					if (heap.size() > count)
+					{
+						std::pop_heap(heap.begin(), heap.end(), Ranks);
+						heap.pop_back();
+					}
+				}
+			}
+		});
+
+	std::vector<LeaderboardEntry> leaderboard;
+	for (const std::vector<LeaderboardEntry>& heap : perWorker)
+		leaderboard.insert(leaderboard.end(), heap.begin(), heap.end());
+
+	std::sort(leaderboard.begin(), leaderboard.end(), Ranks);
+	if (leaderboard.size() > count)
+		leaderboard.resize(count);
+
+	return leaderboard;
+}
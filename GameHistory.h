@@ -0,0 +1,236 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "SimonCore.h"
+#include "WorkStealingPool.h"
+
+//every finished game with the reaction time of every press, stored by column for analytics
+//the file is a header and then segments of up to SEGMENT_GAMES games, each a header and one contiguous,
+//cache line aligned array per column: seed, game number, final playback length, failure step, where the
+//game's presses end, then the reaction times of all presses of all its games back to back
+//the timing constants are the same for a whole segment and live in its header next to its largest playback
+//length, which lets the leaderboard skip a segment without touching its columns
+//the reader maps the file and queries run on the columns in place, one segment per task, nothing is copied out
+
+static_assert(std::endian::native == std::endian::little, "history files are little endian");
+
+constexpr char HISTORY_MAGIC[8] = { 'S', 'I', 'M', 'O', 'N', 'H', 'I', 'S' };
+constexpr uint32_t HISTORY_VERSION = 1;
+//"HSEG" as little endian bytes
+constexpr uint32_t SEGMENT_MAGIC = 0x47455348;
+
+//reaction times are stored in whole milliseconds, anything slower is stored as this
+constexpr uint32_t MAX_REACTION_MILLISECONDS = UINT16_MAX;
+
+struct HistoryHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t segmentHeaderBytes;
+	uint8_t reserved[48];
+};
+
+static_assert(sizeof(HistoryHeader) == 64);
+
+struct HistorySegmentHeader
+{
+	uint32_t magic;
+	uint32_t games;
+	uint64_t presses;
+	//the header and every column, a multiple of 64
+	uint64_t segmentBytes;
+	uint32_t buttonLitMicroseconds;
+	uint32_t allButtonsOffMicroseconds;
+	uint32_t gameStateChangedMicroseconds;
+	uint32_t maxPlaybackLength;
+	uint8_t reserved[20];
+	//covers every field above, never 0, a segment whose header is torn or still zero ends the file
+	uint32_t checksum;
+};
+
+static_assert(sizeof(HistorySegmentHeader) == 64);
+
+//the columns of one segment, pointing into the mapped file
+struct HistorySegment
+{
+	const HistorySegmentHeader* header;
+	const uint64_t* seed;
+	const uint64_t* gameNumber;
+	const uint32_t* playbackLength;
+	const int32_t* failureStep;
+	//presses of games [0, i] of the segment, so game i's are reactionMilliseconds[pressEnd[i - 1], pressEnd[i])
+	const uint32_t* pressEnd;
+	const uint16_t* reactionMilliseconds;
+};
+
+//one game as it is appended
+struct HistoryGame
+{
+	uint64_t seed;
+	uint64_t gameNumber;
+	uint32_t playbackLength;
+	int32_t failureStep;
+	uint32_t buttonLitMicroseconds;
+	uint32_t allButtonsOffMicroseconds;
+	uint32_t gameStateChangedMicroseconds;
+	const uint16_t* reactionMilliseconds;
+	uint32_t presses;
+};
+
+class GameHistoryWriter
+{
+public:
+	//games per segment, a segment is written once it is full or the timings change
+	static constexpr uint32_t SEGMENT_GAMES = 1 << 16;
+	//a segment is also written once its presses reach this, so reaction columns stay a few megabytes
+	static constexpr uint32_t SEGMENT_PRESSES = 1 << 22;
+	//games Observe() sees are also written once a segment holds this many, or the first of them ended this long
+	//before the last, a crash then costs the game in progress and at most one short segment
+	static constexpr uint32_t LIVE_SEGMENT_GAMES = 256;
+	static constexpr int64_t LIVE_SEGMENT_SECONDS = 5;
+
+	GameHistoryWriter() noexcept = default;
+	~GameHistoryWriter();
+
+	GameHistoryWriter(const GameHistoryWriter&) = delete;
+	GameHistoryWriter& operator=(const GameHistoryWriter&) = delete;
+
+	//appends to path, creating it if needed, a segment a crash left half written is cut off first
+	//frequency is that of the clock the games Observe() sees run on
+	//false if the file cannot be opened or is not a history file
+	[[nodiscard]]
+	bool Open(const char* path, int64_t frequency) noexcept;
+
+	//writes the segment in progress and closes, false if anything failed to reach the file
+	bool Close() noexcept;
+
+	[[nodiscard]]
+	bool IsOpen() const noexcept { return file != nullptr; }
+
+	void Append(const HistoryGame& game) noexcept;
+
+	//called after every input event game was ticked with, picks up the reaction time of each press and
+	//appends each game that ended, game has to be fresh out of its constructor when first observed,
+	//a game still in progress when the writer closes is not written
+	void Observe(const GameCore& game) noexcept;
+
+	//this session, the ones not yet in a segment included
+	[[nodiscard]]
+	uint64_t GamesAppended() const noexcept { return gamesAppended; }
+
+private:
+	void WriteSegment() noexcept;
+
+	FILE* file = nullptr;
+	bool bFailed = false;
+	int64_t frequency = 1;
+	uint64_t gamesAppended = 0;
+
+	HistorySegmentHeader segment = {};
+	std::vector<uint64_t> seeds;
+	std::vector<uint64_t> gameNumbers;
+	std::vector<uint32_t> playbackLengths;
+	std::vector<int32_t> failureSteps;
+	std::vector<uint32_t> pressEnds;
+	std::vector<uint16_t> reactions;
+
+	//what Observe() has seen of the game so far, and the reactions of the game in progress
+	uint64_t observedPresses = 0;
+	uint64_t observedGames = 0;
+	//when the first game of the segment in progress ended, in ticks of frequency
+	int64_t segmentStartTime = 0;
+	std::vector<uint16_t> currentReactions;
+};
+
+//how often each value occurred, counts[v] for value v
+struct Histogram
+{
+	std::vector<uint64_t> counts;
+	uint64_t total = 0;
+
+	//smallest value at or below which at least fraction of the samples lie, 0 if there are none
+	[[nodiscard]]
+	uint32_t Percentile(double fraction) const noexcept;
+};
+
+struct PositionErrors
+{
+	//presses made at this step of a round, over every round of every game
+	uint64_t presses;
+	//games that ended with a wrong press here
+	uint64_t errors;
+};
+
+struct LeaderboardEntry
+{
+	uint32_t score;
+	uint64_t seed;
+	uint64_t gameNumber;
+	//position in the file, ties go to the earlier game
+	uint64_t index;
+};
+
+class GameHistoryReader
+{
+public:
+	GameHistoryReader() noexcept = default;
+	~GameHistoryReader();
+
+	GameHistoryReader(const GameHistoryReader&) = delete;
+	GameHistoryReader& operator=(const GameHistoryReader&) = delete;
+
+	//maps path read only and indexes its segments, stopping at the first one that is torn
+	//false if the file cannot be mapped or is not a history file
+	[[nodiscard]]
+	bool Open(const char* path) noexcept;
+
+	void Close() noexcept;
+
+	[[nodiscard]]
+	uint64_t Games() const noexcept { return games; }
+
+	[[nodiscard]]
+	uint64_t Presses() const noexcept { return presses; }
+
+	[[nodiscard]]
+	const std::vector<HistorySegment>& Segments() const noexcept { return segments; }
+
+	//every query below runs one segment per task on pool and merges per worker results at the end
+
+	//scores, rounds completed, of every game
+	[[nodiscard]]
+	Histogram ScoreHistogram(WorkStealingPool& pool) const noexcept;
+
+	//reaction times of every press in milliseconds
+	[[nodiscard]]
+	Histogram ReactionHistogram(WorkStealingPool& pool) const noexcept;
+
+	//by step of the round, presses and the misses among them, the error rate is errors / presses
+	[[nodiscard]]
+	std::vector<PositionErrors> PositionErrorRates(WorkStealingPool& pool) const noexcept;
+
+	//the best count games by score, best first
+	[[nodiscard]]
+	std::vector<LeaderboardEntry> TopScores(WorkStealingPool& pool, uint32_t count) const noexcept;
+
+private:
+	const uint8_t* view = nullptr;
+	uint64_t viewBytes = 0;
+	uint64_t games = 0;
+	uint64_t presses = 0;
+	uint32_t maxPlaybackLength = 0;
+	std::vector<HistorySegment> segments;
+	//index of the first game of each segment
+	std::vector<uint64_t> firstGame;
+};
@@ -0,0 +1,53 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+//fixed size binary messages between the game server and its players, every message is one
+//WireMessage in host byte order, which both ends share since they only run little endian
+
+static_assert(std::endian::native == std::endian::little, "the wire format is little endian");
+
+enum class MessageType : uint8_t
+{
+	//client to server
+	Start = 1,
+	Press = 2,
+	Menu = 3,
+
+	//server to client
+	Lit = 16,
+	InputPhase = 17,
+	Verdict = 18
+};
+
+enum class Verdict : uint8_t
+{
+	Correct,
+	RoundComplete,
+	Wrong,
+	//pressed while the sequence was playing back or outside a game
+	Ignored
+};
+
+struct WireMessage
+{
+	MessageType type;
+	//Press, Lit: the button, NO_BUTTON turns every button off
+	uint8_t button;
+	//Verdict only
+	Verdict verdict;
+	uint8_t reserved;
+	//InputPhase: sequence length, Verdict: score after the press
+	uint32_t value;
+	//Press: any value chosen by the client, echoed back in its Verdict to measure latency
+	uint64_t tag;
+};
+
+static_assert(sizeof(WireMessage) == 16);
@@ -0,0 +1,506 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "GameServer.h"
+
+#ifdef __linux__
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+	//epoll tags, anything below LISTEN_TAG is a session index
+	constexpr uint64_t TIMER_TAG = ~0ull;
+	constexpr uint64_t STOP_TAG = ~0ull - 1;
+	constexpr uint64_t LISTEN_TAG = 1ull << 63;
+
+	constexpr int MAX_EVENTS = 256;
+
+	//a client that stops reading is dropped once this much is queued for it, a few hundred messages, far past
+	//anything a client keeping up leaves behind in a moment its socket buffer is full
+	constexpr size_t MAX_PENDING_BYTES = 4096;
+
+	//playback deadlines are hundreds of milliseconds apart, a millisecond of slack is invisible
+	constexpr int64_t TIMER_RESOLUTION = 1'000'000;
+
+	void AddToEpoll(int epollFd, int fd, uint32_t events, uint64_t tag) noexcept
+	{
+		epoll_event event =
+		{
+			.events = events,
+			.data = {.u64 = tag }
+		};
+		FATAL_ON_NEGATIVE(epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event));
+	}
+}
+
+GameServer::GameServer(const GameTimings& timings, uint64_t seed) noexcept :
+	timings(timings),
+	seed(seed),
+	scheduler(TIMER_RESOLUTION, clock.Now())
+{
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	FATAL_ON_NEGATIVE(epollFd);
+
+	timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	FATAL_ON_NEGATIVE(timerFd);
+
+	stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	FATAL_ON_NEGATIVE(stopFd);
+
+	reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	FATAL_ON_NEGATIVE(reserveFd);
+
+	AddToEpoll(epollFd, timerFd, EPOLLIN, TIMER_TAG);
+	AddToEpoll(epollFd, stopFd, EPOLLIN, STOP_TAG);
+}
+
+GameServer::~GameServer()
+{
+	for (const Session& session : sessions)
+	{
+		if (session.fd >= 0)
+			close(session.fd);
+	}
+
+	for (int listenFd : listenFds)
+		close(listenFd);
+
+	if (reserveFd >= 0)
+		close(reserveFd);
+	close(stopFd);
+	close(timerFd);
+	close(epollFd);
+}
+
+void GameServer::ListenTcp(uint16_t port) noexcept
+{
+	const int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	FATAL_ON_NEGATIVE(listenFd);
+
+	const int one = 1;
+	FATAL_ON_NEGATIVE(setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)));
+
+	sockaddr_in address =
+	{
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr = {.s_addr = htonl(INADDR_LOOPBACK) }
+	};
+
+	FATAL_ON_NEGATIVE(bind(listenFd, (const sockaddr*)&address, sizeof(address)));
+	FATAL_ON_NEGATIVE(listen(listenFd, SOMAXCONN));
+
+	AddToEpoll(epollFd, listenFd, EPOLLIN, LISTEN_TAG | listenFds.size());
+	listenFds.push_back(listenFd);
+}
+
+void GameServer::ListenUnix(const char* path) noexcept
+{
+	const int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	FATAL_ON_NEGATIVE(listenFd);
+
+	sockaddr_un address = { .sun_family = AF_UNIX };
+	//a cut off path would be bound somewhere else than the one unlinked and asked for
+	if (strlen(path) >= sizeof(address.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		FATAL_ON_ERRNO_IMPL("strlen(path) < sizeof(address.sun_path)", __LINE__);
+	}
+	memcpy(address.sun_path, path, strlen(path) + 1);
+
+	//a socket file left behind by an earlier run would make bind fail
+	unlink(path);
+
+	FATAL_ON_NEGATIVE(bind(listenFd, (const sockaddr*)&address, sizeof(address)));
+	FATAL_ON_NEGATIVE(listen(listenFd, SOMAXCONN));
+
+	AddToEpoll(epollFd, listenFd, EPOLLIN, LISTEN_TAG | listenFds.size());
+	listenFds.push_back(listenFd);
+}
+
+void GameServer::Run() noexcept
+{
+	epoll_event events[MAX_EVENTS];
+
+	while (true)
+	{
+		const int eventCount = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+		if (eventCount < 0 && errno == EINTR)
+			continue;
+		FATAL_ON_NEGATIVE(eventCount);
+
+		stats.wakeups++;
+
+		const int64_t now = clock.Now();
+
+		for (int i = 0; i < eventCount; i++)
+		{
+			const uint64_t tag = events[i].data.u64;
+
+			if (tag == STOP_TAG)
+				return;
+
+			if (tag == TIMER_TAG)
+			{
+				uint64_t expirations;
+				if (read(timerFd, &expirations, sizeof(expirations)) == sizeof(expirations))
+					armedDeadline = NO_DEADLINE;
+				continue;
+			}
+
+			if (tag & LISTEN_TAG)
+			{
+				Accept(listenFds[tag & ~LISTEN_TAG]);
+				continue;
+			}
+
+			const uint32_t session = (uint32_t)tag;
+
+			if (events[i].events & (EPOLLHUP | EPOLLERR))
+			{
+				Close(session);
+				continue;
+			}
+
+			if (events[i].events & EPOLLOUT)
+				Flush(session);
+
+			if (events[i].events & EPOLLIN)
+				Receive(session);
+		}
+
+		RunTimers(now);
+		ArmTimer();
+	}
+}
+
+void GameServer::Stop() noexcept
+{
+	//only write is signal safe here, and the one way it fails is a counter already far past waking Run()
+	const uint64_t one = 1;
+	const ssize_t written = write(stopFd, &one, sizeof(one));
+	(void)written;
+}
+
+void GameServer::Accept(int listenFd) noexcept
+{
+	while (true)
+	{
+		const int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0 && (errno == EMFILE || errno == ENFILE))
+		{
+			//out of descriptors, the spare one makes room to accept the connection and turn it away
+			if (reserveFd >= 0)
+			{
+				close(reserveFd);
+				const int refused = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+				if (refused >= 0)
+				{
+					close(refused);
+					stats.sessionsRefused++;
+				}
+				reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+				if (refused >= 0 && reserveFd >= 0)
+					continue;
+				if (reserveFd >= 0)
+					return;
+			}
+
+			//another process took the spare, nothing more is accepted until a session closes
+			SetListening(false);
+			return;
+		}
+
+		if (fd < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+				FATAL_ON_NEGATIVE(fd);
+			return;
+		}
+
+		//verdicts are single small messages, they should not wait for more data
+		const int one = 1;
+		(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+		uint32_t session;
+		if (freeSessions.empty())
+		{
+			session = (uint32_t)sessions.size();
+			sessions.emplace_back();
+		}
+		else
+		{
+			session = freeSessions.back();
+			freeSessions.pop_back();
+		}
+
+		Session& newSession = sessions[session];
+		newSession.fd = fd;
+		newSession.game = std::make_unique<GameTimeline>(scheduler, timings, SplitMix64(seed + stats.sessionsAccepted), session);
+		newSession.readLength = 0;
+		newSession.pendingWrites.clear();
+
+		AddToEpoll(epollFd, fd, EPOLLIN | EPOLLRDHUP, session);
+
+		stats.sessionsAccepted++;
+		liveSessions++;
+		stats.peakSessions = std::max(stats.peakSessions, liveSessions);
+	}
+}
+
+void GameServer::SetListening(bool bListening) noexcept
+{
+	bListenPaused = !bListening;
+
+	for (size_t i = 0; i < listenFds.size(); i++)
+	{
+		epoll_event event =
+		{
+			.events = bListening ? (uint32_t)EPOLLIN : 0u,
+			.data = {.u64 = LISTEN_TAG | i }
+		};
+		FATAL_ON_NEGATIVE(epoll_ctl(epollFd, EPOLL_CTL_MOD, listenFds[i], &event));
+	}
+}
+
+void GameServer::Close(uint32_t session) noexcept
+{
+	Session& closing = sessions[session];
+	if (closing.fd < 0)
+		return;
+
+	//closing the descriptor also removes it from the epoll set
+	//the game stays around until the slot is reused, callers up the stack may still be looking at it
+	close(closing.fd);
+	closing.fd = -1;
+	closing.pendingWrites.clear();
+	closing.game->Stop();
+
+	freeSessions.push_back(session);
+	liveSessions--;
+
+	//the descriptor just freed makes a new spare
+	if (bListenPaused)
+	{
+		if (reserveFd < 0)
+			reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+		SetListening(true);
+	}
+}
+
+void GameServer::Receive(uint32_t session) noexcept
+{
+	while (sessions[session].fd >= 0)
+	{
+		Session& receiving = sessions[session];
+
+		uint8_t buffer[64 * sizeof(WireMessage)];
+		const ssize_t received = recv(receiving.fd, buffer, sizeof(buffer), 0);
+
+		if (received == 0)
+		{
+			Close(session);
+			return;
+		}
+
+		if (received < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				Close(session);
+			return;
+		}
+
+		const int64_t now = clock.Now();
+
+		for (ssize_t offset = 0; offset < received && sessions[session].fd >= 0;)
+		{
+			Session& parsing = sessions[session];
+
+			const size_t copied = std::min((size_t)(received - offset), sizeof(WireMessage) - parsing.readLength);
+			memcpy(parsing.readBuffer + parsing.readLength, buffer + offset, copied);
+			parsing.readLength += (uint32_t)copied;
+			offset += copied;
+
+			if (parsing.readLength == sizeof(WireMessage))
+			{
+				WireMessage message;
+				memcpy(&message, parsing.readBuffer, sizeof(message));
+				parsing.readLength = 0;
+
+				stats.messagesReceived++;
+				Handle(session, message, now);
+			}
+		}
+
+		if (received < (ssize_t)sizeof(buffer))
+			return;
+	}
+}
+
+void GameServer::Handle(uint32_t session, const WireMessage& message, int64_t now) noexcept
+{
+	GameTimeline& game = *sessions[session].game;
+
+	switch (message.type)
+	{
+	case MessageType::Start:
+		game.Start(now);
+		break;
+	case MessageType::Press:
+	{
+		const Verdict verdict = game.Press(message.button, now);
+		Send(session, { .type = MessageType::Verdict, .button = message.button, .verdict = verdict, .value = (uint32_t)game.Score(), .tag = message.tag });
+		break;
+	}
+	case MessageType::Menu:
+		game.ReturnToMenu();
+		break;
+	default:
+		//unknown messages are a broken or hostile client
+		Close(session);
+		return;
+	}
+
+	Publish(session);
+}
+
+void GameServer::Publish(uint32_t session) noexcept
+{
+	GameTimeline& game = *sessions[session].game;
+	const uint32_t changes = game.TakeChanges();
+
+	if (changes & TIMELINE_CHANGE_LIT)
+		Send(session, { .type = MessageType::Lit, .button = (uint8_t)game.LitButton() });
+
+	if (changes & TIMELINE_CHANGE_INPUT_PHASE)
+		Send(session, { .type = MessageType::InputPhase, .value = (uint32_t)game.PlaybackLength() });
+}
+
+void GameServer::Send(uint32_t session, const WireMessage& message) noexcept
+{
+	Session& sending = sessions[session];
+	if (sending.fd < 0)
+		return;
+
+	stats.messagesSent++;
+
+	const uint8_t* bytes = (const uint8_t*)&message;
+	size_t unsent = sizeof(message);
+
+	//anything already queued has to go out first
+	if (sending.pendingWrites.empty())
+	{
+		const ssize_t sent = send(sending.fd, bytes, unsent, MSG_NOSIGNAL);
+		if (sent == (ssize_t)unsent)
+			return;
+
+		if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			Close(session);
+			return;
+		}
+
+		if (sent > 0)
+		{
+			bytes += sent;
+			unsent -= sent;
+		}
+
+		epoll_event event =
+		{
+			.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP,
+			.data = {.u64 = session }
+		};
+		FATAL_ON_NEGATIVE(epoll_ctl(epollFd, EPOLL_CTL_MOD, sending.fd, &event));
+	}
+
+	if (sending.pendingWrites.size() + unsent > MAX_PENDING_BYTES)
+	{
+		stats.sessionsDropped++;
+		Close(session);
+		return;
+	}
+
+	sending.pendingWrites.insert(sending.pendingWrites.end(), bytes, bytes + unsent);
+}
+
+void GameServer::Flush(uint32_t session) noexcept
+{
+	Session& flushing = sessions[session];
+	if (flushing.fd < 0 || flushing.pendingWrites.empty())
+		return;
+
+	const ssize_t sent = send(flushing.fd, flushing.pendingWrites.data(), flushing.pendingWrites.size(), MSG_NOSIGNAL);
+
+	if (sent < 0)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			Close(session);
+		return;
+	}
+
+	flushing.pendingWrites.erase(flushing.pendingWrites.begin(), flushing.pendingWrites.begin() + sent);
+
+	if (flushing.pendingWrites.empty())
+	{
+		epoll_event event =
+		{
+			.events = EPOLLIN | EPOLLRDHUP,
+			.data = {.u64 = session }
+		};
+		FATAL_ON_NEGATIVE(epoll_ctl(epollFd, EPOLL_CTL_MOD, flushing.fd, &event));
+	}
+}
+
+void GameServer::RunTimers(int64_t now) noexcept
+{
+	//closed sessions stop their timeline, so everything resumed here is live
+	scheduler.Advance(now, [&](uint64_t session)
+		{
+			stats.timerTicks++;
+			Publish((uint32_t)session);
+		});
+}
+
+void GameServer::ArmTimer() noexcept
+{
+	//timers in the upper levels only give a lower bound, that costs at most a spurious wakeup per cascade
+	const int64_t deadline = scheduler.NextExpiry();
+	if (deadline == armedDeadline)
+		return;
+
+	const int64_t expiry = deadline == NO_DEADLINE ? 0 : std::max(deadline, (int64_t)1);
+
+	itimerspec timerSpec =
+	{
+		.it_interval = {},
+		.it_value =
+		{
+			.tv_sec = (time_t)(expiry / 1'000'000'000),
+			.tv_nsec = (long)(expiry % 1'000'000'000)
+		}
+	};
+
+	FATAL_ON_NEGATIVE(timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &timerSpec, nullptr));
+	armedDeadline = deadline;
+}
+
+#endif
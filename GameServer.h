@@ -0,0 +1,107 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "GameProtocol.h"
+#include "GameTimeline.h"
+#include "SimonCore.h"
+#include "Timeline.h"
+
+#ifdef __linux__
+
+struct ServerStats
+{
+	uint64_t sessionsAccepted;
+	//connections accepted and closed straight away because descriptors ran out
+	uint64_t sessionsRefused;
+	//sessions closed because the client stopped reading what was sent to it
+	uint64_t sessionsDropped;
+	uint64_t peakSessions;
+	uint64_t messagesReceived;
+	uint64_t messagesSent;
+	uint64_t timerTicks;
+	uint64_t wakeups;
+};
+
+//one game per connection, all driven from a single non-blocking epoll loop
+//every game is a GameTimeline sleeping on one scheduler whose next expiry arms a timerfd, times are SteadyClock ticks
+class GameServer
+{
+public:
+	GameServer(const GameTimings& timings, uint64_t seed) noexcept;
+	~GameServer();
+
+	GameServer(const GameServer&) = delete;
+	GameServer& operator=(const GameServer&) = delete;
+
+	//loopback only, this is meant for kiosks on the same host or a local proxy
+	void ListenTcp(uint16_t port) noexcept;
+	void ListenUnix(const char* path) noexcept;
+
+	//serves until Stop() is called
+	void Run() noexcept;
+
+	//safe to call from any thread and from a signal handler
+	void Stop() noexcept;
+
+	[[nodiscard]]
+	const ServerStats& Stats() const noexcept { return stats; }
+
+private:
+	struct Session
+	{
+		int fd = -1;
+		//timelines point into themselves, so they live behind a pointer while the session vector grows
+		std::unique_ptr<GameTimeline> game;
+		uint32_t readLength = 0;
+		uint8_t readBuffer[sizeof(WireMessage)];
+		//bytes the socket would not take yet
+		std::vector<uint8_t> pendingWrites;
+	};
+
+	void Accept(int listenFd) noexcept;
+	//takes the listen sockets out of epoll_wait or puts them back
+	void SetListening(bool bListening) noexcept;
+	void Close(uint32_t session) noexcept;
+	void Receive(uint32_t session) noexcept;
+	void Flush(uint32_t session) noexcept;
+	void Handle(uint32_t session, const WireMessage& message, int64_t now) noexcept;
+
+	//tells the client what visibly changed since the last call
+	void Publish(uint32_t session) noexcept;
+	void Send(uint32_t session, const WireMessage& message) noexcept;
+	void RunTimers(int64_t now) noexcept;
+	void ArmTimer() noexcept;
+
+	GameTimings timings;
+	uint64_t seed;
+	SteadyClock clock;
+
+	int epollFd = -1;
+	int timerFd = -1;
+	int stopFd = -1;
+	std::vector<int> listenFds;
+	//given up when descriptors run out, so the connection waiting in the backlog can be accepted and closed
+	//instead of waking the level triggered listen socket again and again
+	int reserveFd = -1;
+	bool bListenPaused = false;
+	int64_t armedDeadline = NO_DEADLINE;
+
+	std::vector<Session> sessions;
+	std::vector<uint32_t> freeSessions;
+	uint64_t liveSessions = 0;
+
+	TimelineScheduler scheduler;
+
+	ServerStats stats = {};
+};
+
+#endif
@@ -0,0 +1,124 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "GameTimeline.h"
+
+#include <algorithm>
+
+GameTimeline::GameTimeline(TimelineScheduler& scheduler, const GameTimings& timings, uint64_t seed, uint64_t context) noexcept :
+	scheduler(scheduler),
+	timings(timings),
+	seed(seed),
+	sequence(CounterRng::ForStream(seed, 0)),
+	context(context),
+	task(Run())
+{
+	task.Start(context);
+}
+
+bool GameTimeline::Start(int64_t now) noexcept
+{
+	return starts.Signal(now);
+}
+
+Verdict GameTimeline::Press(int button, int64_t now) noexcept
+{
+	if (button < 0 || button >= BUTTON_COUNT || !presses.Waiting())
+		return Verdict::Ignored;
+
+	//the coroutine judges the press and runs on to its next suspension before this returns
+	presses.Signal({ .button = button, .now = now });
+	return lastVerdict;
+}
+
+void GameTimeline::ReturnToMenu() noexcept
+{
+	//replacing the task destroys the old frame, which cancels its sleep or input wait
+	task = Run();
+
+	SetLit(NO_BUTTON);
+	playbackLength = 1;
+	bOutstandingTimer = false;
+	NextSequence();
+
+	task.Start(context);
+}
+
+void GameTimeline::Stop() noexcept
+{
+	task = {};
+}
+
+void GameTimeline::SetLit(int button) noexcept
+{
+	if (button != litButton)
+		changes |= TIMELINE_CHANGE_LIT;
+	litButton = button;
+}
+
+void GameTimeline::NextSequence() noexcept
+{
+	gameNumber++;
+	sequence = CounterRng::ForStream(seed, gameNumber);
+}
+
+TimelineTask GameTimeline::Run() noexcept
+{
+	//sleeps end once the clock is strictly past the timer, like GameCore's CurrentTimerFinished
+	while (true)
+	{
+		gameState = GAME_STATE_MENU;
+		int64_t now = co_await starts;
+		gameState = GAME_STATE_PLAYBACK;
+
+		//one pass per sequence, a miss starts a new one
+		while (true)
+		{
+			bOutstandingTimer = true;
+			now = co_await scheduler.SleepUntil(now + timings.GameStateChangedTicks + 1);
+			bOutstandingTimer = false;
+
+			bool bMissed = false;
+			while (!bMissed)
+			{
+				for (int step = 0; step < playbackLength; step++)
+				{
+					SetLit(ButtonAt(step));
+					now = co_await scheduler.SleepUntil(now + timings.ButtonLitTicks + 1);
+					SetLit(NO_BUTTON);
+
+					//input opens as soon as the last button goes off
+					if (step + 1 < playbackLength)
+						now = co_await scheduler.SleepUntil(now + timings.AllButtonsOffTicks + 1);
+				}
+
+				gameState = GAME_STATE_INPUT;
+				changes |= TIMELINE_CHANGE_INPUT_PHASE;
+
+				for (int step = 0; step < playbackLength && !bMissed; step++)
+				{
+					const TimelinePress press = co_await presses;
+					now = press.now;
+
+					bMissed = press.button != ButtonAt(step);
+					lastVerdict = bMissed ? Verdict::Wrong : step + 1 == playbackLength ? Verdict::RoundComplete : Verdict::Correct;
+				}
+
+				gameState = GAME_STATE_PLAYBACK;
+
+				if (!bMissed)
+				{
+					bestScore = std::max(bestScore, playbackLength);
+					playbackLength++;
+					now = co_await scheduler.SleepUntil(now + timings.ButtonLitTicks + 1);
+				}
+			}
+
+			playbackLength = 1;
+			NextSequence();
+		}
+	}
+}
@@ -0,0 +1,109 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+#include "CounterRng.h"
+#include "GameProtocol.h"
+#include "SimonCore.h"
+#include "Timeline.h"
+
+//what TakeChanges() reports, so a front end only redraws or sends what moved
+enum TimelineChange : uint32_t
+{
+	TIMELINE_CHANGE_LIT = 1,
+	TIMELINE_CHANGE_INPUT_PHASE = 2
+};
+
+//the lit, off and await-input timeline of one game written as a coroutine, it behaves like a GameCore
+//ticked at its deadlines but only runs when a sleep ends or a press or start arrives
+//the coroutine points back at this object, so it stays where it was constructed
+class GameTimeline
+{
+public:
+	//context comes back from TimelineScheduler::Advance whenever this timeline was resumed
+	GameTimeline(TimelineScheduler& scheduler, const GameTimings& timings, uint64_t seed, uint64_t context) noexcept;
+
+	GameTimeline(const GameTimeline&) = delete;
+	GameTimeline& operator=(const GameTimeline&) = delete;
+
+	//Play in the menu, false when a game is already running
+	bool Start(int64_t now) noexcept;
+
+	//only presses of a button while input is open are judged
+	[[nodiscard]]
+	Verdict Press(int button, int64_t now) noexcept;
+
+	void ReturnToMenu() noexcept;
+
+	//ends the timeline for good and cancels its pending sleep
+	void Stop() noexcept;
+
+	//changes since the last call, see TimelineChange
+	[[nodiscard]]
+	uint32_t TakeChanges() noexcept { return std::exchange(changes, 0); }
+
+	[[nodiscard]]
+	int State() const noexcept { return gameState; }
+
+	//what GameCore::DisplayedLitButton(NO_BUTTON) would return
+	[[nodiscard]]
+	int LitButton() const noexcept { return litButton; }
+
+	//the pause after starting and after a miss
+	[[nodiscard]]
+	bool InTransition() const noexcept { return bOutstandingTimer; }
+
+	[[nodiscard]]
+	int PlaybackLength() const noexcept { return playbackLength; }
+
+	[[nodiscard]]
+	int BestScore() const noexcept { return bestScore; }
+
+	[[nodiscard]]
+	int Score() const noexcept { return playbackLength - 1; }
+
+	//same sequence as a GameCore with the same seed
+	[[nodiscard]]
+	int ButtonAt(int step) const noexcept { return step == 0 ? 1 : sequence.Button(step); }
+
+private:
+	struct TimelinePress
+	{
+		int button;
+		int64_t now;
+	};
+
+	[[nodiscard]]
+	TimelineTask Run() noexcept;
+
+	void SetLit(int button) noexcept;
+	void NextSequence() noexcept;
+
+	TimelineScheduler& scheduler;
+	GameTimings timings;
+	uint64_t seed;
+	uint64_t gameNumber = 0;
+	CounterRng sequence;
+	uint64_t context;
+
+	InputSignal<int64_t> starts;
+	InputSignal<TimelinePress> presses;
+
+	int gameState = GAME_STATE_MENU;
+	int litButton = NO_BUTTON;
+	int playbackLength = 1;
+	int bestScore = 0;
+	bool bOutstandingTimer = false;
+	Verdict lastVerdict = Verdict::Ignored;
+	uint32_t changes = 0;
+
+	//last, so the coroutine is destroyed before the signals it may be waiting on
+	TimelineTask task;
+};
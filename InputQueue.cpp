@@ -0,0 +1,92 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "InputQueue.h"
+
+#include <algorithm>
+
+#include "BoardGeometry.h"
+#include "GameHistory.h"
+#include "InputRecording.h"
+#include "StatsStore.h"
+
+GameInput PointerInput(const GameCore& game, float windowWidth, float windowHeight, float x, float y, bool clicked) noexcept
+{
+	if (game.gameState == GAME_STATE_MENU)
+		return { .hoveredMenuItem = MenuHitTest(x, y, windowWidth, windowHeight), .clicked = clicked };
+
+	//buttons only react while waiting for input
+	if (game.gameState == GAME_STATE_INPUT && !game.bOutstandingTimer)
+		return { .hoveredButton = HitTestButton(BoardLayout::FromClientSize(windowWidth, windowHeight), x, y), .clicked = clicked };
+
+	return { .clicked = clicked };
+}
+
+namespace
+{
+	//after every change to game, lets history see it and journals the game it ended, if any
+	void Observe(const GameCore& game, uint64_t finishedGames, GameHistoryWriter* history, StatsStore* statsStore, int64_t frequency) noexcept
+	{
+		if (history)
+			history->Observe(game);
+
+		if (statsStore && game.finishedGames != finishedGames)
+			statsStore->Append(game.lastFinished, frequency);
+	}
+}
+
+void DrainInput(GameCore& game, InputQueue& queue, float windowWidth, float windowHeight, int64_t now, InputLatency& latency, InputRecorder* recorder, GameHistoryWriter* history, StatsStore* statsStore, int64_t frequency) noexcept
+{
+	InputEvent event;
+
+	while (queue.TryPop(event))
+	{
+		const uint64_t finishedGames = game.finishedGames;
+
+		switch (event.type)
+		{
+		case InputEventType::Click:
+		{
+			const GameInput input = PointerInput(game, windowWidth, windowHeight, event.x, event.y, true);
+			if (recorder)
+				recorder->Tick(game, event.timestamp, input);
+			else
+				game.Tick(event.timestamp, input);
+			break;
+		}
+		case InputEventType::Escape:
+			if (recorder)
+				recorder->ReturnToMenu(game, event.timestamp);
+			else
+				game.ReturnToMenu(event.timestamp);
+			break;
+		}
+
+		//an event ends at most one game
+		Observe(game, finishedGames, history, statsStore, frequency);
+
+		const int64_t eventLatency = now - event.timestamp;
+
+		latency.events++;
+		latency.totalTicks += eventLatency;
+		latency.maxTicks = std::max(latency.maxTicks, eventLatency);
+	}
+}
+
+void EndGameInProgress(GameCore& game, int64_t now, InputRecorder* recorder, GameHistoryWriter* history, StatsStore* statsStore, int64_t frequency) noexcept
+{
+	if (game.gameState == GAME_STATE_MENU)
+		return;
+
+	const uint64_t finishedGames = game.finishedGames;
+
+	if (recorder)
+		recorder->ReturnToMenu(game, now);
+	else
+		game.ReturnToMenu(now);
+
+	Observe(game, finishedGames, history, statsStore, frequency);
+}
@@ -0,0 +1,121 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "SimonCore.h"
+
+//pointer and key events are queued with the position and time they happened at,
+//so the game judges every click in order instead of the cursor position at paint time
+
+enum class InputEventType : int
+{
+	Click,
+	Escape
+};
+
+struct InputEvent
+{
+	InputEventType type;
+	float x;
+	float y;
+	//GameClock ticks when the event was received
+	int64_t timestamp;
+};
+
+//lock-free ring for exactly one producer thread and one consumer thread
+template<typename T, size_t Capacity>
+class SpscRing
+{
+	static_assert(std::has_single_bit(Capacity), "capacity must be a power of two");
+
+public:
+	//producer only, false if the ring is full and the value was dropped
+	[[nodiscard]]
+	bool TryPush(const T& value) noexcept
+	{
+		const size_t currentTail = tail.load(std::memory_order_relaxed);
+
+		if (currentTail - cachedHead == Capacity)
+		{
+			cachedHead = head.load(std::memory_order_acquire);
+			if (currentTail - cachedHead == Capacity)
+			{
+				droppedCount++;
+				return false;
+			}
+		}
+
+		slots[currentTail & (Capacity - 1)] = value;
+		tail.store(currentTail + 1, std::memory_order_release);
+		return true;
+	}
+
+	//consumer only, false if the ring is empty
+	[[nodiscard]]
+	bool TryPop(T& value) noexcept
+	{
+		const size_t currentHead = head.load(std::memory_order_relaxed);
+
+		if (currentHead == cachedTail)
+		{
+			cachedTail = tail.load(std::memory_order_acquire);
+			if (currentHead == cachedTail)
+				return false;
+		}
+
+		value = slots[currentHead & (Capacity - 1)];
+		head.store(currentHead + 1, std::memory_order_release);
+		return true;
+	}
+
+	//producer only
+	[[nodiscard]]
+	uint64_t DroppedCount() const noexcept { return droppedCount; }
+
+private:
+	//each side only writes its own cache line, the cached copy of the other index saves most cross-core loads
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> head = 0;
+	size_t cachedTail = 0;
+
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail = 0;
+	size_t cachedHead = 0;
+	uint64_t droppedCount = 0;
+
+	alignas(CACHE_LINE_SIZE) T slots[Capacity];
+};
+
+using InputQueue = SpscRing<InputEvent, 256>;
+
+//time from an event being queued to the game judging it
+struct InputLatency
+{
+	uint64_t events = 0;
+	int64_t totalTicks = 0;
+	int64_t maxTicks = 0;
+};
+
+//what the pointer is over at (x, y) in the current game state
+[[nodiscard]]
+GameInput PointerInput(const GameCore& game, float windowWidth, float windowHeight, float x, float y, bool clicked) noexcept;
+
+class InputRecorder;
+class GameHistoryWriter;
+class StatsStore;
+
+//ticks the game once per queued event at the event's timestamp, oldest first, through recorder if there is one,
+//history if any observes the game after every event, statsStore if any journals every game an event ends,
+//a miss and an escape in one drain end two, with durations in ticks of frequency
+void DrainInput(GameCore& game, InputQueue& queue, float windowWidth, float windowHeight, int64_t now, InputLatency& latency, InputRecorder* recorder = nullptr, GameHistoryWriter* history = nullptr, StatsStore* statsStore = nullptr, int64_t frequency = 1) noexcept;
+
+//returns to the menu if a game is running, the way an escape would, so a game cut short by quitting is still
+//recorded, observed and journaled like any other
+void EndGameInProgress(GameCore& game, int64_t now, InputRecorder* recorder = nullptr, GameHistoryWriter* history = nullptr, StatsStore* statsStore = nullptr, int64_t frequency = 1) noexcept;
@@ -0,0 +1,251 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "InputRecording.h"
+
+#include <cstring>
+
+namespace
+{
+	constexpr uint8_t KIND_MASK = 7;
+
+	[[nodiscard]]
+	constexpr uint64_t ZigZag(int64_t value) noexcept
+	{
+		return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	}
+
+	[[nodiscard]]
+	constexpr int64_t UnZigZag(uint64_t value) noexcept
+	{
+		return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	}
+
+	[[nodiscard]]
+	size_t WriteVarint(uint8_t* out, uint64_t value) noexcept
+	{
+		size_t length = 0;
+		while (value >= 0x80)
+		{
+			out[length++] = (uint8_t)value | 0x80;
+			value >>= 7;
+		}
+		out[length++] = (uint8_t)value;
+		return length;
+	}
+
+	//false if the varint runs past end or over ten bytes
+	[[nodiscard]]
+	bool ReadVarint(const uint8_t*& cursor, const uint8_t* end, uint64_t& value) noexcept
+	{
+		value = 0;
+		for (int shift = 0; shift < 70 && cursor < end; shift += 7)
+		{
+			const uint8_t byte = *cursor++;
+			value |= (uint64_t)(byte & 0x7F) << shift;
+			if (byte < 0x80)
+				return true;
+		}
+		return false;
+	}
+}
+
+InputRecorder::~InputRecorder()
+{
+	(void)Close();
+}
+
+bool InputRecorder::Open(const char* path, const GameCore& game, int64_t frequency, int64_t startTime) noexcept
+{
+	(void)Close();
+
+	file = fopen(path, "wb");
+	if (file == nullptr)
+		return false;
+
+	RecordingHeader header =
+	{
+		.version = RECORDING_VERSION,
+		.bestScore = game.bestScore,
+		.seed = game.seed,
+		.frequency = frequency,
+		.startTime = startTime,
+		.buttonLitTicks = game.timings.ButtonLitTicks,
+		.allButtonsOffTicks = game.timings.AllButtonsOffTicks,
+		.gameStateChangedTicks = game.timings.GameStateChangedTicks
+	};
+	memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+
+	memcpy(buffer, &header, sizeof(header));
+	bufferLength = sizeof(header);
+	bytesWritten = 0;
+	bFailed = false;
+	lastTime = startTime;
+
+	lastState = game.gameState;
+	lastLength = game.playbackLength;
+	lastBest = game.bestScore;
+	return true;
+}
+
+bool InputRecorder::Close() noexcept
+{
+	if (file == nullptr)
+		return false;
+
+	Flush();
+	bFailed |= fclose(file) != 0;
+	file = nullptr;
+	return !bFailed;
+}
+
+void InputRecorder::Tick(GameCore& game, int64_t now, const GameInput& input) noexcept
+{
+	if (input.clicked)
+		Append((uint8_t)RecordKind::Click | (uint8_t)(input.hoveredButton << 3) | (uint8_t)((int)input.hoveredMenuItem << 6), now);
+	else
+		Append((uint8_t)RecordKind::Tick, now);
+
+	game.Tick(now, input);
+	CheckpointIfChanged(game);
+}
+
+void InputRecorder::ReturnToMenu(GameCore& game, int64_t now) noexcept
+{
+	Append((uint8_t)RecordKind::Menu, now);
+
+	game.ReturnToMenu(now);
+	CheckpointIfChanged(game);
+}
+
+void InputRecorder::Append(uint8_t tag, int64_t now) noexcept
+{
+	if (BUFFER_SIZE - bufferLength < MAX_RECORD_SIZE)
+		Flush();
+
+	//timestamps of queued clicks can be a little older than the last timer tick
+	buffer[bufferLength++] = tag;
+	bufferLength += WriteVarint(buffer + bufferLength, ZigZag(now - lastTime));
+	lastTime = now;
+}
+
+void InputRecorder::CheckpointIfChanged(const GameCore& game) noexcept
+{
+	if (game.gameState == lastState && game.playbackLength == lastLength && game.bestScore == lastBest)
+		return;
+
+	lastState = game.gameState;
+	lastLength = game.playbackLength;
+	lastBest = game.bestScore;
+
+	if (BUFFER_SIZE - bufferLength < MAX_RECORD_SIZE * 2)
+		Flush();
+
+	buffer[bufferLength++] = (uint8_t)RecordKind::Checkpoint | (uint8_t)(lastState << 3);
+	bufferLength += WriteVarint(buffer + bufferLength, (uint64_t)lastLength);
+	bufferLength += WriteVarint(buffer + bufferLength, (uint64_t)lastBest);
+}
+
+void InputRecorder::Flush() noexcept
+{
+	if (file == nullptr || bufferLength == 0)
+		return;
+
+	bFailed |= fwrite(buffer, 1, bufferLength, file) != bufferLength;
+	bytesWritten += bufferLength;
+	bufferLength = 0;
+}
+
+ReplayResult ReplayRecording(const uint8_t* data, size_t size) noexcept
+{
+	ReplayResult result = {};
+
+	RecordingHeader header;
+	if (size < sizeof(header))
+		return result;
+
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, RECORDING_MAGIC, sizeof(header.magic)) != 0 || header.version != RECORDING_VERSION)
+		return result;
+
+	const GameTimings timings =
+	{
+		.ButtonLitTicks = header.buttonLitTicks,
+		.AllButtonsOffTicks = header.allButtonsOffTicks,
+		.GameStateChangedTicks = header.gameStateChangedTicks
+	};
+
+	GameCore game(timings, header.startTime, header.seed);
+	game.bestScore = header.bestScore;
+	int64_t now = header.startTime;
+
+	const uint8_t* cursor = data + sizeof(header);
+	const uint8_t* const end = data + size;
+
+	while (cursor < end)
+	{
+		const uint8_t tag = *cursor++;
+		uint64_t value;
+
+		if ((RecordKind)(tag & KIND_MASK) == RecordKind::Checkpoint)
+		{
+			uint64_t length;
+			uint64_t best;
+			if (!ReadVarint(cursor, end, length) || !ReadVarint(cursor, end, best))
+				return result;
+
+			result.checkpoints++;
+			result.mismatches += game.gameState != (tag >> 3) || (uint64_t)game.playbackLength != length || (uint64_t)game.bestScore != best;
+			continue;
+		}
+
+		if (!ReadVarint(cursor, end, value))
+			return result;
+
+		now += UnZigZag(value);
+		result.records++;
+
+		switch ((RecordKind)(tag & KIND_MASK))
+		{
+		case RecordKind::Tick:
+			game.Tick(now, {});
+			break;
+		case RecordKind::Click:
+			game.Tick(now, { .hoveredButton = (tag >> 3) & 7, .hoveredMenuItem = (MenuItem)(tag >> 6), .clicked = true });
+			break;
+		case RecordKind::Menu:
+			game.ReturnToMenu(now);
+			break;
+		default:
+			return result;
+		}
+	}
+
+	result.bValid = true;
+	result.finalState = game.gameState;
+	result.finalScore = game.Score();
+	result.bestScore = game.bestScore;
+	return result;
+}
+
+bool ReadRecording(const char* path, std::vector<uint8_t>& data) noexcept
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+		return false;
+
+	bool bRead = fseek(file, 0, SEEK_END) == 0;
+	const long size = bRead ? ftell(file) : -1;
+	bRead &= size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+
+	if (bRead)
+	{
+		data.resize((size_t)size);
+		bRead = fread(data.data(), 1, data.size(), file) == data.size();
+	}
+
+	return fclose(file) == 0 && bRead;
+}
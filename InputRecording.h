@@ -0,0 +1,124 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "SimonCore.h"
+
+//append-only recording of everything that reached a GameCore, enough to replay a game bit for bit
+//a fixed header with the seed and timings, then one record per Tick or ReturnToMenu:
+//a tag byte and the zigzag varint time since the previous record, usually two or three bytes in all
+//whenever the state, length or best score changes a checkpoint follows, which replays are checked against
+
+static_assert(std::endian::native == std::endian::little, "recordings are little endian");
+
+constexpr char RECORDING_MAGIC[8] = { 'S', 'I', 'M', 'O', 'N', 'R', 'E', 'C' };
+constexpr uint32_t RECORDING_VERSION = 1;
+
+struct RecordingHeader
+{
+	char magic[8];
+	uint32_t version;
+	//GameCore::bestScore at the start, carried over from earlier sessions, was always 0 before they were kept
+	int32_t bestScore;
+	uint64_t seed;
+	//GameClock::Frequency() of the recorded game, timestamps are in its ticks
+	int64_t frequency;
+	//when the recorded GameCore was constructed
+	int64_t startTime;
+	int64_t buttonLitTicks;
+	int64_t allButtonsOffTicks;
+	int64_t gameStateChangedTicks;
+};
+
+static_assert(sizeof(RecordingHeader) == 64);
+
+//low three bits of the tag byte
+enum class RecordKind : uint8_t
+{
+	//a Tick without a click, only timers can change anything
+	Tick = 0,
+	//hovered button in bits 3 to 5, hovered menu item in bits 6 and 7
+	Click = 1,
+	Menu = 2,
+	//game state in bits 3 and 4, then varints of the playback length and best score, no time
+	Checkpoint = 3
+};
+
+//writes a recording through a buffer, the file only sees whole buffers
+class InputRecorder
+{
+public:
+	InputRecorder() noexcept = default;
+	~InputRecorder();
+
+	InputRecorder(const InputRecorder&) = delete;
+	InputRecorder& operator=(const InputRecorder&) = delete;
+
+	//game has to be fresh out of its constructor, called at startTime, apart from its best score
+	[[nodiscard]]
+	bool Open(const char* path, const GameCore& game, int64_t frequency, int64_t startTime) noexcept;
+
+	//flushes and closes, false if anything failed to reach the file
+	bool Close() noexcept;
+
+	[[nodiscard]]
+	bool IsOpen() const noexcept { return file != nullptr; }
+
+	//both record the call and then make it
+	void Tick(GameCore& game, int64_t now, const GameInput& input) noexcept;
+	void ReturnToMenu(GameCore& game, int64_t now) noexcept;
+
+	[[nodiscard]]
+	uint64_t BytesWritten() const noexcept { return bytesWritten + bufferLength; }
+
+private:
+	static constexpr size_t BUFFER_SIZE = 64 * 1024;
+	//the longest record, a tag and a ten byte varint
+	static constexpr size_t MAX_RECORD_SIZE = 11;
+
+	void Append(uint8_t tag, int64_t now) noexcept;
+	void CheckpointIfChanged(const GameCore& game) noexcept;
+	void Flush() noexcept;
+
+	FILE* file = nullptr;
+	bool bFailed = false;
+	uint64_t bytesWritten = 0;
+	int64_t lastTime = 0;
+
+	int lastState = GAME_STATE_MENU;
+	int lastLength = 1;
+	int lastBest = 0;
+
+	size_t bufferLength = 0;
+	uint8_t buffer[BUFFER_SIZE];
+};
+
+struct ReplayResult
+{
+	//false if the header is not a recording of this version, or a record is cut off or unknown
+	bool bValid;
+	uint64_t records;
+	uint64_t checkpoints;
+	//checkpoints the replayed game did not match
+	uint64_t mismatches;
+	int finalState;
+	int finalScore;
+	int bestScore;
+};
+
+//feeds a whole recording through a fresh GameCore as fast as it can
+[[nodiscard]]
+ReplayResult ReplayRecording(const uint8_t* data, size_t size) noexcept;
+
+[[nodiscard]]
+bool ReadRecording(const char* path, std::vector<uint8_t>& data) noexcept;
@@ -0,0 +1,139 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "LogicThread.h"
+
+#include <bit>
+
+#include "FrameProfiler.h"
+
+LogicThread::LogicThread(GameClock& clock, const GameCore& game, PublishedCallback onPublished, void* context, InputRecorder* recorder, StatsStore* statsStore, GameHistoryWriter* history, StateExporter* stateExport) noexcept :
+	clock(clock),
+	game(game),
+	onPublished(onPublished),
+	context(context),
+	recorder(recorder),
+	statsStore(statsStore),
+	history(history),
+	stateExport(stateExport),
+	eventLoop(clock)
+{
+	//the renderer may look before the thread gets going, so the starting state is there already
+	published = game.Snapshot();
+	snapshots.WriteSlot() = published;
+	snapshots.Publish();
+
+	if (stateExport)
+		stateExport->Publish(game, clock.Now());
+
+	thread = std::thread([this] { Main(); });
+}
+
+LogicThread::~LogicThread()
+{
+	Stop();
+}
+
+void LogicThread::SetSceneSize(float width, float height) noexcept
+{
+	sceneSize.store((uint64_t)std::bit_cast<uint32_t>(width) << 32 | std::bit_cast<uint32_t>(height), std::memory_order_release);
+}
+
+bool LogicThread::QueueInput(const InputEvent& event) noexcept
+{
+	if (!queue.TryPush(event))
+		return false;
+
+	eventLoop.Wake();
+	return true;
+}
+
+const GameSnapshot& LogicThread::LatestSnapshot() noexcept
+{
+	(void)snapshots.Update();
+	return snapshots.Read();
+}
+
+void LogicThread::Stop() noexcept
+{
+	if (!thread.joinable())
+		return;
+
+	bStopRequested.store(true, std::memory_order_release);
+	eventLoop.Wake();
+	thread.join();
+}
+
+void LogicThread::Publish(const GameSnapshot& snapshot) noexcept
+{
+	published = snapshot;
+	published.sequence++;
+
+	snapshots.WriteSlot() = published;
+	snapshots.Publish();
+	stats.published++;
+
+	if (onPublished)
+		onPublished(context);
+}
+
+void LogicThread::Finish() noexcept
+{
+	const int64_t now = clock.Now();
+
+	//clicks queued before the stop still count, then the game in progress ends where the player quit
+	const uint64_t size = sceneSize.load(std::memory_order_acquire);
+	DrainInput(game, queue, std::bit_cast<float>((uint32_t)(size >> 32)), std::bit_cast<float>((uint32_t)size), now, latency, recorder, history, statsStore, clock.Frequency());
+	EndGameInProgress(game, now, recorder, history, statsStore, clock.Frequency());
+
+	if (stateExport)
+		stateExport->Publish(game, now);
+}
+
+void LogicThread::Main() noexcept
+{
+	while (true)
+	{
+		(void)eventLoop.WaitUntil(game.NextDeadline());
+
+		if (bStopRequested.load(std::memory_order_acquire))
+		{
+			Finish();
+			return;
+		}
+
+		stats.wakeups++;
+
+		const int64_t now = clock.Now();
+
+		{
+			PROFILE_SCOPE(ProfilePhase::Input);
+
+			const uint64_t size = sceneSize.load(std::memory_order_acquire);
+			DrainInput(game, queue, std::bit_cast<float>((uint32_t)(size >> 32)), std::bit_cast<float>((uint32_t)size), now, latency, recorder, history, statsStore, clock.Frequency());
+		}
+
+		//deadlines can chain, the pause before playback ends exactly where the first button lights
+		while (game.NextDeadline() <= now)
+		{
+			if (recorder)
+				recorder->Tick(game, now, {});
+			else
+				game.Tick(now, {});
+			stats.ticks++;
+		}
+
+		//every wakeup, the timers move even when nothing visible does
+		if (stateExport)
+			stateExport->Publish(game, now);
+
+		GameSnapshot snapshot = game.Snapshot();
+		snapshot.sequence = published.sequence;
+
+		if (snapshot != published)
+			Publish(snapshot);
+	}
+}
@@ -0,0 +1,100 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "EventLoop.h"
+#include "GameHistory.h"
+#include "InputQueue.h"
+#include "InputRecording.h"
+#include "SimonCore.h"
+#include "StateExport.h"
+#include "StatsStore.h"
+#include "TripleBuffer.h"
+
+struct LogicStats
+{
+	uint64_t wakeups;
+	//ticks from deadlines, clicks are counted in InputLatency
+	uint64_t ticks;
+	uint64_t published;
+};
+
+//the game on a thread of its own, woken by queued input or its next deadline, it publishes a GameSnapshot
+//through a triple buffer whenever something visible changed, so a slow frame never holds up judging a
+//click and judging never holds up a frame
+class LogicThread
+{
+public:
+	//runs on the logic thread after every new snapshot, typically to ask the ui thread for a repaint
+	using PublishedCallback = void(*)(void* context);
+
+	//recorder, if any, has to be open on the same game and is only used by the logic thread until Stop()
+	//so do statsStore, which gets every game that ends, history, which also gets every press, and stateExport,
+	//which gets the state after every wakeup
+	LogicThread(GameClock& clock, const GameCore& game, PublishedCallback onPublished, void* context, InputRecorder* recorder = nullptr, StatsStore* statsStore = nullptr, GameHistoryWriter* history = nullptr, StateExporter* stateExport = nullptr) noexcept;
+	~LogicThread();
+
+	LogicThread(const LogicThread&) = delete;
+	LogicThread& operator=(const LogicThread&) = delete;
+
+	//input thread only, the scene size clicks are hit tested against
+	void SetSceneSize(float width, float height) noexcept;
+
+	//input thread only, false if the queue was full and the event dropped
+	bool QueueInput(const InputEvent& event) noexcept;
+
+	//render thread only, the newest snapshot, valid until the next call
+	[[nodiscard]]
+	const GameSnapshot& LatestSnapshot() noexcept;
+
+	//ends the game in progress as if the player went back to the menu and joins the thread, the game and
+	//stats stay readable afterwards
+	void Stop() noexcept;
+
+	//these three only once stopped
+	[[nodiscard]]
+	const LogicStats& Stats() const noexcept { return stats; }
+
+	[[nodiscard]]
+	const InputLatency& Latency() const noexcept { return latency; }
+
+	[[nodiscard]]
+	const GameCore& Game() const noexcept { return game; }
+
+private:
+	void Main() noexcept;
+	//runs once Stop() was asked for, before the thread exits
+	void Finish() noexcept;
+	void Publish(const GameSnapshot& snapshot) noexcept;
+
+	GameClock& clock;
+	GameCore game;
+	PublishedCallback onPublished;
+	void* context;
+	InputRecorder* recorder;
+	StatsStore* statsStore;
+	GameHistoryWriter* history;
+	StateExporter* stateExport;
+
+	ConditionEventLoop eventLoop;
+	InputQueue queue;
+	//both floats in one word, so they are never read from different resizes
+	std::atomic<uint64_t> sceneSize = 0;
+	std::atomic<bool> bStopRequested = false;
+
+	TripleBuffer<GameSnapshot> snapshots;
+	GameSnapshot published = {};
+
+	LogicStats stats = {};
+	InputLatency latency;
+
+	std::thread thread;
+};
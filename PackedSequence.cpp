@@ -0,0 +1,125 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "PackedSequence.h"
+
+#include "SimonCore.h"
+
+#include <cstdlib>
+#include <utility>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+
+PackedSequence::PackedSequence(const char* path) noexcept :
+	chunkShift(std::countr_zero(FILE_CHUNK_BYTES))
+{
+	fileDescriptor = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	FATAL_ON_NEGATIVE(fileDescriptor);
+
+	struct stat fileStatus;
+	FATAL_ON_NEGATIVE(fstat(fileDescriptor, &fileStatus));
+
+	//a partial trailing chunk is padded out with zeros
+	Grow(((uint64_t)fileStatus.st_size + FILE_CHUNK_BYTES - 1) / FILE_CHUNK_BYTES);
+}
+
+#endif
+
+PackedSequence::~PackedSequence()
+{
+	Release();
+}
+
+PackedSequence::PackedSequence(PackedSequence&& other) noexcept :
+	chunks(std::move(other.chunks)),
+	chunkShift(other.chunkShift),
+	fileDescriptor(std::exchange(other.fileDescriptor, -1))
+{
+	other.chunks.clear();
+}
+
+PackedSequence& PackedSequence::operator=(PackedSequence&& other) noexcept
+{
+	if (this != &other)
+	{
+		Release();
+		chunks = std::move(other.chunks);
+		other.chunks.clear();
+		chunkShift = other.chunkShift;
+		fileDescriptor = std::exchange(other.fileDescriptor, -1);
+	}
+	return *this;
+}
+
+void PackedSequence::Reserve(uint64_t stepCount) noexcept
+{
+	const uint64_t chunkSteps = (uint64_t)STEPS_PER_BYTE << chunkShift;
+	const uint64_t chunkCount = (stepCount + chunkSteps - 1) / chunkSteps;
+
+	if (chunkCount > chunks.size())
+		Grow(chunkCount);
+}
+
+void PackedSequence::Grow(uint64_t chunkCount) noexcept
+{
+	const size_t chunkBytes = (size_t)1 << chunkShift;
+
+	//push_back keeps growing the chunk table geometrically, reserving the exact count would reallocate it on
+	//every chunk
+
+#ifdef __linux__
+	if (fileDescriptor >= 0)
+	{
+		FATAL_ON_NEGATIVE(ftruncate(fileDescriptor, (off_t)(chunkCount * chunkBytes)));
+
+		while (chunks.size() < chunkCount)
+		{
+			void* view = mmap(nullptr, chunkBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, (off_t)(chunks.size() * chunkBytes));
+			if (view == MAP_FAILED)
+				FATAL_ON_ERRNO_IMPL("mmap", __LINE__);
+
+			chunks.push_back((uint8_t*)view);
+		}
+		return;
+	}
+#endif
+
+	while (chunks.size() < chunkCount)
+	{
+		uint8_t* chunk = (uint8_t*)calloc(chunkBytes, 1);
+		FATAL_ON_NULL(chunk);
+
+		chunks.push_back(chunk);
+	}
+}
+
+void PackedSequence::Release() noexcept
+{
+#ifdef __linux__
+	if (fileDescriptor >= 0)
+	{
+		for (uint8_t* chunk : chunks)
+			munmap(chunk, (size_t)1 << chunkShift);
+
+		chunks.clear();
+		close(fileDescriptor);
+		fileDescriptor = -1;
+		return;
+	}
+#endif
+
+	for (uint8_t* chunk : chunks)
+		free(chunk);
+
+	chunks.clear();
+}
@@ -0,0 +1,87 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//button sequence at 2 bits per step, 4 steps per byte
+//grows one fixed size chunk at a time so existing steps never move and lookups stay O(1)
+//steps that were never written read as 0
+//the game regenerates its sequence from a seed (CounterRng.h) and no longer stores it, this is kept for
+//sequences that do not come from one, such as a hand written or imported list of steps
+class PackedSequence
+{
+public:
+	static constexpr uint32_t STEPS_PER_BYTE = 4;
+	static constexpr size_t MEMORY_CHUNK_BYTES = 256;
+	//a multiple of the page size and of the windows allocation granularity
+	static constexpr size_t FILE_CHUNK_BYTES = 64 * 1024;
+
+	PackedSequence() noexcept = default;
+
+#ifdef __linux__
+	//steps live in a file mapped chunk by chunk, steps already in the file are kept
+	explicit PackedSequence(const char* path) noexcept;
+#endif
+
+	~PackedSequence();
+
+	PackedSequence(const PackedSequence&) = delete;
+	PackedSequence& operator=(const PackedSequence&) = delete;
+
+	PackedSequence(PackedSequence&& other) noexcept;
+	PackedSequence& operator=(PackedSequence&& other) noexcept;
+
+	[[nodiscard]]
+	int Get(uint64_t index) const noexcept
+	{
+		const uint64_t byteIndex = index / STEPS_PER_BYTE;
+		const uint64_t chunk = byteIndex >> chunkShift;
+
+		if (chunk >= chunks.size())
+			return 0;
+
+		const uint8_t packed = chunks[chunk][byteIndex & ((1ull << chunkShift) - 1)];
+		return (packed >> ((index % STEPS_PER_BYTE) * 2)) & 3;
+	}
+
+	//grows the sequence if index is past the end, value must be below 4
+	void Set(uint64_t index, int value) noexcept
+	{
+		const uint64_t byteIndex = index / STEPS_PER_BYTE;
+		const uint64_t chunk = byteIndex >> chunkShift;
+
+		if (chunk >= chunks.size())
+			Grow(chunk + 1);
+
+		uint8_t& packed = chunks[chunk][byteIndex & ((1ull << chunkShift) - 1)];
+		const uint32_t shift = (index % STEPS_PER_BYTE) * 2;
+		packed = (uint8_t)((packed & ~(3u << shift)) | ((uint32_t)value << shift));
+	}
+
+	//makes room for steps [0, stepCount) up front so Set() never allocates below it
+	void Reserve(uint64_t stepCount) noexcept;
+
+	//number of steps that can be written without growing
+	[[nodiscard]]
+	uint64_t Capacity() const noexcept { return (uint64_t)chunks.size() * STEPS_PER_BYTE << chunkShift; }
+
+	[[nodiscard]]
+	size_t BytesReserved() const noexcept { return chunks.size() << chunkShift; }
+
+private:
+	void Grow(uint64_t chunkCount) noexcept;
+	void Release() noexcept;
+
+	std::vector<uint8_t*> chunks;
+	//log2 of the chunk size in bytes
+	uint32_t chunkShift = std::countr_zero(MEMORY_CHUNK_BYTES);
+	int fileDescriptor = -1;
+};
@@ -0,0 +1,139 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "BoardGeometry.h"
+
+//the handful of drawing calls the menu and the game need, so the same scene code
+//can drive Direct2D or the software rasterizer
+
+struct Color
+{
+	float r;
+	float g;
+	float b;
+};
+
+enum class Paint : uint8_t
+{
+	Highlight,
+	Score,
+	LightGray,
+	Button0,
+	Button0Lit,
+	Button1,
+	Button1Lit,
+	Button2,
+	Button2Lit,
+	Button3,
+	Button3Lit,
+	Count
+};
+
+constexpr Color PALETTE[(size_t)Paint::Count] =
+{
+	{ 1.0f, 1.0f, 0.0f },
+	{ 0.0f, 0.0f, 1.0f },
+	{ .564f, .564f, .564f },
+
+	{ 0.0f, 0.7f, 0.0f },
+	{ 0.0f, 1.0f, 0.0f },
+
+	{ 0.7f, 0.7f, 0.0f },
+	{ 1.0f, 1.0f, 0.0f },
+
+	{ 0.0f, 0.0f, 0.7f },
+	{ 0.0f, 0.0f, 1.0f },
+
+	{ 0.7f, 0.0f, 0.0f },
+	{ 1.0f, 0.0f, 0.0f }
+};
+
+[[nodiscard]]
+constexpr Paint ButtonPaint(int button, bool bLit) noexcept
+{
+	return (Paint)((int)Paint::Button0 + button * 2 + (bLit ? 1 : 0));
+}
+
+enum class TextStyle : uint8_t
+{
+	Title,
+	Body,
+	Copyright,
+	Overlay,
+	Count
+};
+
+//font size as a fraction of the window height
+constexpr float TEXT_STYLE_SIZE[(size_t)TextStyle::Count] = { .12f, .08f, .05f, .025f };
+
+//strings that never change, backends may lay them out once and reuse the layout
+enum class StaticText : uint8_t
+{
+	Title,
+	Play,
+	Exit,
+	Copyright,
+	ScoreLabel,
+	BestLabel,
+	Count
+};
+
+struct StaticTextString
+{
+	const wchar_t* text;
+	uint32_t length;
+};
+
+constexpr StaticTextString STATIC_TEXT_STRINGS[(size_t)StaticText::Count] =
+{
+	{ L"SIMON", 5 },
+	{ L"PLAY", 4 },
+	{ L"EXIT", 4 },
+	{ L"\u24B8 2023 badasahog. All Rights Reserved", 37 },
+	{ L"score", 5 },
+	{ L"best", 4 }
+};
+
+struct Rect
+{
+	float left;
+	float top;
+	float right;
+	float bottom;
+};
+
+struct RenderBackend
+{
+	virtual ~RenderBackend() = default;
+
+	virtual void BeginDraw() noexcept = 0;
+
+	virtual void EndDraw() noexcept = 0;
+
+	//clears to opaque black
+	virtual void Clear() noexcept = 0;
+
+	//until PopClip, drawing and Clear only touch pixels inside area, which is whole pixels
+	virtual void PushClip(const Rect& area) noexcept = 0;
+
+	virtual void PopClip() noexcept = 0;
+
+	virtual void FillButton(const BoardLayout& layout, int button, Paint paint) noexcept = 0;
+
+	//one pixel wide outline
+	virtual void DrawCircle(Point2 center, float radius, Paint paint) noexcept = 0;
+
+	//centered horizontally, starting at the top of area
+	virtual void DrawString(const wchar_t* text, uint32_t length, TextStyle style, const Rect& area, Paint paint) noexcept = 0;
+
+	//same as DrawString, text, style and area must not change until the backend is recreated
+	virtual void DrawStaticText(StaticText text, TextStyle style, const Rect& area, Paint paint) noexcept = 0;
+};
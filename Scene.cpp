@@ -0,0 +1,404 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "Scene.h"
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	//a line of text is about this many times the font size tall
+	constexpr float TEXT_LINE_HEIGHT = 1.4f;
+
+	constexpr int MAX_DIRTY_REGIONS = 4;
+
+	[[nodiscard]]
+	bool Intersects(const Rect& a, const Rect& b) noexcept
+	{
+		return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+	}
+
+	[[nodiscard]]
+	Rect Union(const Rect& a, const Rect& b) noexcept
+	{
+		return
+		{
+			.left = std::min(a.left, b.left),
+			.top = std::min(a.top, b.top),
+			.right = std::max(a.right, b.right),
+			.bottom = std::max(a.bottom, b.bottom)
+		};
+	}
+
+	//the part of a text area the glyphs can actually cover
+	[[nodiscard]]
+	Rect TextBounds(const Rect& area, TextStyle style, float windowHeight) noexcept
+	{
+		return
+		{
+			.left = area.left,
+			.top = area.top,
+			.right = area.right,
+			.bottom = std::min(area.bottom, area.top + TEXT_STYLE_SIZE[(size_t)style] * windowHeight * TEXT_LINE_HEIGHT)
+		};
+	}
+
+	//bezier control points bound the curve, one extra pixel covers antialiasing
+	[[nodiscard]]
+	Rect WedgeBounds(const BoardLayout& layout, int button) noexcept
+	{
+		const WedgeOutline outline = BuildWedgeOutline(layout, button);
+
+		Rect bounds = { outline.start.x, outline.start.y, outline.start.x, outline.start.y };
+		for (const BezierSegment& segment : outline.segments)
+		{
+			for (const Point2& point : { segment.point1, segment.point2, segment.point3 })
+			{
+				bounds = Union(bounds, { point.x, point.y, point.x, point.y });
+			}
+		}
+
+		return { bounds.left - 1, bounds.top - 1, bounds.right + 1, bounds.bottom + 1 };
+	}
+
+	[[nodiscard]]
+	Rect CircleBounds(Point2 center, float radius) noexcept
+	{
+		return { center.x - radius - 1, center.y - radius - 1, center.x + radius + 1, center.y + radius + 1 };
+	}
+
+	struct MenuAreas
+	{
+		Rect title;
+		Rect play;
+		Rect exit;
+		Rect copyright;
+
+		MenuAreas(float windowWidth, float windowHeight) noexcept :
+			title{ 0, windowHeight * .1f, windowWidth, windowHeight * .8f },
+			play{ 0, windowHeight * .3f, windowWidth, windowHeight * .8f },
+			exit{ 0, windowHeight * .45f, windowWidth, windowHeight * .8f },
+			copyright{ 0, windowHeight * .9f, windowWidth, windowHeight * 1.f }
+		{
+		}
+
+		[[nodiscard]]
+		Rect ItemBounds(MenuItem item, float windowHeight) const noexcept
+		{
+			return TextBounds(item == MenuItem::Play ? play : exit, TextStyle::Body, windowHeight);
+		}
+	};
+
+	struct GameAreas
+	{
+		Rect scoreLabel;
+		Rect score;
+		Rect bestLabel;
+		Rect best;
+
+		GameAreas(float windowWidth, float windowHeight) noexcept
+		{
+			const float ScoreWidth = .2f * windowWidth;
+			const float bottom = (.1f / .5f) * windowHeight;
+
+			scoreLabel = { 0, 0, windowWidth / 2 - ScoreWidth, bottom };
+			score = { windowWidth / 2 - ScoreWidth, 0, windowWidth / 2, bottom };
+			bestLabel = { windowWidth / 2, 0, windowWidth / 2 + ScoreWidth, bottom };
+			best = { windowWidth / 2 + ScoreWidth, 0, windowWidth, bottom };
+		}
+	};
+
+	//issues only the draws that can touch region
+	struct SceneDraw
+	{
+		RenderBackend& backend;
+		Rect region;
+		float windowHeight;
+		uint32_t drawCalls = 0;
+
+		void Text(const wchar_t* text, uint32_t length, TextStyle style, const Rect& area, Paint paint) noexcept
+		{
+			if (!Intersects(region, TextBounds(area, style, windowHeight)))
+				return;
+
+			PROFILE_SCOPE(ProfilePhase::Text);
+			backend.DrawString(text, length, style, area, paint);
+			drawCalls++;
+		}
+
+		void Text(StaticText text, TextStyle style, const Rect& area, Paint paint) noexcept
+		{
+			if (!Intersects(region, TextBounds(area, style, windowHeight)))
+				return;
+
+			PROFILE_SCOPE(ProfilePhase::Text);
+			backend.DrawStaticText(text, style, area, paint);
+			drawCalls++;
+		}
+
+		void Number(int value, TextStyle style, const Rect& area, Paint paint) noexcept
+		{
+			wchar_t buffer[NUMBER_BUFFER_LENGTH];
+			const uint32_t length = FormatNumber(value, buffer);
+			Text(buffer, length, style, area, paint);
+		}
+
+		void Button(const BoardLayout& layout, int button, Paint paint) noexcept
+		{
+			if (!Intersects(region, WedgeBounds(layout, button)))
+				return;
+
+			backend.FillButton(layout, button, paint);
+			drawCalls++;
+		}
+
+		void Circle(Point2 center, float radius, Paint paint) noexcept
+		{
+			if (!Intersects(region, CircleBounds(center, radius)))
+				return;
+
+			backend.DrawCircle(center, radius, paint);
+			drawCalls++;
+		}
+	};
+
+	void DrawMenuElements(SceneDraw& draw, const SceneState& state) noexcept
+	{
+		const MenuAreas areas((float)state.windowWidth, (float)state.windowHeight);
+
+		draw.Text(StaticText::Title, TextStyle::Title, areas.title, Paint::Score);
+		draw.Text(StaticText::Play, TextStyle::Body, areas.play, state.hoveredMenuItem == MenuItem::Play ? Paint::Highlight : Paint::LightGray);
+		draw.Text(StaticText::Exit, TextStyle::Body, areas.exit, state.hoveredMenuItem == MenuItem::Exit ? Paint::Highlight : Paint::LightGray);
+		draw.Text(StaticText::Copyright, TextStyle::Copyright, areas.copyright, Paint::LightGray);
+	}
+
+	void DrawGameElements(SceneDraw& draw, const SceneState& state) noexcept
+	{
+		const GameAreas areas((float)state.windowWidth, (float)state.windowHeight);
+
+		draw.Text(StaticText::ScoreLabel, TextStyle::Body, areas.scoreLabel, Paint::Score);
+		draw.Number(state.score, TextStyle::Body, areas.score, Paint::Score);
+		draw.Number(state.bestScore, TextStyle::Body, areas.best, Paint::Score);
+		draw.Text(StaticText::BestLabel, TextStyle::Body, areas.bestLabel, Paint::Score);
+
+		const BoardLayout layout = BoardLayout::FromClientSize((float)state.windowWidth, (float)state.windowHeight);
+
+		for (int i = 0; i < BUTTON_COUNT; i++)
+		{
+			draw.Button(layout, i, ButtonPaint(i, i == state.litButton));
+		}
+
+		const Point2 center = { .x = layout.centerX, .y = layout.centerY };
+		draw.Circle(center, layout.fullRadius, Paint::LightGray);
+		draw.Circle(center, layout.innerCircleRadius, Paint::LightGray);
+	}
+
+	[[nodiscard]]
+	FrameStats DrawRegions(RenderBackend& backend, const SceneState& state, const Rect* regions, int regionCount, bool bFullFrame) noexcept
+	{
+		PROFILE_SCOPE(ProfilePhase::Scene);
+
+		FrameStats stats = {};
+
+		{
+			PROFILE_SCOPE(ProfilePhase::BeginDraw);
+			backend.BeginDraw();
+		}
+
+		for (int i = 0; i < regionCount; i++)
+		{
+			//whole pixels, so every backend clips the same way
+			const Rect region =
+			{
+				.left = std::max(floorf(regions[i].left), 0.f),
+				.top = std::max(floorf(regions[i].top), 0.f),
+				.right = std::min(ceilf(regions[i].right), (float)state.windowWidth),
+				.bottom = std::min(ceilf(regions[i].bottom), (float)state.windowHeight)
+			};
+
+			if (region.left >= region.right || region.top >= region.bottom)
+				continue;
+
+			if (!bFullFrame)
+				backend.PushClip(region);
+
+			backend.Clear();
+
+			SceneDraw draw = { .backend = backend, .region = region, .windowHeight = (float)state.windowHeight };
+
+			if (state.bMenu)
+				DrawMenuElements(draw, state);
+			else
+				DrawGameElements(draw, state);
+
+			if (!bFullFrame)
+				backend.PopClip();
+
+			stats.dirtyRegions++;
+			stats.drawCalls += draw.drawCalls + 1;
+			stats.pixels += (uint64_t)(region.right - region.left) * (uint64_t)(region.bottom - region.top);
+		}
+
+		{
+			PROFILE_SCOPE(ProfilePhase::EndDraw);
+			backend.EndDraw();
+		}
+
+		return stats;
+	}
+}
+
+uint32_t FormatNumber(int value, wchar_t (&buffer)[NUMBER_BUFFER_LENGTH]) noexcept
+{
+	wchar_t digits[NUMBER_BUFFER_LENGTH];
+	uint32_t digitCount = 0;
+
+	unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+	do
+	{
+		digits[digitCount++] = (wchar_t)(L'0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	uint32_t length = 0;
+	if (value < 0)
+		buffer[length++] = L'-';
+
+	while (digitCount != 0)
+		buffer[length++] = digits[--digitCount];
+
+	return length;
+}
+
+SceneState MenuSceneState(uint32_t windowWidth, uint32_t windowHeight, MenuItem hoveredMenuItem) noexcept
+{
+	return
+	{
+		.bMenu = true,
+		.windowWidth = windowWidth,
+		.windowHeight = windowHeight,
+		.hoveredMenuItem = hoveredMenuItem,
+		.litButton = NO_BUTTON,
+		.score = 0,
+		.bestScore = 0
+	};
+}
+
+SceneState GameSceneState(uint32_t windowWidth, uint32_t windowHeight, const GameCore& game, int litButton) noexcept
+{
+	return
+	{
+		.bMenu = false,
+		.windowWidth = windowWidth,
+		.windowHeight = windowHeight,
+		.hoveredMenuItem = MenuItem::None,
+		.litButton = litButton,
+		.score = game.Score(),
+		.bestScore = game.bestScore
+	};
+}
+
+SceneState GameSceneState(uint32_t windowWidth, uint32_t windowHeight, const GameSnapshot& snapshot, int litButton) noexcept
+{
+	return
+	{
+		.bMenu = false,
+		.windowWidth = windowWidth,
+		.windowHeight = windowHeight,
+		.hoveredMenuItem = MenuItem::None,
+		.litButton = litButton,
+		.score = snapshot.score,
+		.bestScore = snapshot.bestScore
+	};
+}
+
+FrameStats DrawScene(RenderBackend& backend, const SceneState& state) noexcept
+{
+	const Rect fullFrame = { 0, 0, (float)state.windowWidth, (float)state.windowHeight };
+	return DrawRegions(backend, state, &fullFrame, 1, true);
+}
+
+void DrawMenuScene(RenderBackend& backend, float windowWidth, float windowHeight, MenuItem hoveredMenuItem) noexcept
+{
+	(void)DrawScene(backend, MenuSceneState((uint32_t)windowWidth, (uint32_t)windowHeight, hoveredMenuItem));
+}
+
+void DrawGameScene(RenderBackend& backend, float windowWidth, float windowHeight, const GameCore& game, int litButton) noexcept
+{
+	(void)DrawScene(backend, GameSceneState((uint32_t)windowWidth, (uint32_t)windowHeight, game, litButton));
+}
+
+bool RetainedScene::Draw(RenderBackend& backend, const SceneState& state) noexcept
+{
+	const bool bFullFrame =
+		!bValid ||
+		state.bMenu != previous.bMenu ||
+		state.windowWidth != previous.windowWidth ||
+		state.windowHeight != previous.windowHeight;
+
+	if (bFullFrame)
+	{
+		lastFrame = DrawScene(backend, state);
+		previous = state;
+		bValid = true;
+		return true;
+	}
+
+	Rect regions[MAX_DIRTY_REGIONS];
+	int regionCount = 0;
+
+	const float windowWidth = (float)state.windowWidth;
+	const float windowHeight = (float)state.windowHeight;
+
+	if (state.bMenu)
+	{
+		const MenuAreas areas(windowWidth, windowHeight);
+
+		if (state.hoveredMenuItem != previous.hoveredMenuItem)
+		{
+			for (const MenuItem item : { previous.hoveredMenuItem, state.hoveredMenuItem })
+			{
+				if (item != MenuItem::None)
+					regions[regionCount++] = areas.ItemBounds(item, windowHeight);
+			}
+		}
+	}
+	else
+	{
+		const GameAreas areas(windowWidth, windowHeight);
+
+		if (state.score != previous.score)
+			regions[regionCount++] = TextBounds(areas.score, TextStyle::Body, windowHeight);
+
+		if (state.bestScore != previous.bestScore)
+			regions[regionCount++] = TextBounds(areas.best, TextStyle::Body, windowHeight);
+
+		if (state.litButton != previous.litButton)
+		{
+			const BoardLayout layout = BoardLayout::FromClientSize(windowWidth, windowHeight);
+
+			for (const int button : { previous.litButton, state.litButton })
+			{
+				if (button != NO_BUTTON)
+					regions[regionCount++] = WedgeBounds(layout, button);
+			}
+		}
+	}
+
+	previous = state;
+
+	if (regionCount == 0)
+	{
+		lastFrame = {};
+		return false;
+	}
+
+	lastFrame = DrawRegions(backend, state, regions, regionCount, false);
+	return true;
+}
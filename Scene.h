@@ -0,0 +1,76 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "RenderBackend.h"
+#include "SimonCore.h"
+
+//everything a frame depends on, two equal states draw identical frames
+struct SceneState
+{
+	bool bMenu;
+	uint32_t windowWidth;
+	uint32_t windowHeight;
+	MenuItem hoveredMenuItem;
+	int litButton;
+	int score;
+	int bestScore;
+
+	bool operator==(const SceneState&) const = default;
+};
+
+[[nodiscard]]
+SceneState MenuSceneState(uint32_t windowWidth, uint32_t windowHeight, MenuItem hoveredMenuItem) noexcept;
+
+[[nodiscard]]
+SceneState GameSceneState(uint32_t windowWidth, uint32_t windowHeight, const GameCore& game, int litButton) noexcept;
+
+[[nodiscard]]
+SceneState GameSceneState(uint32_t windowWidth, uint32_t windowHeight, const GameSnapshot& snapshot, int litButton) noexcept;
+
+//enough for any int, including the sign
+constexpr int NUMBER_BUFFER_LENGTH = 12;
+
+//std::to_wstring would allocate on every frame, returns the length written
+[[nodiscard]]
+uint32_t FormatNumber(int value, wchar_t (&buffer)[NUMBER_BUFFER_LENGTH]) noexcept;
+
+struct FrameStats
+{
+	uint32_t dirtyRegions;
+	uint32_t drawCalls;
+	uint64_t pixels;
+};
+
+//complete frames, BeginDraw to EndDraw
+FrameStats DrawScene(RenderBackend& backend, const SceneState& state) noexcept;
+
+void DrawMenuScene(RenderBackend& backend, float windowWidth, float windowHeight, MenuItem hoveredMenuItem) noexcept;
+
+void DrawGameScene(RenderBackend& backend, float windowWidth, float windowHeight, const GameCore& game, int litButton) noexcept;
+
+//remembers the last frame and only redraws the regions whose state changed,
+//frames where nothing changed do not touch the backend at all
+class RetainedScene
+{
+public:
+	//returns false when there was nothing to present
+	bool Draw(RenderBackend& backend, const SceneState& state) noexcept;
+
+	//the next Draw repaints everything, e.g. after the render target was recreated
+	void Invalidate() noexcept { bValid = false; }
+
+	[[nodiscard]]
+	const FrameStats& LastFrame() const noexcept { return lastFrame; }
+
+private:
+	SceneState previous = {};
+	bool bValid = false;
+	FrameStats lastFrame = {};
+};
@@ -0,0 +1,224 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "SequenceVerifier.h"
+
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	//CounterRng's step between values
+	constexpr uint64_t STREAM_INCREMENT = 0x9E3779B97F4A7C15ull;
+
+	[[nodiscard]]
+	inline uint64_t Load64(const uint8_t* bytes) noexcept
+	{
+		uint64_t value;
+		memcpy(&value, bytes, sizeof(value));
+		return value;
+	}
+
+	//the first differing step from byte index on, whole bytes up to byteCount and then the steps of the partial one
+	[[nodiscard]]
+	uint64_t MismatchFrom(const uint8_t* presses, const uint8_t* expected, uint64_t stepCount, uint64_t index) noexcept
+	{
+		const uint64_t byteCount = stepCount / 4;
+
+		for (; index + 8 <= byteCount; index += 8)
+		{
+			const uint64_t difference = Load64(presses + index) ^ Load64(expected + index);
+			if (difference != 0)
+				return index * 4 + (uint64_t)std::countr_zero(difference) / 2;
+		}
+
+		for (; index < byteCount; index++)
+		{
+			const uint32_t difference = presses[index] ^ expected[index];
+			if (difference != 0)
+				return index * 4 + (uint64_t)std::countr_zero(difference) / 2;
+		}
+
+		//only the steps that exist in the last byte count, whatever follows them is not compared
+		const uint32_t tailSteps = (uint32_t)(stepCount % 4);
+		if (tailSteps != 0)
+		{
+			const uint32_t difference = (presses[index] ^ expected[index]) & ((1u << tailSteps * 2) - 1);
+			if (difference != 0)
+				return index * 4 + (uint64_t)std::countr_zero(difference) / 2;
+		}
+
+		return stepCount;
+	}
+
+	constexpr uint64_t IMAGE_COPY_BYTES = 16;
+	//the steps a round has in its last byte, by steps % 4
+	constexpr uint8_t LAST_BYTE_MASKS[4] = { 0xFF, 0x03, 0x0F, 0x3F };
+
+	//whether the presses earn the claimed score, and how many there were
+	struct SubmissionCheck
+	{
+		bool bAccepted;
+		uint64_t presses;
+	};
+
+	//expected holds the whole sequence of the game, image is scratch for the same rounds laid out like the presses
+	[[nodiscard]]
+	SubmissionCheck CheckSubmission(const SubmissionHeader& header, const uint8_t* presses, uint64_t pressBytes, std::vector<uint8_t>& expected, std::vector<uint8_t>& image) noexcept
+	{
+		//both have room for the last copy to run over
+		expected.resize(RoundBytes(header.rounds) + IMAGE_COPY_BYTES);
+		PackSequence(CounterRng::ForStream(header.seed, header.gameNumber), header.rounds, expected.data());
+
+		//round k is the first k steps of the sequence, so every round is a prefix of expected with its last byte cut short,
+		//and the whole game is checked in one pass instead of one short compare per round, rounds are copied in fixed
+		//blocks that may run into the next round, which the next copy overwrites
+		image.resize(pressBytes + IMAGE_COPY_BYTES);
+		uint8_t* out = image.data();
+		for (uint32_t round = 1; round <= header.rounds; round++)
+		{
+			const uint32_t steps = round == header.rounds ? header.finalPresses : round;
+			const uint64_t bytes = RoundBytes(steps);
+			for (uint64_t i = 0; i < bytes; i += IMAGE_COPY_BYTES)
+				memcpy(out + i, expected.data() + i, IMAGE_COPY_BYTES);
+			out[bytes - 1] &= LAST_BYTE_MASKS[steps % 4];
+			out += bytes;
+		}
+
+		const uint64_t blockSteps = pressBytes * 4;
+		const uint64_t mismatch = FirstMismatch(presses, image.data(), blockSteps);
+
+		const uint64_t playedSteps = (uint64_t)header.rounds * (header.rounds - 1) / 2 + header.finalPresses;
+		const bool bCompleted = header.finalPresses == header.rounds;
+
+		if (mismatch == blockSteps)
+			return { .bAccepted = bCompleted && header.claimedScore == (int32_t)header.rounds, .presses = playedSteps };
+
+		//only the last press of the game may miss, and then the last round does not count, the last press
+		//is in the last byte so only the padding after it is left to check
+		const uint64_t lastPress = (pressBytes - RoundBytes(header.finalPresses)) * 4 + header.finalPresses - 1;
+		const uint32_t padding = (uint32_t)(presses[pressBytes - 1] ^ image[pressBytes - 1]) >> (lastPress % 4 + 1) * 2;
+		const bool bMissedLast = mismatch == lastPress && padding == 0;
+
+		return { .bAccepted = bMissedLast && header.claimedScore == (int32_t)header.rounds - 1, .presses = playedSteps };
+	}
+}
+
+uint64_t FirstMismatch(const uint8_t* presses, const uint8_t* expected, uint64_t stepCount) noexcept
+{
+	const uint64_t byteCount = stepCount / 4;
+	uint64_t index = 0;
+
+#if defined(__AVX2__)
+	//two vectors per test, the branch is taken once per 64 bytes and a difference drops to the scalar loops to be located
+	for (; index + 64 <= byteCount; index += 64)
+	{
+		const __m256i low = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(presses + index)), _mm256_loadu_si256((const __m256i*)(expected + index)));
+		const __m256i high = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(presses + index + 32)), _mm256_loadu_si256((const __m256i*)(expected + index + 32)));
+		const __m256i difference = _mm256_or_si256(low, high);
+		if (!_mm256_testz_si256(difference, difference))
+			break;
+	}
+#elif defined(__SSE2__) || defined(_M_X64)
+	//sse2 has no ptest, equal bytes are counted with a movemask instead
+	for (; index + 32 <= byteCount; index += 32)
+	{
+		const __m128i low = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(presses + index)), _mm_loadu_si128((const __m128i*)(expected + index)));
+		const __m128i high = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(presses + index + 16)), _mm_loadu_si128((const __m128i*)(expected + index + 16)));
+		if (_mm_movemask_epi8(_mm_and_si128(low, high)) != 0xFFFF)
+			break;
+	}
+#endif
+
+	return MismatchFrom(presses, expected, stepCount, index);
+}
+
+uint64_t FirstMismatchScalar(const uint8_t* presses, const uint8_t* expected, uint64_t stepCount) noexcept
+{
+	return MismatchFrom(presses, expected, stepCount, 0);
+}
+
+void PackSequence(const CounterRng& sequence, uint64_t stepCount, uint8_t* out) noexcept
+{
+	//CounterRng::Button with the counter stepped by addition instead of multiplied out for every step,
+	//the four steps of a byte are independent so their multiplies overlap
+	uint64_t counter = sequence.key;
+	const uint64_t byteCount = RoundBytes(stepCount);
+	for (uint64_t byte = 0; byte < byteCount; byte++)
+	{
+		uint32_t packed = 0;
+		for (uint32_t step = 0; step < 4; step++)
+		{
+			counter += STREAM_INCREMENT;
+			packed |= (uint32_t)(SplitMix64(counter) >> 62) << step * 2;
+		}
+		out[byte] = (uint8_t)packed;
+	}
+
+	//ButtonAt(0) is always 1, and the last byte only holds the steps there are
+	if (stepCount != 0)
+	{
+		out[0] = (uint8_t)((out[0] & ~3u) | 1);
+		if (stepCount % 4 != 0)
+			out[byteCount - 1] &= (uint8_t)((1u << stepCount % 4 * 2) - 1);
+	}
+}
+
+ArchiveResult VerifyArchive(const uint8_t* data, size_t size) noexcept
+{
+	ArchiveResult result = { .bWellFormed = true, .submissions = 0, .rejected = 0, .firstRejected = UINT64_MAX, .pressesChecked = 0 };
+
+	std::vector<uint8_t> expected;
+	std::vector<uint8_t> image;
+	size_t offset = 0;
+
+	while (offset < size)
+	{
+		if (size - offset < sizeof(SubmissionHeader))
+		{
+			result.bWellFormed = false;
+			break;
+		}
+
+		SubmissionHeader header;
+		memcpy(&header, data + offset, sizeof(header));
+		offset += sizeof(header);
+
+		if (header.rounds == 0 || header.rounds > MAX_SUBMISSION_ROUNDS || header.finalPresses == 0 || header.finalPresses > header.rounds)
+		{
+			result.bWellFormed = false;
+			break;
+		}
+
+		const uint64_t pressBytes = SubmissionPressBytes(header.rounds, header.finalPresses);
+		if (size - offset < pressBytes)
+		{
+			result.bWellFormed = false;
+			break;
+		}
+
+		const SubmissionCheck check = CheckSubmission(header, data + offset, pressBytes, expected, image);
+		offset += pressBytes;
+
+		if (!check.bAccepted)
+		{
+			if (result.rejected == 0)
+				result.firstRejected = result.submissions;
+			result.rejected++;
+		}
+
+		result.submissions++;
+		result.pressesChecked += check.presses;
+	}
+
+	return result;
+}
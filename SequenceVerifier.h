@@ -0,0 +1,83 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "CounterRng.h"
+
+//checks recorded presses against the sequence a game generated, for auditing leaderboard submissions
+//steps are packed like PackedSequence, 2 bits each and 4 to a byte, step i in bits (i % 4) * 2 of byte i / 4
+
+static_assert(std::endian::native == std::endian::little, "submission archives are little endian");
+
+//first step at which presses and expected differ, stepCount if they agree, 64 bytes per branch with
+//AVX2 and 32 with SSE2, what is left and the block a difference is in 8 bytes at a time
+[[nodiscard]]
+uint64_t FirstMismatch(const uint8_t* presses, const uint8_t* expected, uint64_t stepCount) noexcept;
+
+//the same 8 bytes at a time, what FirstMismatch() is checked and measured against
+[[nodiscard]]
+uint64_t FirstMismatchScalar(const uint8_t* presses, const uint8_t* expected, uint64_t stepCount) noexcept;
+
+//GameCore::ButtonAt for steps [0, stepCount) of sequence, out needs (stepCount + 3) / 4 bytes,
+//the unused steps of the last byte are 0
+void PackSequence(const CounterRng& sequence, uint64_t stepCount, uint8_t* out) noexcept;
+
+//an archive is any number of submissions back to back, each a header and then every press of every round,
+//round k takes k steps padded with zeros to whole bytes, the last round only as many as were pressed
+struct SubmissionHeader
+{
+	//the game is GameCore's stream gameNumber of seed
+	uint64_t seed;
+	uint64_t gameNumber;
+	uint32_t rounds;
+	//presses in the last round, all of them if it was completed, otherwise the last one missed
+	uint32_t finalPresses;
+	int32_t claimedScore;
+	uint32_t reserved;
+};
+
+static_assert(sizeof(SubmissionHeader) == 32);
+
+//no submission can claim more, so a corrupt header cannot make the verifier allocate without bound
+constexpr uint32_t MAX_SUBMISSION_ROUNDS = 1 << 16;
+
+[[nodiscard]]
+constexpr uint64_t RoundBytes(uint64_t steps) noexcept { return (steps + 3) / 4; }
+
+//bytes of presses after the header, rounds is at least 1
+[[nodiscard]]
+constexpr uint64_t SubmissionPressBytes(uint32_t rounds, uint32_t finalPresses) noexcept
+{
+	//rounds 4g + 1 to 4g + 4 take g + 1 bytes each, whole groups are summed at once and the rest one round at a time
+	uint64_t bytes = 0;
+	const uint64_t fullRounds = rounds - 1;
+	const uint64_t groups = fullRounds / 4;
+	bytes += 4 * (groups * (groups + 1) / 2);
+	for (uint64_t round = groups * 4 + 1; round <= fullRounds; round++)
+		bytes += RoundBytes(round);
+	return bytes + RoundBytes(finalPresses);
+}
+
+struct ArchiveResult
+{
+	//false if the archive ended inside a submission or a header was impossible, counts stop there
+	bool bWellFormed;
+	uint64_t submissions;
+	//presses that do not follow the sequence before the last one, or a score the presses do not earn
+	uint64_t rejected;
+	//index of the first rejected submission, or UINT64_MAX
+	uint64_t firstRejected;
+	uint64_t pressesChecked;
+};
+
+//each game's sequence is generated once and every round of it checked in a single FirstMismatch() pass
+[[nodiscard]]
+ArchiveResult VerifyArchive(const uint8_t* data, size_t size) noexcept;
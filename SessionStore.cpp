@@ -0,0 +1,388 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "SessionStore.h"
+
+#include <algorithm>
+#include <bit>
+#include <new>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	//the constants of CounterRng and SplitMix64, the vector paths cannot call them
+	constexpr uint64_t STREAM_INCREMENT = 0x9E3779B97F4A7C15ull;
+	constexpr uint64_t MIX_MULTIPLIER1 = 0xBF58476D1CE4E5B9ull;
+	constexpr uint64_t MIX_MULTIPLIER2 = 0x94D049BB133111EBull;
+
+	[[nodiscard]]
+	size_t ArrayBytes(uint32_t capacity, size_t elementSize) noexcept
+	{
+		return (capacity * elementSize + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+	}
+
+#if defined(__AVX2__)
+	//low 64 bits of every lane times constant, avx2 only multiplies 32 bit halves
+	[[nodiscard]]
+	inline __m256i MultiplyLow64(__m256i value, uint64_t constant) noexcept
+	{
+		const __m256i low = _mm256_set1_epi64x((int64_t)(constant & 0xFFFFFFFF));
+		const __m256i high = _mm256_set1_epi64x((int64_t)(constant >> 32));
+		const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(value, 32), low), _mm256_mul_epu32(value, high));
+		return _mm256_add_epi64(_mm256_mul_epu32(value, low), _mm256_slli_epi64(cross, 32));
+	}
+
+	//CounterRng::Button of four keys at four steps, in the low half of each 64 bit lane
+	[[nodiscard]]
+	inline __m256i Buttons4(__m256i keys, __m256i steps) noexcept
+	{
+		__m256i value = _mm256_add_epi64(keys, MultiplyLow64(_mm256_add_epi64(steps, _mm256_set1_epi64x(1)), STREAM_INCREMENT));
+		value = MultiplyLow64(_mm256_xor_si256(value, _mm256_srli_epi64(value, 30)), MIX_MULTIPLIER1);
+		value = MultiplyLow64(_mm256_xor_si256(value, _mm256_srli_epi64(value, 27)), MIX_MULTIPLIER2);
+		return _mm256_srli_epi64(_mm256_xor_si256(value, _mm256_srli_epi64(value, 31)), 62);
+	}
+
+	//GameCore::ButtonAt of eight sessions, one per 32 bit lane
+	[[nodiscard]]
+	inline __m256i Buttons8(const uint64_t* keys, __m256i steps) noexcept
+	{
+		const __m256i low = Buttons4(_mm256_load_si256((const __m256i*)keys), _mm256_cvtepu32_epi64(_mm256_castsi256_si128(steps)));
+		const __m256i high = Buttons4(_mm256_load_si256((const __m256i*)(keys + 4)), _mm256_cvtepu32_epi64(_mm256_extracti128_si256(steps, 1)));
+
+		//low words of both in lane order, the shuffle works within 128 bit halves so the quarters need swapping back
+		const __m256 packed = _mm256_shuffle_ps(_mm256_castsi256_ps(low), _mm256_castsi256_ps(high), _MM_SHUFFLE(2, 0, 2, 0));
+		const __m256i buttons = _mm256_permute4x64_epi64(_mm256_castps_si256(packed), _MM_SHUFFLE(3, 1, 2, 0));
+
+		//step 0 is always button 1
+		return _mm256_blendv_epi8(buttons, _mm256_set1_epi32(1), _mm256_cmpeq_epi32(steps, _mm256_setzero_si256()));
+	}
+#elif defined(__SSE2__) || defined(_M_X64)
+	[[nodiscard]]
+	inline __m128i Select(__m128i mask, __m128i ifSet, __m128i ifClear) noexcept
+	{
+		return _mm_or_si128(_mm_and_si128(mask, ifSet), _mm_andnot_si128(mask, ifClear));
+	}
+
+	[[nodiscard]]
+	inline __m128i MultiplyLow64(__m128i value, uint64_t constant) noexcept
+	{
+		const __m128i low = _mm_set1_epi64x((int64_t)(constant & 0xFFFFFFFF));
+		const __m128i high = _mm_set1_epi64x((int64_t)(constant >> 32));
+		const __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(value, 32), low), _mm_mul_epu32(value, high));
+		return _mm_add_epi64(_mm_mul_epu32(value, low), _mm_slli_epi64(cross, 32));
+	}
+
+	[[nodiscard]]
+	inline __m128i Buttons2(__m128i keys, __m128i steps) noexcept
+	{
+		__m128i value = _mm_add_epi64(keys, MultiplyLow64(_mm_add_epi64(steps, _mm_set1_epi64x(1)), STREAM_INCREMENT));
+		value = MultiplyLow64(_mm_xor_si128(value, _mm_srli_epi64(value, 30)), MIX_MULTIPLIER1);
+		value = MultiplyLow64(_mm_xor_si128(value, _mm_srli_epi64(value, 27)), MIX_MULTIPLIER2);
+		return _mm_srli_epi64(_mm_xor_si128(value, _mm_srli_epi64(value, 31)), 62);
+	}
+
+	[[nodiscard]]
+	inline __m128i Buttons4(const uint64_t* keys, __m128i steps) noexcept
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i low = Buttons2(_mm_load_si128((const __m128i*)keys), _mm_unpacklo_epi32(steps, zero));
+		const __m128i high = Buttons2(_mm_load_si128((const __m128i*)(keys + 2)), _mm_unpackhi_epi32(steps, zero));
+		const __m128i buttons = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(2, 0, 2, 0)));
+
+		return Select(_mm_cmpeq_epi32(steps, zero), _mm_set1_epi32(1), buttons);
+	}
+#endif
+}
+
+SessionStore::SessionStore(const GameTimings& timings, uint32_t capacity, uint64_t seed) noexcept :
+	buttonLitTicks((int32_t)timings.ButtonLitTicks),
+	allButtonsOffTicks((int32_t)timings.AllButtonsOffTicks),
+	gameStateChangedTicks((int32_t)timings.GameStateChangedTicks),
+	seed(seed),
+	capacity((capacity + SESSION_ALIGNMENT - 1) / SESSION_ALIGNMENT * SESSION_ALIGNMENT)
+{
+	const size_t wordBytes = ArrayBytes(this->capacity, sizeof(uint32_t));
+	const size_t keyBytes = ArrayBytes(this->capacity, sizeof(uint64_t));
+
+	uint8_t* memory = (uint8_t*)operator new(wordBytes * 5 + keyBytes, std::align_val_t{ CACHE_LINE_SIZE }, std::nothrow);
+	FATAL_ON_NULL(memory);
+	arena = memory;
+
+	deadline = (int32_t*)memory;
+	control = (uint32_t*)(memory + wordBytes);
+	location = (uint32_t*)(memory + wordBytes * 2);
+	length = (uint32_t*)(memory + wordBytes * 3);
+	bestScore = (int32_t*)(memory + wordBytes * 4);
+	key = (uint64_t*)(memory + wordBytes * 5);
+
+	//free slots are never due, so Tick() can run over the whole capacity without looking at the free list
+	std::fill_n(deadline, this->capacity, NO_TIMER);
+	std::fill_n(control, this->capacity, STATE_FREE | (uint32_t)NO_BUTTON << LIT_SHIFT);
+	std::fill_n(location, this->capacity, 0u);
+	std::fill_n(length, this->capacity, 1u);
+	std::fill_n(bestScore, this->capacity, 0);
+	std::fill_n(key, this->capacity, 0ull);
+}
+
+SessionStore::~SessionStore()
+{
+	operator delete(arena, std::align_val_t{ CACHE_LINE_SIZE });
+}
+
+SessionId SessionStore::Allocate() noexcept
+{
+	SessionId session;
+
+	if (freeList != NO_SESSION)
+	{
+		session = freeList;
+		freeList = location[session];
+	}
+	else if (highWater < capacity)
+		session = highWater++;
+	else
+		return NO_SESSION;
+
+	deadline[session] = NO_TIMER;
+	control[session] = GAME_STATE_MENU | (uint32_t)NO_BUTTON << LIT_SHIFT;
+	location[session] = 0;
+	length[session] = 1;
+	bestScore[session] = 0;
+	key[session] = NextKey();
+
+	sessionCount++;
+	return session;
+}
+
+void SessionStore::Free(SessionId session) noexcept
+{
+	deadline[session] = NO_TIMER;
+	control[session] = STATE_FREE | (uint32_t)NO_BUTTON << LIT_SHIFT;
+	location[session] = freeList;
+	freeList = session;
+	sessionCount--;
+}
+
+void SessionStore::StartGame(SessionId session, int32_t now) noexcept
+{
+	control[session] = GAME_STATE_PLAYBACK | OUTSTANDING_TIMER | (control[session] & ~(STATE_MASK | OUTSTANDING_TIMER));
+	deadline[session] = now + gameStateChangedTicks;
+}
+
+Verdict SessionStore::Press(SessionId session, int button, int32_t now) noexcept
+{
+	return Step(session, now, button);
+}
+
+void SessionStore::ReturnToMenu(SessionId session) noexcept
+{
+	//GameCore leaves its outstanding timer set in the menu where nothing looks at it, here every timer stops with the game
+	deadline[session] = NO_TIMER;
+	control[session] = GAME_STATE_MENU | (uint32_t)NO_BUTTON << LIT_SHIFT;
+	location[session] = 0;
+	length[session] = 1;
+	key[session] = NextKey();
+}
+
+Verdict SessionStore::Step(SessionId session, int32_t now, int button) noexcept
+{
+	const uint32_t word = control[session];
+	const uint32_t state = word & STATE_MASK;
+
+	if (state == GAME_STATE_MENU || state == STATE_FREE)
+		return Verdict::Ignored;
+
+	if (word & OUTSTANDING_TIMER)
+	{
+		if (deadline[session] < now)
+			control[session] = word & ~OUTSTANDING_TIMER;
+		return Verdict::Ignored;
+	}
+
+	if (state == GAME_STATE_PLAYBACK)
+	{
+		if (deadline[session] < now)
+		{
+			if ((word >> LIT_SHIFT & 7) == NO_BUTTON)
+			{
+				control[session] = (word & ~(7u << LIT_SHIFT)) | (uint32_t)ButtonAt(session, location[session]) << LIT_SHIFT;
+				deadline[session] = now + buttonLitTicks;
+				location[session]++;
+			}
+			else
+			{
+				uint32_t next = (word & ~(7u << LIT_SHIFT)) | (uint32_t)NO_BUTTON << LIT_SHIFT;
+
+				control[session] = next;
+				deadline[session] = now + allButtonsOffTicks;
+
+				if (location[session] == length[session])
+				{
+					control[session] = (next & ~STATE_MASK) | GAME_STATE_INPUT;
+					location[session] = 0;
+					deadline[session] = NO_TIMER;
+				}
+			}
+		}
+		return Verdict::Ignored;
+	}
+
+	if (button < 0 || button >= BUTTON_COUNT)
+		return Verdict::Ignored;
+
+	if (button != ButtonAt(session, location[session]))
+	{
+		length[session] = 1;
+		location[session] = 0;
+		key[session] = NextKey();
+		control[session] = (word & ~STATE_MASK) | GAME_STATE_PLAYBACK | OUTSTANDING_TIMER;
+		deadline[session] = now + gameStateChangedTicks;
+		return Verdict::Wrong;
+	}
+
+	if (++location[session] != length[session])
+		return Verdict::Correct;
+
+	deadline[session] = now + buttonLitTicks;
+	location[session] = 0;
+	bestScore[session] = std::max(bestScore[session], (int32_t)length[session]);
+	length[session]++;
+	control[session] = (word & ~STATE_MASK) | GAME_STATE_PLAYBACK;
+	return Verdict::RoundComplete;
+}
+
+uint32_t SessionStore::TickScalar(int32_t now, uint32_t begin, uint32_t end) noexcept
+{
+	uint32_t changed = 0;
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		if (now <= deadline[i])
+			continue;
+
+		(void)Step(i, now, NO_BUTTON);
+		changed++;
+	}
+
+	return changed;
+}
+
+uint32_t SessionStore::Tick(int32_t now, uint32_t begin, uint32_t end) noexcept
+{
+	uint32_t changed = 0;
+
+#if defined(__AVX2__)
+	const __m256i now8 = _mm256_set1_epi32(now);
+	const __m256i litDeadline = _mm256_set1_epi32(now + buttonLitTicks);
+	const __m256i offDeadline = _mm256_set1_epi32(now + allButtonsOffTicks);
+	const __m256i stateMask = _mm256_set1_epi32((int)STATE_MASK);
+	const __m256i outstandingBit = _mm256_set1_epi32((int)OUTSTANDING_TIMER);
+	const __m256i litMask = _mm256_set1_epi32(7 << LIT_SHIFT);
+	const __m256i noTimer = _mm256_set1_epi32(NO_TIMER);
+	const __m256i input = _mm256_set1_epi32(GAME_STATE_INPUT);
+	const __m256i noButton = _mm256_set1_epi32(NO_BUTTON);
+	const __m256i one = _mm256_set1_epi32(1);
+
+	for (uint32_t i = begin; i < end; i += 8)
+	{
+		//nearly every group in a large store has nothing due, that costs one load and this test
+		const __m256i oldDeadline = _mm256_load_si256((const __m256i*)(deadline + i));
+		const __m256i due = _mm256_cmpgt_epi32(now8, oldDeadline);
+
+		if (_mm256_testz_si256(due, due))
+			continue;
+
+		const __m256i oldControl = _mm256_load_si256((const __m256i*)(control + i));
+		const __m256i outstanding = _mm256_cmpeq_epi32(_mm256_and_si256(oldControl, outstandingBit), outstandingBit);
+
+		changed += (uint32_t)std::popcount((uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(due)));
+
+		//an outstanding timer only clears itself, playback otherwise lights the next button or darkens the lit one
+		const __m256i step = _mm256_andnot_si256(outstanding, due);
+		const __m256i lit = _mm256_srli_epi32(_mm256_and_si256(oldControl, litMask), LIT_SHIFT);
+		const __m256i dark = _mm256_cmpeq_epi32(lit, noButton);
+		const __m256i lighting = _mm256_and_si256(step, dark);
+		const __m256i dimming = _mm256_andnot_si256(dark, step);
+
+		const __m256i oldLocation = _mm256_load_si256((const __m256i*)(location + i));
+		const __m256i ending = _mm256_and_si256(dimming, _mm256_cmpeq_epi32(oldLocation, _mm256_load_si256((const __m256i*)(length + i))));
+
+		__m256i newLit = _mm256_blendv_epi8(lit, noButton, dimming);
+		if (!_mm256_testz_si256(lighting, lighting))
+			newLit = _mm256_blendv_epi8(newLit, Buttons8(key + i, oldLocation), lighting);
+
+		__m256i newControl = _mm256_andnot_si256(_mm256_and_si256(due, _mm256_and_si256(outstanding, outstandingBit)), oldControl);
+		newControl = _mm256_or_si256(_mm256_andnot_si256(litMask, newControl), _mm256_slli_epi32(newLit, LIT_SHIFT));
+		newControl = _mm256_blendv_epi8(newControl, _mm256_or_si256(_mm256_andnot_si256(stateMask, newControl), input), ending);
+
+		const __m256i newLocation = _mm256_andnot_si256(ending, _mm256_blendv_epi8(oldLocation, _mm256_add_epi32(oldLocation, one), lighting));
+		const __m256i newDeadline = _mm256_blendv_epi8(_mm256_blendv_epi8(_mm256_blendv_epi8(oldDeadline, litDeadline, lighting), offDeadline, dimming), noTimer, ending);
+
+		_mm256_store_si256((__m256i*)(deadline + i), newDeadline);
+		_mm256_store_si256((__m256i*)(control + i), newControl);
+		_mm256_store_si256((__m256i*)(location + i), newLocation);
+	}
+#elif defined(__SSE2__) || defined(_M_X64)
+	const __m128i now4 = _mm_set1_epi32(now);
+	const __m128i litDeadline = _mm_set1_epi32(now + buttonLitTicks);
+	const __m128i offDeadline = _mm_set1_epi32(now + allButtonsOffTicks);
+	const __m128i stateMask = _mm_set1_epi32((int)STATE_MASK);
+	const __m128i outstandingBit = _mm_set1_epi32((int)OUTSTANDING_TIMER);
+	const __m128i litMask = _mm_set1_epi32(7 << LIT_SHIFT);
+	const __m128i noTimer = _mm_set1_epi32(NO_TIMER);
+	const __m128i input = _mm_set1_epi32(GAME_STATE_INPUT);
+	const __m128i noButton = _mm_set1_epi32(NO_BUTTON);
+	const __m128i one = _mm_set1_epi32(1);
+
+	for (uint32_t i = begin; i < end; i += 4)
+	{
+		const __m128i oldDeadline = _mm_load_si128((const __m128i*)(deadline + i));
+		const __m128i due = _mm_cmpgt_epi32(now4, oldDeadline);
+
+		const int dueMask = _mm_movemask_ps(_mm_castsi128_ps(due));
+		if (dueMask == 0)
+			continue;
+
+		const __m128i oldControl = _mm_load_si128((const __m128i*)(control + i));
+		const __m128i outstanding = _mm_cmpeq_epi32(_mm_and_si128(oldControl, outstandingBit), outstandingBit);
+
+		changed += (uint32_t)std::popcount((uint32_t)dueMask);
+
+		const __m128i step = _mm_andnot_si128(outstanding, due);
+		const __m128i lit = _mm_srli_epi32(_mm_and_si128(oldControl, litMask), LIT_SHIFT);
+		const __m128i dark = _mm_cmpeq_epi32(lit, noButton);
+		const __m128i lighting = _mm_and_si128(step, dark);
+		const __m128i dimming = _mm_andnot_si128(dark, step);
+
+		const __m128i oldLocation = _mm_load_si128((const __m128i*)(location + i));
+		const __m128i ending = _mm_and_si128(dimming, _mm_cmpeq_epi32(oldLocation, _mm_load_si128((const __m128i*)(length + i))));
+
+		__m128i newLit = Select(dimming, noButton, lit);
+		if (_mm_movemask_epi8(lighting) != 0)
+			newLit = Select(lighting, Buttons4(key + i, oldLocation), newLit);
+
+		__m128i newControl = _mm_andnot_si128(_mm_and_si128(due, _mm_and_si128(outstanding, outstandingBit)), oldControl);
+		newControl = _mm_or_si128(_mm_andnot_si128(litMask, newControl), _mm_slli_epi32(newLit, LIT_SHIFT));
+		newControl = Select(ending, _mm_or_si128(_mm_andnot_si128(stateMask, newControl), input), newControl);
+
+		const __m128i newLocation = _mm_andnot_si128(ending, Select(lighting, _mm_add_epi32(oldLocation, one), oldLocation));
+		const __m128i newDeadline = Select(ending, noTimer, Select(dimming, offDeadline, Select(lighting, litDeadline, oldDeadline)));
+
+		_mm_store_si128((__m128i*)(deadline + i), newDeadline);
+		_mm_store_si128((__m128i*)(control + i), newControl);
+		_mm_store_si128((__m128i*)(location + i), newLocation);
+	}
+#else
+	changed = TickScalar(now, begin, end);
+#endif
+
+	return changed;
+}
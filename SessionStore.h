@@ -0,0 +1,143 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "GameProtocol.h"
+#include "SimonCore.h"
+
+//millions of independent games as a structure of arrays, every field of every session has its own
+//contiguous array and all of them share one cache aligned arena, 28 bytes per session
+//Tick() advances the timers and playback of 8 sessions per instruction with AVX2, 4 with SSE2, a session
+//without a running timer has a deadline that never passes, so only the deadline of a session that is not
+//due is read and the tick runs at memory bandwidth
+//the rules are GameCore's, times are int32 ticks of the store's own clock, which at 1 kHz last 24 days,
+//so the timings have to be converted to that clock too
+
+using SessionId = uint32_t;
+
+constexpr SessionId NO_SESSION = UINT32_MAX;
+
+class SessionStore
+{
+public:
+	//capacity is rounded up to this, and ranges passed to Tick() start and end on it,
+	//so every vector load is aligned and every thread writes whole cache lines of its own
+	static constexpr uint32_t SESSION_ALIGNMENT = 16;
+
+	static constexpr size_t BYTES_PER_SESSION = 28;
+
+	SessionStore(const GameTimings& timings, uint32_t capacity, uint64_t seed) noexcept;
+	~SessionStore();
+
+	SessionStore(const SessionStore&) = delete;
+	SessionStore& operator=(const SessionStore&) = delete;
+
+	//a session in the menu, NO_SESSION once every slot is taken, freed slots are reused first
+	[[nodiscard]]
+	SessionId Allocate() noexcept;
+
+	void Free(SessionId session) noexcept;
+
+	//GameCore::StartGame
+	void StartGame(SessionId session, int32_t now) noexcept;
+
+	//GameCore::Tick with button clicked, timers due by now run first and a press during them is ignored
+	Verdict Press(SessionId session, int button, int32_t now) noexcept;
+
+	//GameCore::ReturnToMenu
+	void ReturnToMenu(SessionId session) noexcept;
+
+	//GameCore::Tick(now, {}) on every session in [begin, end), both multiples of SESSION_ALIGNMENT,
+	//returns how many sessions changed, different threads may tick different ranges at once
+	uint32_t Tick(int32_t now, uint32_t begin, uint32_t end) noexcept;
+
+	uint32_t Tick(int32_t now) noexcept { return Tick(now, 0, capacity); }
+
+	//the same one session at a time, what Tick() is checked and measured against
+	uint32_t TickScalar(int32_t now, uint32_t begin, uint32_t end) noexcept;
+
+	[[nodiscard]]
+	uint32_t Capacity() const noexcept { return capacity; }
+
+	[[nodiscard]]
+	uint32_t SessionCount() const noexcept { return sessionCount; }
+
+	[[nodiscard]]
+	int State(SessionId session) const noexcept { return (int)(control[session] & STATE_MASK); }
+
+	[[nodiscard]]
+	bool OutstandingTimer(SessionId session) const noexcept { return (control[session] & OUTSTANDING_TIMER) != 0; }
+
+	//lit by playback, NO_BUTTON between buttons
+	[[nodiscard]]
+	int LitButton(SessionId session) const noexcept { return (int)(control[session] >> LIT_SHIFT & 7); }
+
+	[[nodiscard]]
+	bool AwaitingInput(SessionId session) const noexcept { return (control[session] & (STATE_MASK | OUTSTANDING_TIMER)) == GAME_STATE_INPUT; }
+
+	[[nodiscard]]
+	int PlaybackLength(SessionId session) const noexcept { return (int)length[session]; }
+
+	[[nodiscard]]
+	int PlaybackLocation(SessionId session) const noexcept { return (int)location[session]; }
+
+	[[nodiscard]]
+	int BestScore(SessionId session) const noexcept { return bestScore[session]; }
+
+	//only meaningful while a timer runs, in playback or with one outstanding
+	[[nodiscard]]
+	int32_t Deadline(SessionId session) const noexcept { return deadline[session]; }
+
+	//the counter rng key of the session's current game
+	[[nodiscard]]
+	uint64_t SequenceKey(SessionId session) const noexcept { return key[session]; }
+
+	//GameCore::ButtonAt
+	[[nodiscard]]
+	int ButtonAt(SessionId session, uint32_t step) const noexcept { return step == 0 ? 1 : CounterRng{ .key = key[session] }.Button(step); }
+
+private:
+	//control word: game state, then the outstanding timer flag, then the lit button
+	static constexpr uint32_t STATE_MASK = 3;
+	//a slot nobody holds, its location links the free list
+	static constexpr uint32_t STATE_FREE = 3;
+	//deadline of every session in the menu, waiting for input or free
+	static constexpr int32_t NO_TIMER = INT32_MAX;
+	static constexpr uint32_t OUTSTANDING_TIMER = 4;
+	static constexpr uint32_t LIT_SHIFT = 8;
+
+	[[nodiscard]]
+	uint64_t NextKey() noexcept { return CounterRng::ForStream(seed, nextStream++).key; }
+
+	//one session, GameCore::Tick with button clicked or NO_BUTTON
+	Verdict Step(SessionId session, int32_t now, int button) noexcept;
+
+	int32_t buttonLitTicks;
+	int32_t allButtonsOffTicks;
+	int32_t gameStateChangedTicks;
+
+	uint64_t seed;
+	uint64_t nextStream = 0;
+
+	uint32_t capacity;
+	uint32_t sessionCount = 0;
+	//slots below this have been handed out at least once
+	uint32_t highWater = 0;
+	SessionId freeList = NO_SESSION;
+
+	//every array below lives in arena
+	void* arena;
+	int32_t* deadline;
+	uint32_t* control;
+	uint32_t* location;
+	uint32_t* length;
+	int32_t* bestScore;
+	uint64_t* key;
+};
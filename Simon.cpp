@@ -5,11 +5,27 @@
 */
 
 #include <Windows.h>
+#include <windowsx.h>
 #include <wrl.h>
 #include <d2d1.h>
 #include <dwrite.h>
 #include <sstream>
 #include <cmath>
+#include <optional>
+
+#include "SimonCore.h"
+#include "EventLoop.h"
+#include "BoardGeometry.h"
+#include "RenderBackend.h"
+#include "Scene.h"
+#include "InputQueue.h"
+#include "LogicThread.h"
+#include "InputRecording.h"
+#include "StatsStore.h"
+#include "GameHistory.h"
+#include "StateExport.h"
+#include "FrameProfiler.h"
+#include "DeviceResources.h"
 
 #pragma comment(lib, "d2d1")
 #pragma comment(lib, "dwrite")
@@ -68,617 +84,433 @@ using Microsoft::WRL::ComPtr;
 ComPtr<ID2D1Factory> factory;
 ComPtr<ID2D1HwndRenderTarget> renderTarget;
 
-ComPtr<ID2D1SolidColorBrush> brush;
-ComPtr<ID2D1SolidColorBrush> ScoreBrush;
-ComPtr<ID2D1SolidColorBrush> LightGrayBrush;
+ComPtr<ID2D1SolidColorBrush> brushes[(size_t)Paint::Count];
 
 ComPtr<IDWriteFactory> pDWriteFactory;
 
-ComPtr<IDWriteTextFormat> TitleTextFormat;
-ComPtr<IDWriteTextFormat> pTextFormat;
-ComPtr<IDWriteTextFormat> CopyrightTextFormat;
+ComPtr<IDWriteTextFormat> textFormats[(size_t)TextStyle::Count];
 
-struct Button
-{
-	ComPtr<ID2D1PathGeometry> Geometry;
-	ComPtr<ID2D1SolidColorBrush> Brush;
-	ComPtr<ID2D1SolidColorBrush> LitBrush;
-};
-
-struct Button buttons[4];
-
-int currentLitButton = 4;
-int playbackValues[256] = { 1 };
-int playbackLength = 1;
-int playbackLocation = 0;
-int bestScore = 0;
-bool mouseClicked = false;
-int gameState = 0;
-bool bOutstandingTimer;
-bool bGeometryIsValid = false;
+//laid out on first use after the text formats were created, instead of by DrawTextW on every frame
+ComPtr<IDWriteTextLayout> staticTextLayouts[(size_t)StaticText::Count];
 
-LRESULT CALLBACK PreInitProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) noexcept;
-LRESULT CALLBACK IdleProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) noexcept;
-LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) noexcept;
+//path geometries are device independent, so they outlive the render target
+GeometryCache<std::array<ComPtr<ID2D1PathGeometry>, BUTTON_COUNT>> geometryCache;
 
-LARGE_INTEGER ButtonLitTicks;
-LARGE_INTEGER AllButtonsOffTicks;
-LARGE_INTEGER GameStateChangedTicks;
-LARGE_INTEGER CurrentTimerFinished;
+struct QpcClock final : GameClock
+{
+	[[nodiscard]]
+	int64_t Now() noexcept override
+	{
+		LARGE_INTEGER tickCountNow;
+		FATAL_ON_FALSE(QueryPerformanceCounter(&tickCountNow));
+		return tickCountNow.QuadPart;
+	}
 
-int windowWidth = 0;
-int windowHeight = 0;
+	[[nodiscard]]
+	int64_t Frequency() noexcept override
+	{
+		LARGE_INTEGER ProcessorFrequency;
+		FATAL_ON_FALSE(QueryPerformanceFrequency(&ProcessorFrequency));
+		return ProcessorFrequency.QuadPart;
+	}
+};
 
-[[nodiscard]]
-constexpr float frad(float degrees) noexcept{
-	return degrees * 3.14159265359f / 180.0f;
-}
+QpcClock gameClock;
 
-void CreateAssets() noexcept
-{
-	RECT ClientRect;
-	FATAL_ON_FALSE(GetClientRect(Window, &ClientRect));
+//judges input and runs the timers on its own thread, WindowProc queues input into it and paints its snapshots
+std::optional<LogicThread> logic;
 
-	D2D1_SIZE_U size = D2D1::SizeU(ClientRect.right, ClientRect.bottom);
+//every game of the session, so a reported problem can be replayed with SimonReplay
+InputRecorder recorder;
+constexpr char RECORDING_PATH[] = "SimonRecording.rec";
 
-	FATAL_ON_FAIL(factory->CreateHwndRenderTarget(
-		D2D1::RenderTargetProperties(),
-		D2D1::HwndRenderTargetProperties(Window, size),
-		&renderTarget));
+//lifetime stats and every finished game, the best score carries over between sessions from here
+StatsStore statsStore;
+constexpr char STATS_PATH[] = "SimonStats.dat";
 
-	renderTarget->SetDpi(96, 96);
+//every finished game with the reaction time of each press, by column, for SimonHistory to query
+GameHistoryWriter history;
+constexpr char HISTORY_PATH[] = "SimonHistory.dat";
 
-	FATAL_ON_FAIL(renderTarget->CreateSolidColorBrush(D2D1::ColorF(1.0f, 1.0f, 0.0f), &brush));
-	FATAL_ON_FAIL(renderTarget->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.0f, 1.0f), &ScoreBrush));
-	FATAL_ON_FAIL(renderTarget->CreateSolidColorBrush(D2D1::ColorF(.564f, .564f, .564f), &LightGrayBrush));
+//score, lit button, phase and timers in shared memory for overlays, see SimonStateWatch
+StateExporter stateExport;
 
-	FATAL_ON_FAIL(renderTarget->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.7f, 0.0f), &buttons[0].Brush));
-	FATAL_ON_FAIL(renderTarget->CreateSolidColorBrush(D2D1::ColorF(0.0f, 1.0f, 0.0f), &buttons[0].LitBrush));
+//posted by the logic thread whenever it published a new snapshot
+constexpr UINT WM_SNAPSHOT_PUBLISHED = WM_APP + 1;
 
-	FATAL_ON_FAIL(renderTarget->CreateSolidColorBrush(D2D1::ColorF(0.7f, 0.7f, 0.0f), &buttons[1].Brush));
-	FATAL_ON_FAIL(renderTarget->CreateSolidColorBrush(D2D1::ColorF(1.0f, 1.0f, 0.0f), &buttons[1].LitBrush));
+//sleeps in MsgWaitForMultipleObjectsEx until a message arrives or the next deadline passes
+struct Win32EventLoop final : EventLoop
+{
+	DWORD threadId = GetCurrentThreadId();
+	int64_t frequency = gameClock.Frequency();
 
-	FATAL_ON_FAIL(renderTarget->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.0f, 0.7f), &buttons[2].Brush));
-	FATAL_ON_FAIL(renderTarget->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.0f, 1.0f), &buttons[2].LitBrush));
+	[[nodiscard]]
+	WakeReason WaitUntil(int64_t deadline) noexcept override
+	{
+		DWORD timeout = INFINITE;
 
-	FATAL_ON_FAIL(renderTarget->CreateSolidColorBrush(D2D1::ColorF(0.7f, 0.0f, 0.0f), &buttons[3].Brush));
-	FATAL_ON_FAIL(renderTarget->CreateSolidColorBrush(D2D1::ColorF(1.0f, 0.0f, 0.0f), &buttons[3].LitBrush));
+		if (deadline != NO_DEADLINE)
+		{
+			const int64_t remaining = deadline - gameClock.Now();
+			if (remaining <= 0)
+				return WakeReason::Deadline;
 
+			//round up so we never wake just before the deadline and spin
+			timeout = (DWORD)min((remaining * 1000 + frequency - 1) / frequency, (int64_t)INFINITE - 1);
+		}
 
-	bGeometryIsValid = false;
+		const DWORD waitResult = MsgWaitForMultipleObjectsEx(0, nullptr, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+		FATAL_ON_FALSE(waitResult != WAIT_FAILED);
 
-	FATAL_ON_FAIL(pDWriteFactory->CreateTextFormat(
-		L"Segoe UI",
-		NULL,
-		DWRITE_FONT_WEIGHT_NORMAL,
-		DWRITE_FONT_STYLE_NORMAL,
-		DWRITE_FONT_STRETCH_NORMAL,
-		.12f * windowHeight,
-		L"en-us",
-		&TitleTextFormat
-	));
+		return waitResult == WAIT_TIMEOUT ? WakeReason::Deadline : WakeReason::Event;
+	}
 
-	FATAL_ON_FAIL(TitleTextFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER));
-
-	FATAL_ON_FAIL(pDWriteFactory->CreateTextFormat(
-		L"Segoe UI",
-		NULL,
-		DWRITE_FONT_WEIGHT_NORMAL,
-		DWRITE_FONT_STYLE_NORMAL,
-		DWRITE_FONT_STRETCH_NORMAL,
-		.08f * windowHeight,
-		L"en-us",
-		&pTextFormat
-	));
+	void Wake() noexcept override
+	{
+		FATAL_ON_FALSE(PostThreadMessageW(threadId, WM_NULL, 0, 0));
+	}
+};
 
-	FATAL_ON_FAIL(pTextFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER));
-
-	FATAL_ON_FAIL(pDWriteFactory->CreateTextFormat(
-		L"Segoe UI",
-		NULL,
-		DWRITE_FONT_WEIGHT_NORMAL,
-		DWRITE_FONT_STYLE_NORMAL,
-		DWRITE_FONT_STRETCH_NORMAL,
-		.05f * windowHeight,
-		L"en-us",
-		&CopyrightTextFormat
-	));
+LRESULT CALLBACK PreInitProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) noexcept;
+LRESULT CALLBACK IdleProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) noexcept;
+LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) noexcept;
 
-	FATAL_ON_FAIL(CopyrightTextFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER));
-}
+int windowWidth = 0;
+int windowHeight = 0;
 
-void DrawMenu() noexcept
+//device dependent resources live as long as the render target, text formats as long as the scene height
+struct Direct2DResourceFactory final : ResourceFactory
 {
-	if (renderTarget == nullptr)
+	void CreateRenderTarget(uint32_t pixelWidth, uint32_t pixelHeight, uint32_t dpi) noexcept override
 	{
-		CreateAssets();
-	}
+		//frames only redraw what changed, so the previous contents have to survive presenting
+		FATAL_ON_FAIL(factory->CreateHwndRenderTarget(
+			D2D1::RenderTargetProperties(),
+			D2D1::HwndRenderTargetProperties(Window, D2D1::SizeU(pixelWidth, pixelHeight), D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS),
+			&renderTarget));
 
-	renderTarget->BeginDraw();
-	renderTarget->Clear();
+		renderTarget->SetDpi((FLOAT)dpi, (FLOAT)dpi);
+	}
 
+	void ResizeRenderTarget(uint32_t pixelWidth, uint32_t pixelHeight, uint32_t dpi) noexcept override
 	{
-		//title
-		D2D1_RECT_F textArea =
-		{
-			.left = 0,
-			.top = windowHeight * .1f,
-			.right = (FLOAT)windowWidth,
-			.bottom = windowHeight * .8f
-		};
-		renderTarget->DrawTextW(L"SIMON", 5, TitleTextFormat.Get(), textArea, ScoreBrush.Get());
+		FATAL_ON_FAIL(renderTarget->Resize(D2D1::SizeU(pixelWidth, pixelHeight)));
+		renderTarget->SetDpi((FLOAT)dpi, (FLOAT)dpi);
 	}
 
-	POINT cursorPos;
-	FATAL_ON_FALSE(GetCursorPos(&cursorPos));
-	FATAL_ON_FALSE(ScreenToClient(Window, &cursorPos));
-
+	void CreateBrush(Paint paint) noexcept override
 	{
-		//play button
-		D2D1_RECT_F textArea =
-		{
-			.left = 0,
-			.top = windowHeight * .3f,
-			.right = (FLOAT)windowWidth,
-			.bottom = windowHeight * .8f
-		};
-		renderTarget->DrawTextW(L"PLAY", 4, pTextFormat.Get(), textArea, LightGrayBrush.Get());
+		const Color& color = PALETTE[(size_t)paint];
+		FATAL_ON_FAIL(renderTarget->CreateSolidColorBrush(D2D1::ColorF(color.r, color.g, color.b), brushes[(size_t)paint].ReleaseAndGetAddressOf()));
 	}
 
+	void CreateTextFormat(TextStyle style, float fontSize) noexcept override
 	{
-		//exit button
-		D2D1_RECT_F textArea =
+		ComPtr<IDWriteTextFormat>& textFormat = textFormats[(size_t)style];
+
+		FATAL_ON_FAIL(pDWriteFactory->CreateTextFormat(
+			L"Segoe UI",
+			NULL,
+			DWRITE_FONT_WEIGHT_NORMAL,
+			DWRITE_FONT_STYLE_NORMAL,
+			DWRITE_FONT_STRETCH_NORMAL,
+			fontSize,
+			L"en-us",
+			textFormat.ReleaseAndGetAddressOf()
+		));
+
+		FATAL_ON_FAIL(textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER));
+
+		//layouts keep the format they were made with
+		for (ComPtr<IDWriteTextLayout>& layout : staticTextLayouts)
 		{
-			.left = 0,
-			.top = windowHeight * .45f,
-			.right = (FLOAT)windowWidth,
-			.bottom = windowHeight * .8f
-		};
-		renderTarget->DrawTextW(L"EXIT", 4, pTextFormat.Get(), textArea, LightGrayBrush.Get());
+			layout.Reset();
+		}
 	}
 
+	void ReleaseDeviceResources() noexcept override
 	{
-		//copyright
-		D2D1_RECT_F textArea =
+		for (ComPtr<ID2D1SolidColorBrush>& brush : brushes)
 		{
-			.left = 0,
-			.top = windowHeight * .9f,
-			.right = (FLOAT)windowWidth,
-			.bottom = windowHeight * 1.f
-		};
-		renderTarget->DrawTextW(L"\u24B8 2023 badasahog. All Rights Reserved", 37, CopyrightTextFormat.Get(), textArea, LightGrayBrush.Get());
+			brush.Reset();
+		}
+
+		renderTarget.Reset();
 	}
+};
 
-	if (cursorPos.x > windowWidth * .4f &&
-		cursorPos.x < windowWidth * .6f &&
-		cursorPos.y > windowHeight * .3f &&
-		cursorPos.y < windowHeight * .4f)
-	{
-		//play button
-		D2D1_RECT_F textArea =
-		{
-			.left = 0,
-			.top = windowHeight * .3f,
-			.right = (FLOAT)windowWidth,
-			.bottom = windowHeight * .8f
-		};
+Direct2DResourceFactory resourceFactory;
+DeviceResources deviceResources;
 
-		renderTarget->DrawTextW(L"PLAY", 4, pTextFormat.Get(), textArea, brush.Get());
+//set by EndDraw, handled once the frame is over
+bool bDeviceLost = false;
 
-		if (mouseClicked)
-		{
-			gameState = 1;
-			bOutstandingTimer = true;
-			LARGE_INTEGER tickCountNow;
-			FATAL_ON_FALSE(QueryPerformanceCounter(&tickCountNow));
-			CurrentTimerFinished.QuadPart = tickCountNow.QuadPart + GameStateChangedTicks.QuadPart;
-		}
-	}
-	else if (
-		cursorPos.x > windowWidth * .4f &&
-		cursorPos.x < windowWidth * .6f &&
-		cursorPos.y > windowHeight * .45f &&
-		cursorPos.y < windowHeight * .55f)
-	{
-		//exit button
-		D2D1_RECT_F textArea =
-		{
-			.left = 0,
-			.top = windowHeight * .45f,
-			.right = (FLOAT)windowWidth,
-			.bottom = windowHeight * .8f
-		};
-		renderTarget->DrawTextW(L"EXIT", 4, pTextFormat.Get(), textArea, brush.Get());
+//creates whatever is missing, a size or dpi change only resizes the render target
+void UpdateAssets() noexcept
+{
+	PROFILE_SCOPE(ProfilePhase::CreateAssets);
 
-		if (mouseClicked)
-		{
-			ExitProcess(EXIT_SUCCESS);
-		}
-	}
+	RECT ClientRect;
+	FATAL_ON_FALSE(GetClientRect(Window, &ClientRect));
 
-	mouseClicked = false;
+	deviceResources.Update(resourceFactory, ClientRect.right, ClientRect.bottom, GetDpiForWindow(Window));
 
-	FATAL_ON_FAIL(renderTarget->EndDraw());
+	if (logic)
+		logic->SetSceneSize((FLOAT)deviceResources.SceneWidth(), (FLOAT)deviceResources.SceneHeight());
 }
 
-void DrawGame() noexcept
+//cursor and mouse message positions are in pixels, the scene is in dips
+[[nodiscard]]
+Point2 ClientToScene(int x, int y) noexcept
+{
+	const UINT dpi = GetDpiForWindow(Window);
+	return { .x = PixelsToDips((FLOAT)x, dpi), .y = PixelsToDips((FLOAT)y, dpi) };
+}
+
+struct Direct2DBackend final : RenderBackend
 {
-	if (renderTarget == nullptr)
+	void BeginDraw() noexcept override
 	{
-		CreateAssets();
+		renderTarget->BeginDraw();
 	}
 
-	renderTarget->BeginDraw();
-	renderTarget->Clear();
-
-	FLOAT ScoreWidth = .2 * windowWidth;
-
+	void EndDraw() noexcept override
 	{
-		D2D1_RECT_F textArea =
+		const HRESULT hr = renderTarget->EndDraw();
+
+		//driver updates, remote desktop and the like take the device away
+		if (hr == D2DERR_RECREATE_TARGET)
 		{
-			.left = 0,
-			.top = 0,
-			.right = (FLOAT)windowWidth / 2 - ScoreWidth,
-			.bottom = (.1f / .5f) * windowHeight
-		};
+			bDeviceLost = true;
+			return;
+		}
 
-		renderTarget->DrawTextW(L"score", 5, pTextFormat.Get(), textArea, ScoreBrush.Get());
+		FATAL_ON_FAIL(hr);
 	}
 
+	void Clear() noexcept override
 	{
-		D2D1_RECT_F textArea =
-		{
-			.left = (FLOAT)windowWidth / 2 - ScoreWidth,
-			.top = 0,
-			.right = (FLOAT)windowWidth / 2,
-			.bottom = (.1f / .5f) * windowHeight
-		};
-
-		std::wstring scoreText = std::to_wstring(playbackLength - 1);
-		renderTarget->DrawTextW(scoreText.c_str(), scoreText.length(), pTextFormat.Get(), textArea, ScoreBrush.Get());
+		renderTarget->Clear();
 	}
 
-
+	void PushClip(const Rect& area) noexcept override
 	{
-		D2D1_RECT_F textArea =
-		{
-			.left = (FLOAT)windowWidth / 2 + ScoreWidth,
-			.top = 0,
-			.right = (FLOAT)windowWidth,
-			.bottom = (.1f / .5f) * windowHeight
-		};
-
-		std::wstring scoreText = std::to_wstring(bestScore);
+		renderTarget->PushAxisAlignedClip(D2D1::RectF(area.left, area.top, area.right, area.bottom), D2D1_ANTIALIAS_MODE_ALIASED);
+	}
 
-		renderTarget->DrawTextW(scoreText.c_str(), scoreText.length(), pTextFormat.Get(), textArea, ScoreBrush.Get());
+	void PopClip() noexcept override
+	{
+		renderTarget->PopAxisAlignedClip();
 	}
 
+	void FillButton(const BoardLayout& layout, int button, Paint paint) noexcept override
 	{
-		D2D1_RECT_F textArea =
+		//geometry is in dips, so a dpi change reuses it
+		const GeometryKey geometryKey =
 		{
-			.left = (FLOAT)windowWidth / 2,
-			.top = 0,
-			.right = (FLOAT)windowWidth / 2 + ScoreWidth,
-			.bottom = (.1f / .5f) * windowHeight
+			.width = deviceResources.SceneWidth(),
+			.height = deviceResources.SceneHeight(),
+			.dpi = DEFAULT_DPI
 		};
 
-		renderTarget->DrawTextW(L"best", 4, pTextFormat.Get(), textArea, ScoreBrush.Get());
-	}
+		const auto& buttonGeometry = geometryCache.GetOrBuild(geometryKey, [&](std::array<ComPtr<ID2D1PathGeometry>, BUTTON_COUNT>& geometry)
+			{
+				PROFILE_SCOPE(ProfilePhase::GeometryBuild);
 
+				for (int i = 0; i < BUTTON_COUNT; i++)
+				{
+					const WedgeOutline outline = BuildWedgeOutline(layout, i);
 
-	D2D1_RECT_F boardArea =
-	{
-		.left = .205f / 2 * (FLOAT)windowWidth,
-		.top = (.1f / .8f) * windowHeight,
-		.right = (FLOAT)windowWidth - .205f / 2 * (FLOAT)windowWidth,
-		.bottom = (FLOAT)windowHeight - .08f * windowHeight
-	};
+					FATAL_ON_FAIL(factory->CreatePathGeometry(geometry[i].ReleaseAndGetAddressOf()));
 
-	float boardWidth = boardArea.right - boardArea.left;
+					ID2D1GeometrySink* pSink;
 
-	float fullRadius = boardWidth / 2;
+					FATAL_ON_FAIL(geometry[i]->Open(&pSink));
 
-	float innerCircleRadius = boardWidth * .2f;
+					pSink->SetFillMode(D2D1_FILL_MODE_WINDING);
 
-	float outerRimRadius = fullRadius - innerCircleRadius;
+					pSink->BeginFigure(D2D1::Point2F(outline.start.x, outline.start.y), D2D1_FIGURE_BEGIN_FILLED);
 
-	if (!bGeometryIsValid)
-	{
-		for (int i = 0; i < 4; i++)
-		{
-			const float buttonOffsetAngle = i * 90;
-
-			FATAL_ON_FAIL(factory->CreatePathGeometry(&buttons[i].Geometry));
-
-			ID2D1GeometrySink* pSink;
-
-			FATAL_ON_FAIL(buttons[i].Geometry->Open(&pSink));
-
-			pSink->SetFillMode(D2D1_FILL_MODE_WINDING);
-
-
-			const float outercirclebevel = 2.5f;
-			const float innercirclebevel = 4.2f;
-
-			const float outerSliceMargin = 3.f;
-			const float innerSliceMargin = 11.f;
-
-			const float lateralMargin = outerRimRadius * .05f;
-
-			pSink->BeginFigure(D2D1::Point2F(
-				boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + 90 - outerSliceMargin)) * (fullRadius - lateralMargin),
-				boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + 90 - outerSliceMargin)) * (fullRadius - lateralMargin)),
-				D2D1_FIGURE_BEGIN_FILLED);
-
-
-
-			//outer rim
-			pSink->AddBezier(
-				D2D1::BezierSegment(
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + 90 - outerSliceMargin)) * (fullRadius - lateralMargin),
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + 90 - outerSliceMargin)) * (fullRadius - lateralMargin)
-					),
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + 90 - outerSliceMargin)) * fullRadius,
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + 90 - outerSliceMargin)) * fullRadius
-					),
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + 90 - outerSliceMargin - outercirclebevel)) * fullRadius,
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + 90 - outerSliceMargin - outercirclebevel)) * fullRadius
-					)
-				));
-
-			pSink->AddBezier(
-				D2D1::BezierSegment(
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + 90 - outerSliceMargin - outercirclebevel)) * fullRadius,
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + 90 - outerSliceMargin - outercirclebevel)) * fullRadius
-					),
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + 45)) * (fullRadius * 1.3),
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + 45)) * (fullRadius * 1.3)
-					),
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + outerSliceMargin + outercirclebevel)) * fullRadius,
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + outerSliceMargin + outercirclebevel)) * fullRadius
-					)
-				));
-
-			pSink->AddBezier(
-				D2D1::BezierSegment(
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + outerSliceMargin + outercirclebevel)) * fullRadius,
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + outerSliceMargin + outercirclebevel)) * fullRadius
-					),
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + outerSliceMargin)) * fullRadius,
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + outerSliceMargin)) * fullRadius
-					),
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + outerSliceMargin)) * (fullRadius - lateralMargin),
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + outerSliceMargin)) * (fullRadius - lateralMargin)
-					)
-				));
-
-			//inner rim
-			pSink->AddBezier(
-				D2D1::BezierSegment(
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + innerSliceMargin)) * (innerCircleRadius + lateralMargin),
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + innerSliceMargin)) * (innerCircleRadius + lateralMargin)
-					),
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + innerSliceMargin)) * innerCircleRadius,
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + innerSliceMargin)) * innerCircleRadius
-					),
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + innerSliceMargin + innercirclebevel)) * innerCircleRadius,
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + innerSliceMargin + innercirclebevel)) * innerCircleRadius
-					)
-				));
-
-			pSink->AddBezier(
-				D2D1::BezierSegment(
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + innerSliceMargin + innercirclebevel)) * innerCircleRadius,
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + innerSliceMargin + innercirclebevel)) * innerCircleRadius
-					),
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + 45)) * (innerCircleRadius * 1.2),
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + 45)) * (innerCircleRadius * 1.2)
-					),
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + 90 - innerSliceMargin - innercirclebevel)) * innerCircleRadius,
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + 90 - innerSliceMargin - innercirclebevel)) * innerCircleRadius
-					)
-				));
-
-			pSink->AddBezier(
-				D2D1::BezierSegment(
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + 90 - innerSliceMargin - innercirclebevel)) * innerCircleRadius,
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + 90 - innerSliceMargin - innercirclebevel)) * innerCircleRadius
-					),
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + 90 - innerSliceMargin)) * innerCircleRadius,
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + 90 - innerSliceMargin)) * innerCircleRadius
-					),
-					D2D1::Point2F(
-						boardArea.left + fullRadius + -sinf(frad(buttonOffsetAngle + 90 - innerSliceMargin)) * (innerCircleRadius + lateralMargin),
-						boardArea.top + fullRadius + -cosf(frad(buttonOffsetAngle + 90 - innerSliceMargin)) * (innerCircleRadius + lateralMargin)
-					)
-				));
-
-
-			pSink->EndFigure(D2D1_FIGURE_END_CLOSED);
-
-			FATAL_ON_FAIL(pSink->Close());
-
-			FATAL_ON_FAIL(pSink->Release());
-		}
-		
+					for (const BezierSegment& segment : outline.segments)
+					{
+						pSink->AddBezier(
+							D2D1::BezierSegment(
+								D2D1::Point2F(segment.point1.x, segment.point1.y),
+								D2D1::Point2F(segment.point2.x, segment.point2.y),
+								D2D1::Point2F(segment.point3.x, segment.point3.y)
+							));
+					}
 
-		bGeometryIsValid = true;
-	}
+					pSink->EndFigure(D2D1_FIGURE_END_CLOSED);
 
-	LARGE_INTEGER tickCountNow;
-	FATAL_ON_FALSE(QueryPerformanceCounter(&tickCountNow));
+					FATAL_ON_FAIL(pSink->Close());
 
-	if (bOutstandingTimer)
-	{
-		if (CurrentTimerFinished.QuadPart < tickCountNow.QuadPart)
-		{
-			bOutstandingTimer = false;
-		}
+					pSink->Release();
+				}
+			});
 
-		for (int i = 0; i < 4; i++)
-		{
-			renderTarget->FillGeometry(buttons[i].Geometry.Get(), buttons[i].Brush.Get());
-		}
+		renderTarget->FillGeometry(buttonGeometry[button].Get(), brushes[(size_t)paint].Get());
 	}
-	else switch(gameState)
-	{
-	case 1:
+
+	void DrawCircle(Point2 center, float radius, Paint paint) noexcept override
 	{
-		//playback mode
-		if (CurrentTimerFinished.QuadPart < tickCountNow.QuadPart)
+		D2D1_ELLIPSE ellipse
 		{
-			if (currentLitButton == 4)
+			.point =
 			{
-				currentLitButton = playbackValues[playbackLocation];
+				.x = center.x,
+				.y = center.y
+			},
+			.radiusX = radius,
+			.radiusY = radius
+		};
 
-				CurrentTimerFinished.QuadPart = tickCountNow.QuadPart + ButtonLitTicks.QuadPart;
+		renderTarget->DrawEllipse(&ellipse, brushes[(size_t)paint].Get());
+	}
 
-				playbackLocation++;
-			}
-			else
-			{
-				currentLitButton = 4;
+	void DrawString(const wchar_t* text, uint32_t length, TextStyle style, const Rect& area, Paint paint) noexcept override
+	{
+		D2D1_RECT_F textArea =
+		{
+			.left = area.left,
+			.top = area.top,
+			.right = area.right,
+			.bottom = area.bottom
+		};
 
-				if (playbackLocation == playbackLength)
-				{
-					gameState = 2;
-					playbackLocation = 0;
-				}
+		renderTarget->DrawTextW(text, length, textFormats[(size_t)style].Get(), textArea, brushes[(size_t)paint].Get());
+	}
 
-				CurrentTimerFinished.QuadPart = tickCountNow.QuadPart + AllButtonsOffTicks.QuadPart;
-			}
-		}
+	void DrawStaticText(StaticText text, TextStyle style, const Rect& area, Paint paint) noexcept override
+	{
+		ComPtr<IDWriteTextLayout>& layout = staticTextLayouts[(size_t)text];
 
-		for (int i = 0; i < 4; i++)
+		if (layout == nullptr)
 		{
-			renderTarget->FillGeometry(buttons[i].Geometry.Get(), (i == currentLitButton) ? buttons[i].LitBrush.Get() : buttons[i].Brush.Get());
+			const StaticTextString& string = STATIC_TEXT_STRINGS[(size_t)text];
+
+			FATAL_ON_FAIL(pDWriteFactory->CreateTextLayout(
+				string.text,
+				string.length,
+				textFormats[(size_t)style].Get(),
+				area.right - area.left,
+				area.bottom - area.top,
+				&layout
+			));
 		}
 
-		break;
+		renderTarget->DrawTextLayout(D2D1::Point2F(area.left, area.top), layout.Get(), brushes[(size_t)paint].Get());
 	}
-	case 2:
-	{
-		POINT cursorPos;
-		FATAL_ON_FALSE(GetCursorPos(&cursorPos));
-		FATAL_ON_FALSE(ScreenToClient(Window, &cursorPos));
-
-		D2D1_POINT_2F cursor_point2f =
-		{
-			.x = (FLOAT)cursorPos.x,
-			.y = (FLOAT)cursorPos.y
-		};
+};
 
-		BOOL inButton;
+Direct2DBackend backend;
+RetainedScene retainedScene;
 
-		for (int i = 0; i < 4; i++)
-		{
-			buttons[i].Geometry->FillContainsPoint(cursor_point2f, nullptr, &inButton);
+//paints we did not ask for (uncovering the window etc.) need the whole frame
+bool bRepaintRequested = false;
 
-			renderTarget->FillGeometry(buttons[i].Geometry.Get(), inButton ? buttons[i].LitBrush.Get() : buttons[i].Brush.Get());
+void RequestRepaint(HWND hwnd) noexcept
+{
+	bRepaintRequested = true;
+	FATAL_ON_FALSE(InvalidateRect(hwnd, nullptr, FALSE));
+}
 
-			if (inButton && mouseClicked)
-			{
-				if (i == playbackValues[playbackLocation])
-				{
-					playbackLocation++;
-					if (playbackLocation == playbackLength)
-					{
-						CurrentTimerFinished.QuadPart = tickCountNow.QuadPart + ButtonLitTicks.QuadPart;
+void DrawMenu() noexcept
+{
+	if (!deviceResources.HasRenderTarget())
+	{
+		UpdateAssets();
+	}
 
-						playbackValues[playbackLocation] = rand() % 4;
-						playbackLocation = 0;
-						bestScore = max(bestScore, playbackLength);
-						playbackLength++;
-						gameState = 1;
-					}
-				}
-				else
-				{
-					playbackLength = 1;
-					playbackLocation = 0;
-					gameState = 1;
+	const uint32_t sceneWidth = deviceResources.SceneWidth();
+	const uint32_t sceneHeight = deviceResources.SceneHeight();
 
-					bOutstandingTimer = true;
-					CurrentTimerFinished.QuadPart = tickCountNow.QuadPart + GameStateChangedTicks.QuadPart;
-				}
-			}
-		}
+	POINT cursorPos;
+	FATAL_ON_FALSE(GetCursorPos(&cursorPos));
+	FATAL_ON_FALSE(ScreenToClient(Window, &cursorPos));
+	const Point2 cursor = ClientToScene(cursorPos.x, cursorPos.y);
 
-		break;
+	MenuItem hoveredMenuItem;
+	{
+		PROFILE_SCOPE(ProfilePhase::HitTest);
+		hoveredMenuItem = MenuHitTest(cursor.x, cursor.y, (FLOAT)sceneWidth, (FLOAT)sceneHeight);
 	}
+
+	(void)retainedScene.Draw(backend, MenuSceneState(sceneWidth, sceneHeight, hoveredMenuItem));
+}
+
+void DrawGame(const GameSnapshot& snapshot) noexcept
+{
+	if (!deviceResources.HasRenderTarget())
+	{
+		UpdateAssets();
 	}
 
+	const uint32_t sceneWidth = deviceResources.SceneWidth();
+	const uint32_t sceneHeight = deviceResources.SceneHeight();
+
+	const BoardLayout layout = BoardLayout::FromClientSize((FLOAT)sceneWidth, (FLOAT)sceneHeight);
+
+	int hoveredButton = NO_BUTTON;
+
+	if (snapshot.bAwaitingInput)
 	{
-		{
-			D2D1_ELLIPSE ellipse
-			{
-				.point =
-				{
-					.x = boardArea.left + boardWidth / 2,
-					.y = boardArea.top + boardWidth / 2
-				},
-				.radiusX = boardWidth / 2,
-				.radiusY = boardWidth / 2
-			};
-
-			renderTarget->DrawEllipse(&ellipse, LightGrayBrush.Get());
-		}
+		POINT cursorPos;
+		FATAL_ON_FALSE(GetCursorPos(&cursorPos));
+		FATAL_ON_FALSE(ScreenToClient(Window, &cursorPos));
+		const Point2 cursor = ClientToScene(cursorPos.x, cursorPos.y);
 
-		{
-			D2D1_ELLIPSE ellipse
-			{
-				.point =
-				{
-					.x = boardArea.left + boardWidth / 2,
-					.y = boardArea.top + boardWidth / 2
-				},
-				.radiusX = innerCircleRadius,
-				.radiusY = innerCircleRadius
-			};
-
-			renderTarget->DrawEllipse(&ellipse, LightGrayBrush.Get());
-		}
+		PROFILE_SCOPE(ProfilePhase::HitTest);
+		hoveredButton = HitTestButton(layout, cursor.x, cursor.y);
 	}
 
-	mouseClicked = false;
+	(void)retainedScene.Draw(backend, GameSceneState(sceneWidth, sceneHeight, snapshot, snapshot.DisplayedLitButton(hoveredButton)));
+}
+
+//F3 toggles per-phase timings over the bottom left corner
+bool bProfileOverlay = false;
 
-	FATAL_ON_FAIL(renderTarget->EndDraw());
+void WriteProfileOnExit() noexcept
+{
+#if SIMON_PROFILING
+	(void)WriteProfileReport("SimonProfile.csv");
+#endif
 }
 
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine, int nCmdShow)
+//the logic thread has to be gone before the recording, stats, history and state export it writes are closed,
+//stopping it ends the game in progress so that game and any best score it set are journaled too
+void ShutDownGame() noexcept
 {
-	LARGE_INTEGER ProcessorFrequency;
-	FATAL_ON_FALSE(QueryPerformanceFrequency(&ProcessorFrequency));
+	logic->Stop();
+	(void)recorder.Close();
+	statsStore.Sync();
+	statsStore.Close();
+	(void)history.Close();
+	stateExport.Close();
+	WriteProfileOnExit();
+}
 
-	ButtonLitTicks.QuadPart = ProcessorFrequency.QuadPart * .4;
-	AllButtonsOffTicks.QuadPart = ProcessorFrequency.QuadPart * .1;
-	GameStateChangedTicks.QuadPart = ProcessorFrequency.QuadPart * .5;
+void ExitGame() noexcept
+{
+	ShutDownGame();
+	ExitProcess(EXIT_SUCCESS);
+}
 
-	{
-		LARGE_INTEGER tickCountNow;
-		FATAL_ON_FALSE(QueryPerformanceCounter(&tickCountNow));
-		srand(tickCountNow.LowPart);
+void QueueInput(InputEventType type, LPARAM lParam) noexcept
+{
+	const Point2 position = ClientToScene(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
 
-		CurrentTimerFinished.QuadPart = tickCountNow.QuadPart + ButtonLitTicks.QuadPart;
-	}
+	(void)logic->QueueInput(
+		{
+			.type = type,
+			.x = position.x,
+			.y = position.y,
+			.timestamp = gameClock.Now()
+		});
+}
 
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine, int nCmdShow)
+{
 	SetThreadDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
 
 	UINT dpi = GetDpiForSystem();
@@ -735,29 +567,61 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine,
 
 	FATAL_ON_FALSE(ShowWindow(Window, nCmdShow));
 
+	{
+		//snapshots are posted to the window, so the game starts once there is one
+		const int64_t tickCountNow = gameClock.Now();
+		GameCore game(GameTimings::FromFrequency(gameClock.Frequency()), tickCountNow, (uint64_t)tickCountNow);
+
+		//neither stats, history, the state export nor a recording that cannot be written are a reason not to play
+		const bool bStats = statsStore.Open(STATS_PATH);
+		game.bestScore = statsStore.Summary().bestScore;
+
+		const bool bRecording = recorder.Open(RECORDING_PATH, game, gameClock.Frequency(), tickCountNow);
+		const bool bHistory = history.Open(HISTORY_PATH, gameClock.Frequency());
+		const bool bStateExport = stateExport.Open(DEFAULT_STATE_EXPORT_NAME, gameClock.Frequency());
+
+		logic.emplace(
+			gameClock,
+			game,
+			[](void*) { FATAL_ON_FALSE(PostMessageW(Window, WM_SNAPSHOT_PUBLISHED, 0, 0)); },
+			nullptr,
+			bRecording ? &recorder : nullptr,
+			bStats ? &statsStore : nullptr,
+			bHistory ? &history : nullptr,
+			bStateExport ? &stateExport : nullptr);
+	}
 
 	SetWindowLongPtrA(Window, GWLP_WNDPROC, (LONG_PTR)&WindowProc);
 
 	SetCursor(LoadCursorW(NULL, IDC_ARROW));
 
+	Win32EventLoop eventLoop;
+
 	MSG Message = { 0 };
 
-	while (Message.message != WM_QUIT)
+	while (true)
 	{
-		if (PeekMessageW(&Message, nullptr, 0, 0, PM_REMOVE))
+		while (PeekMessageW(&Message, nullptr, 0, 0, PM_REMOVE))
 		{
+			if (Message.message == WM_QUIT)
+			{
+				ShutDownGame();
+				return EXIT_SUCCESS;
+			}
+
 			FATAL_ON_FALSE(TranslateMessage(&Message));
 			DispatchMessageW(&Message);
 		}
-	}
 
-	return EXIT_SUCCESS;
+		//game deadlines are the logic thread's, this one only waits for messages
+		(void)eventLoop.WaitUntil(NO_DEADLINE);
+	}
 }
 
-void handleDpiChange() noexcept
+//the window keeps its physical size of 6 inches on the monitor it moved to
+void handleDpiChange(UINT dpi) noexcept
 {
 	SetThreadDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
-	UINT dpi = GetDpiForSystem();
 
 	windowWidth = 6 * dpi;
 	windowHeight = 6 * dpi;
@@ -787,7 +651,7 @@ LRESULT CALLBACK PreInitProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lPar
 	switch (message)
 	{
 	case WM_DPICHANGED:
-		handleDpiChange();
+		handleDpiChange(LOWORD(wParam));
 		break;
 	case WM_DESTROY:
 		PostQuitMessage(0);
@@ -804,10 +668,10 @@ LRESULT CALLBACK IdleProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 	{
 
 	case WM_DPICHANGED:
-		handleDpiChange();
+		handleDpiChange(LOWORD(wParam));
 		break;
 	case WM_PAINT:
-		Sleep(25);
+		FATAL_ON_FALSE(ValidateRect(hwnd, nullptr));
 		break;
 	case WM_SIZE:
 		if (!IsIconic(hwnd))
@@ -829,20 +693,32 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 	case WM_DESTROY:
 		PostQuitMessage(0);
 		return 0;
+	//whatever the input changes comes back as a snapshot, which asks for the repaint
 	case WM_LBUTTONUP:
 	case WM_LBUTTONDBLCLK:
-		mouseClicked = true;
+		QueueInput(InputEventType::Click, lParam);
+		break;
+	case WM_SNAPSHOT_PUBLISHED:
+		RequestRepaint(hwnd);
+		break;
+	case WM_MOUSEMOVE:
+		//hover highlights only exist on the menu and while waiting for input
+		if (logic->LatestSnapshot().gameState != GAME_STATE_PLAYBACK)
+			RequestRepaint(hwnd);
 		break;
 	case WM_KEYDOWN:
 		if (wParam == VK_ESCAPE) {
-			gameState = 0;
-			playbackLength = 1;
-			playbackLocation = 0;
-			mouseClicked = false;
+			QueueInput(InputEventType::Escape, 0);
+		}
+		else if (wParam == VK_F3) {
+			//the overlay paints over the scene, so hiding it needs a full frame
+			bProfileOverlay = !bProfileOverlay;
+			retainedScene.Invalidate();
+			RequestRepaint(hwnd);
 		}
 		break;
 	case WM_DPICHANGED:
-		handleDpiChange();
+		handleDpiChange(LOWORD(wParam));
 		[[fallthrough]];
 	case WM_SIZE:
 		if (IsIconic(hwnd))
@@ -850,14 +726,43 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 			FATAL_ON_FALSE(SetWindowLongPtrA(hwnd, GWLP_WNDPROC, (LONG_PTR)&IdleProc) != 0);
 			break;
 		}
-		CreateAssets();
+		UpdateAssets();
+		retainedScene.Invalidate();
 		[[fallthrough]];
 	case WM_PAINT:
-		if (gameState == 0)
+	{
+		PROFILE_SCOPE(ProfilePhase::Frame);
+
+		if (!bRepaintRequested)
+			retainedScene.Invalidate();
+		bRepaintRequested = false;
+
+		//the newest state the logic thread published, frames never wait for it to judge anything
+		const GameSnapshot& snapshot = logic->LatestSnapshot();
+
+		if (snapshot.bExitRequested)
+			ExitGame();
+
+		if (snapshot.gameState == GAME_STATE_MENU)
 			DrawMenu();
 		else
-			DrawGame();
+			DrawGame(snapshot);
+
+		if (bProfileOverlay)
+			DrawProfileOverlay(backend, (FLOAT)deviceResources.SceneWidth(), (FLOAT)deviceResources.SceneHeight());
+
+		FATAL_ON_FALSE(ValidateRect(hwnd, nullptr));
+
+		//text formats and geometry are device independent and stay, the rest comes back next frame
+		if (bDeviceLost)
+		{
+			bDeviceLost = false;
+			deviceResources.DeviceLost(resourceFactory);
+			retainedScene.Invalidate();
+			RequestRepaint(hwnd);
+		}
 		break;
+	}
 	default:
 		return DefWindowProcW(hwnd, uMsg, wParam, lParam);
 	}
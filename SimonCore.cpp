@@ -0,0 +1,230 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "SimonCore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+void FATAL_ON_ERRNO_IMPL(const char* expression, int line) noexcept
+{
+	const int error = errno;
+	fprintf(stderr, "an error occured: %s\nerror code: %i\nexpression: %s\nlocation: line %i\n", strerror(error), error, expression, line);
+	exit(EXIT_FAILURE);
+}
+
+int64_t SteadyClock::Now() noexcept
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t SteadyClock::Frequency() noexcept
+{
+	return 1'000'000'000;
+}
+
+GameCore::GameCore(const GameTimings& timings, int64_t now, uint64_t seed) noexcept :
+	timings(timings),
+	CurrentTimerFinished(now + timings.ButtonLitTicks),
+	seed(seed),
+	sequence(CounterRng::ForStream(seed, 0))
+{
+}
+
+void GameCore::NextSequence() noexcept
+{
+	gameNumber++;
+	sequence = CounterRng::ForStream(seed, gameNumber);
+}
+
+void GameCore::FinishGame(int64_t now, int failureStep) noexcept
+{
+	lastFinished =
+	{
+		.seed = seed,
+		.gameNumber = gameNumber,
+		.playbackLength = playbackLength,
+		.startTime = gameStartTime,
+		.endTime = now,
+		.failureStep = failureStep
+	};
+	finishedGames++;
+}
+
+void GameCore::StartGame(int64_t now) noexcept
+{
+	gameStartTime = now;
+	gameState = GAME_STATE_PLAYBACK;
+	bOutstandingTimer = true;
+	CurrentTimerFinished = now + timings.GameStateChangedTicks;
+}
+
+void GameCore::ReturnToMenu(int64_t now) noexcept
+{
+	if (gameState != GAME_STATE_MENU)
+		FinishGame(now);
+
+	gameState = GAME_STATE_MENU;
+	playbackLength = 1;
+	playbackLocation = 0;
+	currentLitButton = NO_BUTTON;
+	NextSequence();
+}
+
+int64_t GameCore::NextDeadline() const noexcept
+{
+	if (gameState == GAME_STATE_MENU)
+		return NO_DEADLINE;
+
+	//timers expire once the clock is strictly past CurrentTimerFinished
+	if (bOutstandingTimer || gameState == GAME_STATE_PLAYBACK)
+		return CurrentTimerFinished + 1;
+
+	return NO_DEADLINE;
+}
+
+int GameCore::DisplayedLitButton(int hoveredButton) const noexcept
+{
+	if (bOutstandingTimer)
+		return NO_BUTTON;
+
+	switch (gameState)
+	{
+	case GAME_STATE_PLAYBACK:
+		return currentLitButton;
+	case GAME_STATE_INPUT:
+		return hoveredButton;
+	default:
+		return NO_BUTTON;
+	}
+}
+
+void GameCore::Tick(int64_t now, const GameInput& input) noexcept
+{
+	if (gameState == GAME_STATE_MENU)
+	{
+		if (input.clicked)
+		{
+			if (input.hoveredMenuItem == MenuItem::Play)
+				StartGame(now);
+			else if (input.hoveredMenuItem == MenuItem::Exit)
+				bExitRequested = true;
+		}
+		return;
+	}
+
+	if (bOutstandingTimer)
+	{
+		if (CurrentTimerFinished < now)
+		{
+			bOutstandingTimer = false;
+		}
+		return;
+	}
+
+	switch (gameState)
+	{
+	case GAME_STATE_PLAYBACK:
+	{
+		if (CurrentTimerFinished < now)
+		{
+			if (currentLitButton == NO_BUTTON)
+			{
+				currentLitButton = ButtonAt(playbackLocation);
+
+				CurrentTimerFinished = now + timings.ButtonLitTicks;
+
+				playbackLocation++;
+			}
+			else
+			{
+				currentLitButton = NO_BUTTON;
+
+				if (playbackLocation == playbackLength)
+				{
+					gameState = GAME_STATE_INPUT;
+					playbackLocation = 0;
+					inputReadyTime = now;
+				}
+
+				CurrentTimerFinished = now + timings.AllButtonsOffTicks;
+			}
+		}
+		break;
+	}
+	case GAME_STATE_INPUT:
+	{
+		if (!input.clicked || input.hoveredButton == NO_BUTTON)
+			break;
+
+		presses++;
+		lastReactionTicks = now - inputReadyTime;
+		inputReadyTime = now;
+
+		if (input.hoveredButton == ButtonAt(playbackLocation))
+		{
+			playbackLocation++;
+			if (playbackLocation == playbackLength)
+			{
+				CurrentTimerFinished = now + timings.ButtonLitTicks;
+
+				playbackLocation = 0;
+				bestScore = std::max(bestScore, playbackLength);
+				playbackLength++;
+				gameState = GAME_STATE_PLAYBACK;
+			}
+		}
+		else
+		{
+			//a miss ends this game and starts the next one straight away
+			FinishGame(now, playbackLocation);
+			gameStartTime = now;
+
+			playbackLength = 1;
+			playbackLocation = 0;
+			gameState = GAME_STATE_PLAYBACK;
+			NextSequence();
+
+			bOutstandingTimer = true;
+			CurrentTimerFinished = now + timings.GameStateChangedTicks;
+		}
+		break;
+	}
+	}
+}
+
+GameSnapshot GameCore::Snapshot() const noexcept
+{
+	return
+	{
+		.sequence = 0,
+		.gameState = gameState,
+		.litButton = DisplayedLitButton(NO_BUTTON),
+		.bAwaitingInput = gameState == GAME_STATE_INPUT && !bOutstandingTimer,
+		.bExitRequested = bExitRequested,
+		.playbackLength = playbackLength,
+		.score = Score(),
+		.bestScore = bestScore
+	};
+}
+
+MenuItem MenuHitTest(float x, float y, float width, float height) noexcept
+{
+	if (x <= width * .4f || x >= width * .6f)
+		return MenuItem::None;
+
+	if (y > height * .3f && y < height * .4f)
+		return MenuItem::Play;
+
+	if (y > height * .45f && y < height * .55f)
+		return MenuItem::Exit;
+
+	return MenuItem::None;
+}
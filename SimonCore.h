@@ -0,0 +1,207 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "CounterRng.h"
+
+//platform independent game logic, driven by tick(now, input)
+//all times are in clock ticks, see GameClock::Frequency()
+
+constexpr int BUTTON_COUNT = 4;
+constexpr int NO_BUTTON = BUTTON_COUNT;
+constexpr int64_t NO_DEADLINE = (std::numeric_limits<int64_t>::max)();
+
+//keeps data written by different threads on separate lines
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+//reports the failed expression and errno, then exits like FATAL_ON_FAIL does on windows
+[[noreturn]]
+void FATAL_ON_ERRNO_IMPL(const char* expression, int line) noexcept;
+
+#define FATAL_ON_NEGATIVE(x) if((x) < 0) FATAL_ON_ERRNO_IMPL(#x, __LINE__)
+#define FATAL_ON_NULL(x) if((x) == nullptr) FATAL_ON_ERRNO_IMPL(#x, __LINE__)
+
+enum GameState : int
+{
+	GAME_STATE_MENU = 0,
+	GAME_STATE_PLAYBACK = 1,
+	GAME_STATE_INPUT = 2
+};
+
+enum class MenuItem : int
+{
+	None,
+	Play,
+	Exit
+};
+
+struct GameClock
+{
+	virtual ~GameClock() = default;
+
+	[[nodiscard]]
+	virtual int64_t Now() noexcept = 0;
+
+	[[nodiscard]]
+	virtual int64_t Frequency() noexcept = 0;
+};
+
+//std::chrono::steady_clock in nanoseconds
+struct SteadyClock final : GameClock
+{
+	[[nodiscard]]
+	int64_t Now() noexcept override;
+
+	[[nodiscard]]
+	int64_t Frequency() noexcept override;
+};
+
+//only moves when told to, for headless runs
+struct ManualClock final : GameClock
+{
+	int64_t ticks = 0;
+	int64_t frequency = 1'000'000;
+
+	[[nodiscard]]
+	int64_t Now() noexcept override { return ticks; }
+
+	[[nodiscard]]
+	int64_t Frequency() noexcept override { return frequency; }
+
+	void Advance(int64_t delta) noexcept { ticks += delta; }
+};
+
+struct GameTimings
+{
+	int64_t ButtonLitTicks;
+	int64_t AllButtonsOffTicks;
+	int64_t GameStateChangedTicks;
+
+	[[nodiscard]]
+	static constexpr GameTimings FromFrequency(int64_t frequency) noexcept
+	{
+		return
+		{
+			.ButtonLitTicks = (int64_t)(frequency * .4),
+			.AllButtonsOffTicks = (int64_t)(frequency * .1),
+			.GameStateChangedTicks = (int64_t)(frequency * .5)
+		};
+	}
+};
+
+struct GameInput
+{
+	int hoveredButton = NO_BUTTON;
+	MenuItem hoveredMenuItem = MenuItem::None;
+	bool clicked = false;
+};
+
+//what a front end needs to draw the game, copied out of a GameCore so another thread can read it
+struct GameSnapshot
+{
+	//bumped by whoever publishes the snapshot, 0 straight out of GameCore::Snapshot()
+	uint64_t sequence;
+	int gameState;
+	//lit by playback, hover highlights are up to the front end
+	int litButton;
+	bool bAwaitingInput;
+	bool bExitRequested;
+	int playbackLength;
+	int score;
+	int bestScore;
+
+	bool operator==(const GameSnapshot&) const = default;
+
+	//same as GameCore::DisplayedLitButton
+	[[nodiscard]]
+	int DisplayedLitButton(int hoveredButton) const noexcept { return bAwaitingInput ? hoveredButton : litButton; }
+};
+
+//how one game ended, by a miss or by leaving for the menu
+struct FinishedGame
+{
+	uint64_t seed;
+	uint64_t gameNumber;
+	//playbackLength when the game ended, one more than the rounds it completed
+	int playbackLength;
+	int64_t startTime;
+	int64_t endTime;
+	//step of the last round that was pressed wrong, NO_FAILURE if the game was left for the menu
+	int failureStep;
+};
+
+constexpr int NO_FAILURE = -1;
+
+struct GameCore
+{
+	GameTimings timings;
+
+	int gameState = GAME_STATE_MENU;
+	int currentLitButton = NO_BUTTON;
+	int playbackLength = 1;
+	int playbackLocation = 0;
+	int bestScore = 0;
+	bool bOutstandingTimer = false;
+	bool bExitRequested = false;
+	int64_t CurrentTimerFinished = 0;
+
+	//every game draws its sequence from its own stream, step 0 is always button 1
+	uint64_t seed;
+	uint64_t gameNumber = 0;
+	CounterRng sequence;
+
+	//when the game in progress started, and the last one that ended, finishedGames counts them
+	int64_t gameStartTime = 0;
+	uint64_t finishedGames = 0;
+	FinishedGame lastFinished = {};
+
+	//presses judged so far over all games, right or wrong, and how long the last one took from the moment
+	//input was possible, inputReadyTime is when the press the game waits for became possible
+	uint64_t presses = 0;
+	int64_t lastReactionTicks = 0;
+	int64_t inputReadyTime = 0;
+
+	GameCore(const GameTimings& timings, int64_t now, uint64_t seed) noexcept;
+
+	void Tick(int64_t now, const GameInput& input) noexcept;
+
+	void StartGame(int64_t now) noexcept;
+
+	void ReturnToMenu(int64_t now) noexcept;
+
+	//switches to the stream of the next game
+	void NextSequence() noexcept;
+
+	//records the game in progress as lastFinished
+	void FinishGame(int64_t now, int failureStep = NO_FAILURE) noexcept;
+
+	//earliest time at which Tick() would change state without any input, or NO_DEADLINE
+	[[nodiscard]]
+	int64_t NextDeadline() const noexcept;
+
+	//the button that should be drawn lit this frame, or NO_BUTTON
+	[[nodiscard]]
+	int DisplayedLitButton(int hoveredButton) const noexcept;
+
+	//button at position step of the current game, nothing is stored so any step is O(1)
+	[[nodiscard]]
+	int ButtonAt(int step) const noexcept { return step == 0 ? 1 : sequence.Button(step); }
+
+	[[nodiscard]]
+	int Score() const noexcept { return playbackLength - 1; }
+
+	[[nodiscard]]
+	GameSnapshot Snapshot() const noexcept;
+};
+
+//menu layout is relative to the client area, shared by the renderer and the core
+[[nodiscard]]
+MenuItem MenuHitTest(float x, float y, float width, float height) noexcept;
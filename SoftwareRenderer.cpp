@@ -0,0 +1,478 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "SoftwareRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	[[nodiscard]]
+	uint32_t PackColor(Paint paint) noexcept
+	{
+		const Color& color = PALETTE[(size_t)paint];
+		return
+			(uint32_t)(color.r * 255.f + .5f) |
+			(uint32_t)(color.g * 255.f + .5f) << 8 |
+			(uint32_t)(color.b * 255.f + .5f) << 16 |
+			0xFF000000u;
+	}
+
+	void FillPixels(uint32_t* destination, uint32_t color, size_t count) noexcept
+	{
+		size_t i = 0;
+
+#if defined(__AVX2__)
+		const __m256i color8 = _mm256_set1_epi32((int)color);
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_si256((__m256i*)(destination + i), color8);
+#elif defined(__SSE2__) || defined(_M_X64)
+		const __m128i color4 = _mm_set1_epi32((int)color);
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_si128((__m128i*)(destination + i), color4);
+#endif
+
+		for (; i < count; i++)
+			destination[i] = color;
+	}
+
+	//first pixel whose center is at or past x
+	[[nodiscard]]
+	inline int32_t PixelAtOrAfter(float x) noexcept
+	{
+		return (int32_t)ceilf(x - .5f);
+	}
+
+	void AddSpan(std::vector<Span>& spans, int32_t y, float left, float right, uint32_t width) noexcept
+	{
+		const int32_t x0 = std::max(PixelAtOrAfter(left), 0);
+		const int32_t x1 = std::min(PixelAtOrAfter(right), (int32_t)width);
+
+		if (x0 < x1)
+			spans.push_back({ .y = y, .x0 = x0, .x1 = x1 });
+	}
+
+	//5x7 glyphs, one byte per row with the leftmost pixel in bit 4
+	constexpr int GLYPH_WIDTH = 5;
+	constexpr int GLYPH_HEIGHT = 7;
+
+	constexpr uint8_t LETTER_GLYPHS[26][GLYPH_HEIGHT] =
+	{
+		{ 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },
+		{ 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E },
+		{ 0x1E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1E },
+		{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F },
+		{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },
+		{ 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F },
+		{ 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },
+		{ 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },
+		{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },
+		{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },
+		{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },
+		{ 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 },
+		{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },
+		{ 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },
+		{ 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D },
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },
+		{ 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E },
+		{ 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },
+		{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A },
+		{ 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },
+		{ 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04 },
+		{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }
+	};
+
+	constexpr uint8_t DIGIT_GLYPHS[10][GLYPH_HEIGHT] =
+	{
+		{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },
+		{ 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },
+		{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },
+		{ 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },
+		{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },
+		{ 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },
+		{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },
+		{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },
+		{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },
+		{ 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C }
+	};
+
+	constexpr uint8_t PERIOD_GLYPH[GLYPH_HEIGHT] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C };
+	constexpr uint8_t UNDERSCORE_GLYPH[GLYPH_HEIGHT] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F };
+
+	//lowercase is drawn as uppercase, anything without a glyph is a blank
+	[[nodiscard]]
+	const uint8_t* FindGlyph(wchar_t character) noexcept
+	{
+		if (character >= L'a' && character <= L'z')
+			character -= L'a' - L'A';
+
+		if (character >= L'A' && character <= L'Z')
+			return LETTER_GLYPHS[character - L'A'];
+		if (character >= L'0' && character <= L'9')
+			return DIGIT_GLYPHS[character - L'0'];
+		if (character == L'.')
+			return PERIOD_GLYPH;
+		if (character == L'_')
+			return UNDERSCORE_GLYPH;
+		if (character == L'\u24B8')
+			return LETTER_GLYPHS[L'C' - L'A'];
+
+		return nullptr;
+	}
+
+	void WriteBigEndian(std::vector<uint8_t>& out, uint32_t value) noexcept
+	{
+		out.push_back((uint8_t)(value >> 24));
+		out.push_back((uint8_t)(value >> 16));
+		out.push_back((uint8_t)(value >> 8));
+		out.push_back((uint8_t)value);
+	}
+
+	[[nodiscard]]
+	uint32_t Crc32(const uint8_t* data, size_t length) noexcept
+	{
+		static const auto table = []
+			{
+				std::array<uint32_t, 256> table;
+				for (uint32_t i = 0; i < 256; i++)
+				{
+					uint32_t crc = i;
+					for (int bit = 0; bit < 8; bit++)
+						crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+					table[i] = crc;
+				}
+				return table;
+			}();
+
+		uint32_t crc = 0xFFFFFFFFu;
+		for (size_t i = 0; i < length; i++)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return crc ^ 0xFFFFFFFFu;
+	}
+
+	void WritePngChunk(std::vector<uint8_t>& out, const char type[4], const std::vector<uint8_t>& data) noexcept
+	{
+		WriteBigEndian(out, (uint32_t)data.size());
+		const size_t typeOffset = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		WriteBigEndian(out, Crc32(out.data() + typeOffset, out.size() - typeOffset));
+	}
+
+	[[nodiscard]]
+	bool WriteFile(const char* path, const void* data, size_t size) noexcept
+	{
+		FILE* file = fopen(path, "wb");
+		if (file == nullptr)
+			return false;
+
+		const bool bWritten = fwrite(data, 1, size, file) == size;
+		return fclose(file) == 0 && bWritten;
+	}
+}
+
+std::vector<Span> RasterizePolygon(const std::vector<Point2>& polygon, uint32_t width, uint32_t height)
+{
+	std::vector<Span> spans;
+
+	if (polygon.size() < 3)
+		return spans;
+
+	float top = polygon[0].y;
+	float bottom = polygon[0].y;
+	for (const Point2& point : polygon)
+	{
+		top = std::min(top, point.y);
+		bottom = std::max(bottom, point.y);
+	}
+
+	const int32_t firstRow = std::max(PixelAtOrAfter(top), 0);
+	const int32_t lastRow = std::min(PixelAtOrAfter(bottom), (int32_t)height);
+
+	struct Crossing
+	{
+		float x;
+		int winding;
+	};
+	std::vector<Crossing> crossings;
+
+	for (int32_t y = firstRow; y < lastRow; y++)
+	{
+		const float sampleY = y + .5f;
+		crossings.clear();
+
+		for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+		{
+			const Point2& a = polygon[j];
+			const Point2& b = polygon[i];
+
+			if ((a.y <= sampleY) == (b.y <= sampleY))
+				continue;
+
+			crossings.push_back(
+				{
+					.x = a.x + (sampleY - a.y) * (b.x - a.x) / (b.y - a.y),
+					.winding = b.y > a.y ? 1 : -1
+				});
+		}
+
+		std::sort(crossings.begin(), crossings.end(), [](const Crossing& left, const Crossing& right) { return left.x < right.x; });
+
+		int winding = 0;
+		float spanStart = 0;
+		for (const Crossing& crossing : crossings)
+		{
+			const int previous = winding;
+			winding += crossing.winding;
+
+			if (previous == 0 && winding != 0)
+				spanStart = crossing.x;
+			else if (previous != 0 && winding == 0)
+				AddSpan(spans, y, spanStart, crossing.x, width);
+		}
+	}
+
+	return spans;
+}
+
+std::vector<Span> RasterizeCircleOutline(Point2 center, float radius, uint32_t width, uint32_t height)
+{
+	std::vector<Span> spans;
+
+	const float outerRadius = radius + .5f;
+	const float innerRadius = std::max(radius - .5f, 0.f);
+
+	const int32_t firstRow = std::max(PixelAtOrAfter(center.y - outerRadius), 0);
+	const int32_t lastRow = std::min(PixelAtOrAfter(center.y + outerRadius), (int32_t)height);
+
+	for (int32_t y = firstRow; y < lastRow; y++)
+	{
+		const float dy = y + .5f - center.y;
+		const float outerHalfWidth = sqrtf(std::max(outerRadius * outerRadius - dy * dy, 0.f));
+
+		if (fabsf(dy) < innerRadius)
+		{
+			const float innerHalfWidth = sqrtf(innerRadius * innerRadius - dy * dy);
+			AddSpan(spans, y, center.x - outerHalfWidth, center.x - innerHalfWidth, width);
+			AddSpan(spans, y, center.x + innerHalfWidth, center.x + outerHalfWidth, width);
+		}
+		else
+		{
+			AddSpan(spans, y, center.x - outerHalfWidth, center.x + outerHalfWidth, width);
+		}
+	}
+
+	return spans;
+}
+
+SoftwareRenderer::SoftwareRenderer(uint32_t width, uint32_t height) :
+	width(width),
+	height(height),
+	pixels((size_t)width * height),
+	clipRight((int32_t)width),
+	clipBottom((int32_t)height)
+{
+}
+
+void SoftwareRenderer::Clear() noexcept
+{
+	FillRect(clipLeft, clipTop, clipRight, clipBottom, 0xFF000000u);
+}
+
+void SoftwareRenderer::PushClip(const Rect& area) noexcept
+{
+	clipLeft = std::max((int32_t)area.left, 0);
+	clipTop = std::max((int32_t)area.top, 0);
+	clipRight = std::min((int32_t)area.right, (int32_t)width);
+	clipBottom = std::min((int32_t)area.bottom, (int32_t)height);
+}
+
+void SoftwareRenderer::PopClip() noexcept
+{
+	clipLeft = 0;
+	clipTop = 0;
+	clipRight = (int32_t)width;
+	clipBottom = (int32_t)height;
+}
+
+void SoftwareRenderer::FillSpans(const std::vector<Span>& spans, uint32_t color) noexcept
+{
+	//spans are sorted by row
+	auto first = std::lower_bound(spans.begin(), spans.end(), clipTop, [](const Span& span, int32_t y) { return span.y < y; });
+
+	for (auto span = first; span != spans.end() && span->y < clipBottom; ++span)
+	{
+		const int32_t x0 = std::max(span->x0, clipLeft);
+		const int32_t x1 = std::min(span->x1, clipRight);
+
+		if (x0 < x1)
+			FillPixels(pixels.data() + (size_t)span->y * width + x0, color, x1 - x0);
+	}
+}
+
+void SoftwareRenderer::FillRect(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color) noexcept
+{
+	x0 = std::max(x0, clipLeft);
+	y0 = std::max(y0, clipTop);
+	x1 = std::min(x1, clipRight);
+	y1 = std::min(y1, clipBottom);
+
+	if (x0 >= x1)
+		return;
+
+	for (int32_t y = y0; y < y1; y++)
+		FillPixels(pixels.data() + (size_t)y * width + x0, color, x1 - x0);
+}
+
+void SoftwareRenderer::FillButton(const BoardLayout& layout, int button, Paint paint) noexcept
+{
+	const std::array<std::vector<Span>, BUTTON_COUNT>& spans = buttonCache.GetOrBuild(layout, [&](std::array<std::vector<Span>, BUTTON_COUNT>& built)
+		{
+			for (int i = 0; i < BUTTON_COUNT; i++)
+				built[i] = RasterizePolygon(FlattenWedgeOutline(BuildWedgeOutline(layout, i), 16), width, height);
+		});
+
+	FillSpans(spans[button], PackColor(paint));
+}
+
+void SoftwareRenderer::DrawCircle(Point2 center, float radius, Paint paint) noexcept
+{
+	const std::vector<Span>& spans = circleCache.GetOrBuild({ .centerX = center.x, .centerY = center.y, .radius = radius }, [&](std::vector<Span>& built)
+		{
+			built = RasterizeCircleOutline(center, radius, width, height);
+		});
+
+	FillSpans(spans, PackColor(paint));
+}
+
+void SoftwareRenderer::DrawString(const wchar_t* text, uint32_t length, TextStyle style, const Rect& area, Paint paint) noexcept
+{
+	const float fontSize = TEXT_STYLE_SIZE[(size_t)style] * height;
+
+	//cap height is roughly 70% of the em size, with about 20% above it
+	const int32_t scale = std::max((int32_t)(fontSize * .7f / GLYPH_HEIGHT), 1);
+	const int32_t advance = (GLYPH_WIDTH + 1) * scale;
+	const int32_t textWidth = (int32_t)length * advance - scale;
+
+	const int32_t left = (int32_t)((area.left + area.right) / 2 - textWidth / 2.f);
+	const int32_t top = (int32_t)(area.top + fontSize * .2f);
+
+	const uint32_t color = PackColor(paint);
+
+	for (uint32_t i = 0; i < length; i++)
+	{
+		const uint8_t* glyph = FindGlyph(text[i]);
+		if (glyph == nullptr)
+			continue;
+
+		const int32_t glyphLeft = left + (int32_t)i * advance;
+
+		for (int row = 0; row < GLYPH_HEIGHT; row++)
+		{
+			const int32_t y = top + row * scale;
+
+			//one rectangle per run of set bits
+			for (int column = 0; column < GLYPH_WIDTH;)
+			{
+				if ((glyph[row] & (0x10 >> column)) == 0)
+				{
+					column++;
+					continue;
+				}
+
+				const int runStart = column;
+				while (column < GLYPH_WIDTH && (glyph[row] & (0x10 >> column)) != 0)
+					column++;
+
+				FillRect(glyphLeft + runStart * scale, y, glyphLeft + column * scale, y + scale, color);
+			}
+		}
+	}
+}
+
+bool SoftwareRenderer::WritePpm(const char* path) const noexcept
+{
+	char header[64];
+	const int headerLength = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", width, height);
+
+	std::vector<uint8_t> file(header, header + headerLength);
+	file.reserve(headerLength + pixels.size() * 3);
+
+	for (const uint32_t pixel : pixels)
+	{
+		file.push_back((uint8_t)pixel);
+		file.push_back((uint8_t)(pixel >> 8));
+		file.push_back((uint8_t)(pixel >> 16));
+	}
+
+	return WriteFile(path, file.data(), file.size());
+}
+
+bool SoftwareRenderer::WritePng(const char* path) const noexcept
+{
+	//stored (uncompressed) deflate blocks keep this free of any zlib dependency
+	const size_t rowSize = 1 + (size_t)width * 4;
+
+	std::vector<uint8_t> raw;
+	raw.reserve(rowSize * height);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		raw.push_back(0);
+		const uint8_t* row = (const uint8_t*)(pixels.data() + (size_t)y * width);
+		raw.insert(raw.end(), row, row + (size_t)width * 4);
+	}
+
+	std::vector<uint8_t> idat = { 0x78, 0x01 };
+	for (size_t offset = 0; offset < raw.size() || offset == 0; offset += 65535)
+	{
+		const uint16_t blockLength = (uint16_t)std::min<size_t>(raw.size() - offset, 65535);
+		const uint16_t invertedLength = (uint16_t)~blockLength;
+		const bool bFinal = offset + blockLength >= raw.size();
+
+		idat.push_back(bFinal ? 1 : 0);
+		idat.push_back((uint8_t)blockLength);
+		idat.push_back((uint8_t)(blockLength >> 8));
+		idat.push_back((uint8_t)invertedLength);
+		idat.push_back((uint8_t)(invertedLength >> 8));
+		idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + blockLength);
+
+		if (bFinal)
+			break;
+	}
+
+	uint32_t adlerA = 1;
+	uint32_t adlerB = 0;
+	for (const uint8_t byte : raw)
+	{
+		adlerA = (adlerA + byte) % 65521;
+		adlerB = (adlerB + adlerA) % 65521;
+	}
+	WriteBigEndian(idat, adlerB << 16 | adlerA);
+
+	std::vector<uint8_t> ihdr;
+	WriteBigEndian(ihdr, width);
+	WriteBigEndian(ihdr, height);
+	ihdr.insert(ihdr.end(), { 8, 6, 0, 0, 0 });
+
+	std::vector<uint8_t> file = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	WritePngChunk(file, "IHDR", ihdr);
+	WritePngChunk(file, "IDAT", idat);
+	WritePngChunk(file, "IEND", {});
+
+	return WriteFile(path, file.data(), file.size());
+}
@@ -0,0 +1,102 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "RenderBackend.h"
+
+//renders into an in-memory RGBA8 framebuffer, no GPU or display needed
+//shapes are turned into horizontal spans once per board size and cached,
+//so a frame is mostly span fills
+
+struct Span
+{
+	int32_t y;
+	int32_t x0;
+	int32_t x1;
+};
+
+class SoftwareRenderer final : public RenderBackend
+{
+public:
+	SoftwareRenderer(uint32_t width, uint32_t height);
+
+	void BeginDraw() noexcept override {}
+
+	void EndDraw() noexcept override {}
+
+	void Clear() noexcept override;
+
+	void PushClip(const Rect& area) noexcept override;
+
+	void PopClip() noexcept override;
+
+	void FillButton(const BoardLayout& layout, int button, Paint paint) noexcept override;
+
+	void DrawCircle(Point2 center, float radius, Paint paint) noexcept override;
+
+	void DrawString(const wchar_t* text, uint32_t length, TextStyle style, const Rect& area, Paint paint) noexcept override;
+
+	void DrawStaticText(StaticText text, TextStyle style, const Rect& area, Paint paint) noexcept override
+	{
+		DrawString(STATIC_TEXT_STRINGS[(size_t)text].text, STATIC_TEXT_STRINGS[(size_t)text].length, style, area, paint);
+	}
+
+	[[nodiscard]]
+	uint32_t Width() const noexcept { return width; }
+
+	[[nodiscard]]
+	uint32_t Height() const noexcept { return height; }
+
+	//R, G, B, A bytes per pixel, rows top to bottom
+	[[nodiscard]]
+	const uint32_t* Pixels() const noexcept { return pixels.data(); }
+
+	[[nodiscard]]
+	bool WritePpm(const char* path) const noexcept;
+
+	[[nodiscard]]
+	bool WritePng(const char* path) const noexcept;
+
+private:
+	struct CircleKey
+	{
+		float centerX;
+		float centerY;
+		float radius;
+
+		bool operator==(const CircleKey&) const = default;
+	};
+
+	void FillSpans(const std::vector<Span>& spans, uint32_t color) noexcept;
+
+	void FillRect(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color) noexcept;
+
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint32_t> pixels;
+
+	int32_t clipLeft = 0;
+	int32_t clipTop = 0;
+	int32_t clipRight;
+	int32_t clipBottom;
+
+	//spans of the last few layouts and circles, a window dragged through many sizes keeps only the latest
+	GeometryCache<std::array<std::vector<Span>, BUTTON_COUNT>, 8, BoardLayout> buttonCache;
+	GeometryCache<std::vector<Span>, 8, CircleKey> circleCache;
+};
+
+//scanline fill of a polygon with the nonzero rule, sampling pixel centers
+[[nodiscard]]
+std::vector<Span> RasterizePolygon(const std::vector<Point2>& polygon, uint32_t width, uint32_t height);
+
+//pixels whose centers are within half a pixel of the circle
+[[nodiscard]]
+std::vector<Span> RasterizeCircleOutline(Point2 center, float radius, uint32_t width, uint32_t height);
@@ -0,0 +1,299 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "StateExport.h"
+
+#include <cstddef>
+#include <cstring>
+#include <thread>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+namespace
+{
+	//tries Read() makes before it starts giving the writer its core back, a writer preempted in the middle
+	//of a publish would otherwise be spun on for a whole time slice
+	constexpr int SPINS_BEFORE_YIELD = 64;
+	//tries before Read() gives up, a writer stalled in a publish for longer than that is read on the caller's
+	//next try, one that died there is not read again until the next run opens the segment
+	constexpr int MAX_READ_ATTEMPTS = 4096;
+}
+
+ExportedState ExportState(const GameCore& game, int64_t now, int64_t frequency) noexcept
+{
+	return
+	{
+		.publishCount = 0,
+		.frequency = frequency,
+		.publishTime = now,
+		.timerDeadline = game.NextDeadline() == NO_DEADLINE ? NO_DEADLINE : game.CurrentTimerFinished,
+		.gameStartTime = game.gameStartTime,
+		.lastReactionTicks = game.lastReactionTicks,
+		.gameNumber = game.gameNumber,
+		.finishedGames = game.finishedGames,
+		.presses = game.presses,
+		.gameState = game.gameState,
+		.currentLitButton = game.currentLitButton,
+		.playbackLength = game.playbackLength,
+		.playbackLocation = game.playbackLocation,
+		.score = game.Score(),
+		.bestScore = game.bestScore,
+		.lastScore = game.finishedGames != 0 ? game.lastFinished.playbackLength - 1 : 0,
+		.bClosed = 0
+	};
+}
+
+StateExporter::~StateExporter()
+{
+	Close();
+}
+
+bool StateExporter::Open(const char* name, int64_t frequency) noexcept
+{
+	Close();
+
+	this->frequency = frequency;
+	published = {};
+
+#if defined(__linux__)
+	fileDescriptor = shm_open(name, O_RDWR | O_CREAT, 0644);
+	if (fileDescriptor < 0)
+		return false;
+
+	if (flock(fileDescriptor, LOCK_EX | LOCK_NB) != 0 || ftruncate(fileDescriptor, sizeof(StateExportSegment)) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* view = mmap(nullptr, sizeof(StateExportSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	if (view == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+	segment = (StateExportSegment*)view;
+#elif defined(_WIN32)
+	mappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, (DWORD)sizeof(StateExportSegment), name);
+	if (mappingHandle == nullptr)
+		return false;
+
+	segment = (StateExportSegment*)MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(StateExportSegment));
+	if (segment == nullptr)
+	{
+		Close();
+		return false;
+	}
+#else
+	(void)name;
+	return false;
+#endif
+
+	if (segment->version.load(std::memory_order_acquire) == STATE_EXPORT_VERSION
+		&& memcmp(segment->magic, STATE_EXPORT_MAGIC, sizeof(segment->magic)) == 0
+		&& segment->stateBytes == sizeof(ExportedState))
+	{
+		//left by an earlier run, which may have died in the middle of a publish, the sequence and the publish
+		//count carry on so a reader still mapped from back then never takes a new state for one it already has
+		const uint64_t sequence = segment->sequence.load(std::memory_order_relaxed);
+		if (sequence % 2 != 0)
+			segment->sequence.store(sequence + 1, std::memory_order_release);
+		published.publishCount = segment->words[offsetof(ExportedState, publishCount) / sizeof(uint64_t)].load(std::memory_order_relaxed);
+		return true;
+	}
+
+	//new, readers turn it away until the version is stored
+	segment->version.store(0, std::memory_order_relaxed);
+	memcpy(segment->magic, STATE_EXPORT_MAGIC, sizeof(segment->magic));
+	segment->stateBytes = sizeof(ExportedState);
+	segment->sequence.store(0, std::memory_order_relaxed);
+	for (std::atomic<uint64_t>& word : segment->words)
+		word.store(0, std::memory_order_relaxed);
+	segment->version.store(STATE_EXPORT_VERSION, std::memory_order_release);
+
+	return true;
+}
+
+void StateExporter::Close() noexcept
+{
+	if (segment != nullptr)
+	{
+		published.bClosed = 1;
+		Publish(published);
+	}
+
+#if defined(__linux__)
+	if (segment != nullptr)
+		munmap(segment, sizeof(StateExportSegment));
+	//closing drops the lock too
+	if (fileDescriptor >= 0)
+		close(fileDescriptor);
+	fileDescriptor = -1;
+#elif defined(_WIN32)
+	if (segment != nullptr)
+		UnmapViewOfFile(segment);
+	if (mappingHandle != nullptr)
+		CloseHandle(mappingHandle);
+	mappingHandle = nullptr;
+#endif
+
+	segment = nullptr;
+}
+
+void StateExporter::Publish(const GameCore& game, int64_t now) noexcept
+{
+	Publish(ExportState(game, now, frequency));
+}
+
+void StateExporter::Publish(const ExportedState& state) noexcept
+{
+	const uint64_t publishCount = published.publishCount + 1;
+	published = state;
+	published.publishCount = publishCount;
+
+	if (segment == nullptr)
+		return;
+
+	uint64_t words[EXPORTED_STATE_WORDS];
+	memcpy(words, &published, sizeof(words));
+
+	//the release fence keeps the odd sequence ahead of every word, the release store keeps every word
+	//ahead of the even one
+	const uint64_t begin = segment->sequence.load(std::memory_order_relaxed) + 1;
+	segment->sequence.store(begin, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for (size_t i = 0; i < EXPORTED_STATE_WORDS; i++)
+		segment->words[i].store(words[i], std::memory_order_relaxed);
+
+	segment->sequence.store(begin + 1, std::memory_order_release);
+}
+
+StateExportReader::~StateExportReader()
+{
+	Close();
+}
+
+bool StateExportReader::Open(const char* name) noexcept
+{
+	Close();
+
+#if defined(__linux__)
+	fileDescriptor = shm_open(name, O_RDONLY, 0);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) != 0 || (uint64_t)fileStatus.st_size < sizeof(StateExportSegment))
+	{
+		Close();
+		return false;
+	}
+
+	void* view = mmap(nullptr, sizeof(StateExportSegment), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	if (view == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+	segment = (const StateExportSegment*)view;
+#elif defined(_WIN32)
+	mappingHandle = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+	if (mappingHandle == nullptr)
+		return false;
+
+	segment = (const StateExportSegment*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, sizeof(StateExportSegment));
+	if (segment == nullptr)
+	{
+		Close();
+		return false;
+	}
+#else
+	(void)name;
+	return false;
+#endif
+
+	if (segment->version.load(std::memory_order_acquire) != STATE_EXPORT_VERSION
+		|| memcmp(segment->magic, STATE_EXPORT_MAGIC, sizeof(segment->magic)) != 0
+		|| segment->stateBytes != sizeof(ExportedState))
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void StateExportReader::Close() noexcept
+{
+#if defined(__linux__)
+	if (segment != nullptr)
+		munmap((void*)segment, sizeof(StateExportSegment));
+	if (fileDescriptor >= 0)
+		close(fileDescriptor);
+	fileDescriptor = -1;
+#elif defined(_WIN32)
+	if (segment != nullptr)
+		UnmapViewOfFile(segment);
+	if (mappingHandle != nullptr)
+		CloseHandle(mappingHandle);
+	mappingHandle = nullptr;
+#endif
+
+	segment = nullptr;
+}
+
+bool StateExportReader::TryRead(ExportedState& state) noexcept
+{
+	const uint64_t begin = segment->sequence.load(std::memory_order_acquire);
+	if (begin == 0)
+		return false;
+
+	if (begin % 2 != 0)
+	{
+		retries++;
+		return false;
+	}
+
+	uint64_t words[EXPORTED_STATE_WORDS];
+	for (size_t i = 0; i < EXPORTED_STATE_WORDS; i++)
+		words[i] = segment->words[i].load(std::memory_order_relaxed);
+
+	//keeps every word ahead of the second look at the sequence
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	if (segment->sequence.load(std::memory_order_relaxed) != begin)
+	{
+		retries++;
+		return false;
+	}
+
+	memcpy(&state, words, sizeof(words));
+	return true;
+}
+
+bool StateExportReader::Read(ExportedState& state) noexcept
+{
+	for (int attempt = 1; !TryRead(state); attempt++)
+	{
+		if (segment->sequence.load(std::memory_order_relaxed) == 0 || attempt == MAX_READ_ATTEMPTS)
+			return false;
+
+		if (attempt % SPINS_BEFORE_YIELD == 0)
+			std::this_thread::yield();
+	}
+
+	return true;
+}
@@ -0,0 +1,173 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "SimonCore.h"
+
+//the live game state in a named shared memory segment, for overlays and kiosk tools in other processes
+//one writer and any number of readers behind a seqlock: the writer makes the sequence odd, stores the state
+//and makes it even again, a reader copies the state out between two loads of the sequence and keeps the copy
+//only if both were the same even value, so readers never write to the segment, never wait on each other and
+//never hold up the writer, a read is a few loads with no syscall or lock
+//every field is stored as a relaxed atomic word, a reader racing the writer sees a torn copy it then throws
+//away instead of a data race
+
+static_assert(std::endian::native == std::endian::little, "the exported state is little endian");
+
+constexpr char STATE_EXPORT_MAGIC[8] = { 'S', 'I', 'M', 'O', 'N', 'S', 'H', 'M' };
+constexpr uint32_t STATE_EXPORT_VERSION = 1;
+
+//the segment the game publishes to, shm_open names on linux and a session local mapping on windows
+#if defined(_WIN32)
+constexpr char DEFAULT_STATE_EXPORT_NAME[] = "Local\\SimonState";
+#else
+constexpr char DEFAULT_STATE_EXPORT_NAME[] = "/SimonState";
+#endif
+
+struct ExportedState
+{
+	//bumped by every publish, and carried on by the next run, a reader that sees the same value twice has
+	//seen nothing new
+	uint64_t publishCount;
+	//all times are ticks of the game's clock at frequency ticks per second, SteadyClock is CLOCK_MONOTONIC
+	//and the windows game counts QueryPerformanceCounter, so another process can read the same clock
+	int64_t frequency;
+	int64_t publishTime;
+	//when the running timer fires, NO_DEADLINE if none is
+	int64_t timerDeadline;
+	int64_t gameStartTime;
+	int64_t lastReactionTicks;
+	uint64_t gameNumber;
+	uint64_t finishedGames;
+	uint64_t presses;
+	int32_t gameState;
+	int32_t currentLitButton;
+	int32_t playbackLength;
+	int32_t playbackLocation;
+	int32_t score;
+	int32_t bestScore;
+	//score of the last game that ended, 0 before the first
+	int32_t lastScore;
+	//nonzero once the writer closed, nothing more is published until the next run opens the segment
+	uint32_t bClosed;
+};
+
+static_assert(sizeof(ExportedState) % sizeof(uint64_t) == 0);
+
+constexpr size_t EXPORTED_STATE_WORDS = sizeof(ExportedState) / sizeof(uint64_t);
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free, "the segment is shared between processes");
+
+struct StateExportSegment
+{
+	char magic[8];
+	//stored last when the writer sets the segment up, a reader that sees the right version sees the rest
+	std::atomic<uint32_t> version;
+	uint32_t stateBytes;
+	uint8_t reserved[48];
+
+	//odd while a publish is under way, 0 until the first one
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> sequence;
+	std::atomic<uint64_t> words[EXPORTED_STATE_WORDS];
+};
+
+static_assert(sizeof(StateExportSegment) <= 4096, "the segment is one page");
+
+//fills everything but publishCount and bClosed from game
+[[nodiscard]]
+ExportedState ExportState(const GameCore& game, int64_t now, int64_t frequency) noexcept;
+
+class StateExporter
+{
+public:
+	StateExporter() noexcept = default;
+	~StateExporter();
+
+	StateExporter(const StateExporter&) = delete;
+	StateExporter& operator=(const StateExporter&) = delete;
+
+	//creates the segment or takes over the one an earlier run left, on linux it is locked for as long as
+	//it is open so a second game running at the same time fails here instead of interleaving publishes
+	//frequency is that of the clock the game passed to Publish() runs on
+	[[nodiscard]]
+	bool Open(const char* name, int64_t frequency) noexcept;
+
+	//publishes the last state once more with bClosed set, then unmaps, the segment itself is left for
+	//readers still looking at it and for the next run to carry on in, on windows only while a reader has it open
+	void Close() noexcept;
+
+	[[nodiscard]]
+	bool IsOpen() const noexcept { return segment != nullptr; }
+
+	//one writer thread only
+	void Publish(const GameCore& game, int64_t now) noexcept;
+
+	//state.publishCount is overwritten
+	void Publish(const ExportedState& state) noexcept;
+
+	[[nodiscard]]
+	uint64_t PublishCount() const noexcept { return published.publishCount; }
+
+private:
+	StateExportSegment* segment = nullptr;
+	int64_t frequency = 1;
+	ExportedState published = {};
+
+#if defined(__linux__)
+	int fileDescriptor = -1;
+#elif defined(_WIN32)
+	void* mappingHandle = nullptr;
+#endif
+};
+
+class StateExportReader
+{
+public:
+	StateExportReader() noexcept = default;
+	~StateExportReader();
+
+	StateExportReader(const StateExportReader&) = delete;
+	StateExportReader& operator=(const StateExportReader&) = delete;
+
+	//maps the segment read only, false if no game has set it up yet
+	[[nodiscard]]
+	bool Open(const char* name) noexcept;
+
+	void Close() noexcept;
+
+	[[nodiscard]]
+	bool IsOpen() const noexcept { return segment != nullptr; }
+
+	//one attempt, false if nothing was published yet or the writer was in the middle of a publish
+	[[nodiscard]]
+	bool TryRead(ExportedState& state) noexcept;
+
+	//tries until a copy is whole, a publish takes a few dozen nanoseconds so this hardly ever loops
+	//false if nothing was published yet, or if the sequence stayed odd through a bounded number of tries,
+	//as it does from a writer killed in the middle of a publish until the next run opens the segment
+	[[nodiscard]]
+	bool Read(ExportedState& state) noexcept;
+
+	//attempts TryRead() had to throw away
+	[[nodiscard]]
+	uint64_t Retries() const noexcept { return retries; }
+
+private:
+	const StateExportSegment* segment = nullptr;
+	uint64_t retries = 0;
+
+#if defined(__linux__)
+	int fileDescriptor = -1;
+#elif defined(_WIN32)
+	void* mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,297 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "StatsStore.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+namespace
+{
+	[[nodiscard]]
+	uint32_t EntryChecksum(const StatsEntry& entry, uint64_t index) noexcept
+	{
+		uint64_t hash = SplitMix64(index + 0x9E3779B97F4A7C15ull);
+		hash = SplitMix64(hash ^ entry.seed);
+		hash = SplitMix64(hash ^ entry.gameNumber);
+		hash = SplitMix64(hash ^ (uint64_t)entry.microseconds);
+		hash = SplitMix64(hash ^ (uint32_t)entry.playbackLength);
+		return (uint32_t)hash | 1;
+	}
+
+	[[nodiscard]]
+	uint32_t SummaryChecksum(const StatsSummary& summary) noexcept
+	{
+		uint64_t hash = SplitMix64(summary.games + 0x9E3779B97F4A7C15ull);
+		hash = SplitMix64(hash ^ summary.rounds);
+		hash = SplitMix64(hash ^ (uint64_t)summary.microseconds);
+		hash = SplitMix64(hash ^ (uint32_t)summary.bestScore);
+		return (uint32_t)hash | 1;
+	}
+
+	void Fold(StatsSummary& summary, const StatsEntry& entry) noexcept
+	{
+		const int rounds = std::max(entry.playbackLength - 1, 0);
+
+		summary.games++;
+		summary.rounds += (uint64_t)rounds;
+		summary.microseconds += entry.microseconds;
+		summary.bestScore = std::max(summary.bestScore, rounds);
+	}
+}
+
+StatsStore::~StatsStore()
+{
+	Close();
+}
+
+bool StatsStore::Open(const char* path) noexcept
+{
+	Close();
+
+#if defined(__linux__)
+	fileDescriptor = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) != 0)
+	{
+		Close();
+		return false;
+	}
+	fileBytes = (uint64_t)fileStatus.st_size;
+#elif defined(_WIN32)
+	fileHandle = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		fileHandle = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		Close();
+		return false;
+	}
+	fileBytes = (uint64_t)fileSize.QuadPart;
+#else
+	(void)path;
+	return false;
+#endif
+
+	const bool bNewFile = fileBytes == 0;
+
+	headerChunk = MapChunk(0);
+	if (headerChunk == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	StatsHeader& header = *(StatsHeader*)headerChunk;
+
+	if (bNewFile)
+	{
+		memcpy(header.magic, STATS_MAGIC, sizeof(header.magic));
+		header.version = STATS_VERSION;
+		header.entryBytes = sizeof(StatsEntry);
+	}
+	else if (memcmp(header.magic, STATS_MAGIC, sizeof(header.magic)) != 0 || header.version != STATS_VERSION || header.entryBytes != sizeof(StatsEntry))
+	{
+		Close();
+		return false;
+	}
+
+	//the newer intact copy, with neither the whole journal is folded again
+	summary = {};
+	for (uint64_t slot = 0; slot < 2; slot++)
+	{
+		const StatsSummary& copy = header.summaries[slot];
+		if (copy.checksum == SummaryChecksum(copy) && copy.games % 2 == slot && copy.games >= summary.games)
+			summary = copy;
+	}
+
+	//entries a crash left between the journal and the summary, none after a clean exit and one after a torn append
+	recoveredEntries = 0;
+	while (const StatsEntry* entry = EntryAt(summary.games, false))
+	{
+		if (entry->checksum != EntryChecksum(*entry, summary.games))
+			break;
+
+		Fold(summary, *entry);
+		recoveredEntries++;
+	}
+
+	if (bNewFile || recoveredEntries != 0)
+		WriteSummary();
+
+	return true;
+}
+
+void StatsStore::Close() noexcept
+{
+	if (tailChunk != nullptr)
+		UnmapChunk(tailChunk);
+	if (headerChunk != nullptr)
+		UnmapChunk(headerChunk);
+
+	tailChunk = nullptr;
+	headerChunk = nullptr;
+	tailChunkIndex = 0;
+	fileBytes = 0;
+
+#if defined(__linux__)
+	if (fileDescriptor >= 0)
+		close(fileDescriptor);
+	fileDescriptor = -1;
+#elif defined(_WIN32)
+	if (fileHandle != nullptr)
+		CloseHandle(fileHandle);
+	fileHandle = nullptr;
+#endif
+}
+
+void StatsStore::Append(const FinishedGame& result, int64_t frequency) noexcept
+{
+	//split so an hour long game on a nanosecond clock does not overflow
+	const int64_t ticks = result.endTime - result.startTime;
+
+	StatsEntry entry =
+	{
+		.seed = result.seed,
+		.gameNumber = result.gameNumber,
+		.microseconds = ticks / frequency * 1'000'000 + ticks % frequency * 1'000'000 / frequency,
+		.playbackLength = result.playbackLength,
+		.checksum = 0
+	};
+	entry.checksum = EntryChecksum(entry, summary.games);
+
+	if (IsOpen())
+	{
+		StatsEntry* slot = EntryAt(summary.games, true);
+		if (slot != nullptr)
+			*slot = entry;
+		else
+			Close();
+	}
+
+	Fold(summary, entry);
+
+	if (IsOpen())
+		WriteSummary();
+}
+
+void StatsStore::Sync() noexcept
+{
+	if (!IsOpen())
+		return;
+
+#if defined(__linux__)
+	(void)msync(headerChunk, FILE_CHUNK_BYTES, MS_SYNC);
+	if (tailChunk != nullptr)
+		(void)msync(tailChunk, FILE_CHUNK_BYTES, MS_SYNC);
+#elif defined(_WIN32)
+	(void)FlushViewOfFile(headerChunk, FILE_CHUNK_BYTES);
+	if (tailChunk != nullptr)
+		(void)FlushViewOfFile(tailChunk, FILE_CHUNK_BYTES);
+	(void)FlushFileBuffers(fileHandle);
+#endif
+}
+
+StatsEntry* StatsStore::EntryAt(uint64_t index, bool bGrow) noexcept
+{
+	const uint64_t offset = sizeof(StatsHeader) + index * sizeof(StatsEntry);
+	const uint64_t chunk = offset / FILE_CHUNK_BYTES;
+
+	if (!bGrow && offset + sizeof(StatsEntry) > fileBytes)
+		return nullptr;
+
+	uint8_t* view;
+	if (chunk == 0)
+		view = headerChunk;
+	else if (tailChunk != nullptr && chunk == tailChunkIndex)
+		view = tailChunk;
+	else
+	{
+		view = MapChunk(chunk);
+		if (view == nullptr)
+			return nullptr;
+
+		if (tailChunk != nullptr)
+			UnmapChunk(tailChunk);
+
+		tailChunk = view;
+		tailChunkIndex = chunk;
+	}
+
+	return (StatsEntry*)(view + offset % FILE_CHUNK_BYTES);
+}
+
+uint8_t* StatsStore::MapChunk(uint64_t chunk) noexcept
+{
+	//a partial trailing chunk is padded out with zeros, which no checksum matches
+	const uint64_t end = (chunk + 1) * FILE_CHUNK_BYTES;
+
+#if defined(__linux__)
+	if (fileBytes < end)
+	{
+		if (ftruncate(fileDescriptor, (off_t)end) != 0)
+			return nullptr;
+		fileBytes = end;
+	}
+
+	void* view = mmap(nullptr, FILE_CHUNK_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, (off_t)(chunk * FILE_CHUNK_BYTES));
+	return view == MAP_FAILED ? nullptr : (uint8_t*)view;
+#elif defined(_WIN32)
+	//a mapping larger than the file grows the file, the view keeps the mapping alive after the handle is closed
+	const uint64_t mappingBytes = std::max(end, fileBytes);
+	HANDLE mapping = CreateFileMappingW(fileHandle, nullptr, PAGE_READWRITE, (DWORD)(mappingBytes >> 32), (DWORD)mappingBytes, nullptr);
+	if (mapping == nullptr)
+		return nullptr;
+
+	const uint64_t offset = chunk * FILE_CHUNK_BYTES;
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, (DWORD)(offset >> 32), (DWORD)offset, FILE_CHUNK_BYTES);
+	CloseHandle(mapping);
+
+	if (view == nullptr)
+		return nullptr;
+
+	fileBytes = mappingBytes;
+	return (uint8_t*)view;
+#else
+	(void)end;
+	return nullptr;
+#endif
+}
+
+void StatsStore::UnmapChunk(uint8_t* view) noexcept
+{
+#if defined(__linux__)
+	munmap(view, FILE_CHUNK_BYTES);
+#elif defined(_WIN32)
+	UnmapViewOfFile(view);
+#else
+	(void)view;
+#endif
+}
+
+void StatsStore::WriteSummary() noexcept
+{
+	summary.checksum = SummaryChecksum(summary);
+	((StatsHeader*)headerChunk)->summaries[summary.games % 2] = summary;
+}
@@ -0,0 +1,130 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "SimonCore.h"
+
+//lifetime stats and the best score in a memory mapped file, with an append-only journal of every game
+//the file is a fixed header holding two copies of the summary, then one 32 byte entry per game
+//an append writes the entry, then the summary copy the previous append did not write, both covered by a
+//checksum, so a crash at any point leaves one copy intact and a torn entry reads as the end of the journal
+//opening maps the header and the chunk at the end of the journal only and folds the few entries past
+//the newer copy back in, so startup costs the same for ten games as for ten million
+//nothing is ever flushed on the way, Sync() is for shutdown, the page cache already survives a crash
+
+static_assert(std::endian::native == std::endian::little, "stats files are little endian");
+
+constexpr char STATS_MAGIC[8] = { 'S', 'I', 'M', 'O', 'N', 'S', 'T', 'A' };
+constexpr uint32_t STATS_VERSION = 1;
+
+struct StatsSummary
+{
+	//journal entries folded in
+	uint64_t games;
+	//rounds completed over all games
+	uint64_t rounds;
+	int64_t microseconds;
+	//same meaning as GameCore::bestScore
+	int32_t bestScore;
+	uint32_t checksum;
+};
+
+static_assert(sizeof(StatsSummary) == 32);
+
+struct StatsHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t entryBytes;
+	uint8_t reserved[48];
+	//the copy for a summary of n games is summaries[n % 2]
+	StatsSummary summaries[2];
+};
+
+static_assert(sizeof(StatsHeader) == 128);
+
+struct StatsEntry
+{
+	uint64_t seed;
+	uint64_t gameNumber;
+	int64_t microseconds;
+	int32_t playbackLength;
+	//covers the fields and the entry's own index, never 0, so zero filled space never reads as an entry
+	uint32_t checksum;
+};
+
+static_assert(sizeof(StatsEntry) == 32);
+
+class StatsStore
+{
+public:
+	//a multiple of the page size and of the windows allocation granularity
+	static constexpr size_t FILE_CHUNK_BYTES = 64 * 1024;
+
+	static_assert(FILE_CHUNK_BYTES % sizeof(StatsEntry) == 0 && sizeof(StatsHeader) % sizeof(StatsEntry) == 0, "entries must not straddle chunks");
+
+	//keeps the summary in memory only until Open()
+	StatsStore() noexcept = default;
+	~StatsStore();
+
+	StatsStore(const StatsStore&) = delete;
+	StatsStore& operator=(const StatsStore&) = delete;
+
+	//maps path, creating it if needed, and recovers whatever a crash left unsummarized
+	//false if the file cannot be mapped or is not a stats file, the store then stays in memory only
+	[[nodiscard]]
+	bool Open(const char* path) noexcept;
+
+	void Close() noexcept;
+
+	[[nodiscard]]
+	bool IsOpen() const noexcept { return headerChunk != nullptr; }
+
+	//journals one game and folds it into the summary, maps a new chunk every 2048 games and never flushes
+	//if the file cannot grow the store closes and goes on in memory
+	void Append(const FinishedGame& result, int64_t frequency) noexcept;
+
+	//writes dirty pages back, only needed against power loss, not against a crashing process
+	void Sync() noexcept;
+
+	[[nodiscard]]
+	const StatsSummary& Summary() const noexcept { return summary; }
+
+	//entries Open() found past the newer summary copy
+	[[nodiscard]]
+	uint64_t RecoveredEntries() const noexcept { return recoveredEntries; }
+
+private:
+	//nullptr if entry index is past the end of the file and bGrow is false, or the file cannot grow
+	[[nodiscard]]
+	StatsEntry* EntryAt(uint64_t index, bool bGrow) noexcept;
+
+	[[nodiscard]]
+	uint8_t* MapChunk(uint64_t chunk) noexcept;
+	void UnmapChunk(uint8_t* view) noexcept;
+
+	void WriteSummary() noexcept;
+
+	StatsSummary summary = {};
+	uint64_t recoveredEntries = 0;
+
+	//chunk 0 with the header stays mapped, the chunk the journal currently ends in is mapped next to it
+	uint8_t* headerChunk = nullptr;
+	uint8_t* tailChunk = nullptr;
+	uint64_t tailChunkIndex = 0;
+	uint64_t fileBytes = 0;
+
+#if defined(__linux__)
+	int fileDescriptor = -1;
+#elif defined(_WIN32)
+	void* fileHandle = nullptr;
+#endif
+};
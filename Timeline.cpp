@@ -0,0 +1,31 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "Timeline.h"
+
+TimelineTask& TimelineTask::operator=(TimelineTask&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (handle)
+			handle.destroy();
+		handle = std::exchange(other.handle, nullptr);
+	}
+	return *this;
+}
+
+TimelineTask::~TimelineTask()
+{
+	//destroying the frame runs the destructors of the awaiter it is suspended on
+	if (handle)
+		handle.destroy();
+}
+
+void TimelineTask::Start(uint64_t context) noexcept
+{
+	handle.promise().context = context;
+	handle.resume();
+}
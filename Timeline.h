@@ -0,0 +1,168 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <utility>
+
+#include "TimerWheel.h"
+
+//coroutines that sleep on a timing wheel and wait on input signals, a timeline only runs when the
+//thing it is waiting for happens, so one thread can interleave as many of them as fit in memory
+
+class TimelineTask
+{
+public:
+	struct promise_type
+	{
+		//handed back by TimelineScheduler::Advance after a sleep of this task ends
+		uint64_t context = 0;
+
+		[[nodiscard]]
+		TimelineTask get_return_object() noexcept { return TimelineTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+		[[nodiscard]]
+		std::suspend_always initial_suspend() const noexcept { return {}; }
+
+		[[nodiscard]]
+		std::suspend_always final_suspend() const noexcept { return {}; }
+
+		void return_void() const noexcept {}
+
+		//timelines are noexcept like the rest of the core
+		[[noreturn]]
+		void unhandled_exception() const noexcept { std::terminate(); }
+	};
+
+	TimelineTask() noexcept = default;
+	TimelineTask(TimelineTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	TimelineTask& operator=(TimelineTask&& other) noexcept;
+	~TimelineTask();
+
+	//runs the task up to its first suspension
+	void Start(uint64_t context) noexcept;
+
+	[[nodiscard]]
+	bool Done() const noexcept { return !handle || handle.done(); }
+
+private:
+	explicit TimelineTask(std::coroutine_handle<promise_type> handle) noexcept : handle(handle) {}
+
+	//a task destroyed while suspended cancels whatever it was waiting on
+	std::coroutine_handle<promise_type> handle;
+};
+
+//one waiter at a time, Signal() resumes it right away with the value
+template<typename T>
+class InputSignal
+{
+public:
+	struct Awaiter
+	{
+		InputSignal& signal;
+
+		[[nodiscard]]
+		bool await_ready() const noexcept { return false; }
+
+		void await_suspend(std::coroutine_handle<> waiter) noexcept { signal.waiter = waiter; }
+
+		[[nodiscard]]
+		T await_resume() const noexcept { return signal.value; }
+
+		//also runs when the waiting task is destroyed, which must not leave a dangling waiter
+		~Awaiter() { signal.waiter = nullptr; }
+	};
+
+	InputSignal() noexcept = default;
+	InputSignal(const InputSignal&) = delete;
+	InputSignal& operator=(const InputSignal&) = delete;
+
+	[[nodiscard]]
+	Awaiter operator co_await() noexcept { return { *this }; }
+
+	[[nodiscard]]
+	bool Waiting() const noexcept { return (bool)waiter; }
+
+	//false if nobody was waiting, the value is dropped then
+	bool Signal(const T& signalled) noexcept
+	{
+		if (!waiter)
+			return false;
+
+		value = signalled;
+		std::exchange(waiter, nullptr).resume();
+		return true;
+	}
+
+private:
+	std::coroutine_handle<> waiter;
+	T value = {};
+};
+
+class TimelineScheduler
+{
+public:
+	struct SleepAwaiter
+	{
+		TimelineScheduler& scheduler;
+		int64_t deadline;
+		TimerHandle timer = {};
+
+		[[nodiscard]]
+		bool await_ready() const noexcept { return false; }
+
+		void await_suspend(std::coroutine_handle<TimelineTask::promise_type> sleeper) noexcept
+		{
+			timer = scheduler.wheel.Schedule(deadline, (uint64_t)sleeper.address());
+		}
+
+		//the time the sleep actually ended
+		[[nodiscard]]
+		int64_t await_resume() const noexcept { return scheduler.currentTime; }
+
+		//a fired timer no longer matches its handle, so this only cancels sleeps cut short
+		~SleepAwaiter() { scheduler.wheel.Cancel(timer); }
+	};
+
+	TimelineScheduler(int64_t resolution, int64_t start) noexcept : wheel(resolution, start), currentTime(start) {}
+
+	TimelineScheduler(const TimelineScheduler&) = delete;
+	TimelineScheduler& operator=(const TimelineScheduler&) = delete;
+
+	//resumes after the clock is at or past deadline
+	[[nodiscard]]
+	SleepAwaiter SleepUntil(int64_t deadline) noexcept { return { *this, deadline }; }
+
+	//resumes every task whose sleep has ended, then calls onResumed(context) for it
+	template<typename Function>
+	void Advance(int64_t now, Function&& onResumed) noexcept
+	{
+		currentTime = now;
+
+		wheel.Advance(now, [&](uint64_t address)
+			{
+				const auto sleeper = std::coroutine_handle<TimelineTask::promise_type>::from_address((void*)address);
+				const uint64_t context = sleeper.promise().context;
+				sleeper.resume();
+				onResumed(context);
+			});
+	}
+
+	[[nodiscard]]
+	int64_t NextExpiry() const noexcept { return wheel.NextExpiry(); }
+
+	[[nodiscard]]
+	uint32_t SleepingCount() const noexcept { return wheel.Size(); }
+
+	void Reserve(uint32_t taskCount) noexcept { wheel.Reserve(taskCount); }
+
+private:
+	TimerWheel wheel;
+	int64_t currentTime;
+};
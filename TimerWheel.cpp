@@ -0,0 +1,211 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+#include <bit>
+
+TimerWheel::TimerWheel(int64_t resolution, int64_t start) noexcept :
+	resolution(std::max(resolution, (int64_t)1)),
+	currentTick(start < 0 ? 0 : (uint64_t)(start / this->resolution))
+{
+	std::fill(std::begin(heads), std::end(heads), NIL);
+}
+
+TimerHandle TimerWheel::Schedule(int64_t deadline, uint64_t payload) noexcept
+{
+	uint32_t node;
+	if (freeList != NIL)
+	{
+		node = freeList;
+		freeList = nodes[node].next;
+	}
+	else
+	{
+		node = (uint32_t)nodes.size();
+		nodes.push_back({ .generation = 0 });
+	}
+
+	//rounded up, so a timer never fires early
+	nodes[node].expiryTick = deadline <= 0 ? 0 : (uint64_t)((deadline + resolution - 1) / resolution);
+	nodes[node].payload = payload;
+
+	Place(node);
+	activeCount++;
+
+	return { .index = node, .generation = nodes[node].generation };
+}
+
+bool TimerWheel::Cancel(TimerHandle handle) noexcept
+{
+	if (handle.index >= nodes.size() || nodes[handle.index].generation != handle.generation || nodes[handle.index].list == NIL)
+		return false;
+
+	Unlink(handle.index);
+	Release(handle.index);
+	return true;
+}
+
+void TimerWheel::Place(uint32_t node) noexcept
+{
+	const uint64_t expiryTick = nodes[node].expiryTick;
+
+	if (expiryTick <= currentTick)
+	{
+		Link(node, DUE_LIST);
+		return;
+	}
+
+	//the level is the highest slot group in which expiry and now differ
+	const uint64_t delta = expiryTick - currentTick;
+
+	for (uint32_t level = 0; level < LEVEL_COUNT; level++)
+	{
+		if (delta < (1ull << (SLOT_BITS * (level + 1))))
+		{
+			Link(node, ListIndex(level, (uint32_t)((expiryTick >> (SLOT_BITS * level)) & SLOT_MASK)));
+			return;
+		}
+	}
+
+	//further out than the wheel reaches, parked in the last slot the top level will visit
+	const uint32_t topShift = SLOT_BITS * (LEVEL_COUNT - 1);
+	Link(node, ListIndex(LEVEL_COUNT - 1, (uint32_t)(((currentTick >> topShift) - 1) & SLOT_MASK)));
+}
+
+void TimerWheel::Link(uint32_t node, uint32_t list) noexcept
+{
+	TimerNode& linking = nodes[node];
+	linking.list = list;
+	linking.previous = NIL;
+	linking.next = heads[list];
+
+	if (heads[list] != NIL)
+		nodes[heads[list]].previous = node;
+	heads[list] = node;
+
+	if (list != DUE_LIST)
+		occupied[list / SLOT_COUNT][(list % SLOT_COUNT) / 64] |= 1ull << (list % 64);
+}
+
+void TimerWheel::Unlink(uint32_t node) noexcept
+{
+	TimerNode& unlinking = nodes[node];
+	const uint32_t list = unlinking.list;
+
+	if (unlinking.previous != NIL)
+		nodes[unlinking.previous].next = unlinking.next;
+	else
+		heads[list] = unlinking.next;
+
+	if (unlinking.next != NIL)
+		nodes[unlinking.next].previous = unlinking.previous;
+
+	if (heads[list] == NIL && list != DUE_LIST)
+		occupied[list / SLOT_COUNT][(list % SLOT_COUNT) / 64] &= ~(1ull << (list % 64));
+
+	unlinking.list = NIL;
+}
+
+void TimerWheel::Release(uint32_t node) noexcept
+{
+	//stale handles stop matching
+	nodes[node].generation++;
+	nodes[node].next = freeList;
+	freeList = node;
+	activeCount--;
+}
+
+void TimerWheel::Cascade() noexcept
+{
+	//find the highest level whose slot starts right now, then work down so
+	//timers moved out of it can land in the lower slots that are cascaded next
+	uint32_t topLevel = 1;
+	while (topLevel + 1 < LEVEL_COUNT && ((currentTick >> (SLOT_BITS * topLevel)) & SLOT_MASK) == 0)
+		topLevel++;
+
+	for (uint32_t level = topLevel; level >= 1; level--)
+	{
+		const uint32_t list = ListIndex(level, (uint32_t)((currentTick >> (SLOT_BITS * level)) & SLOT_MASK));
+
+		//the whole slot moves, so it is taken off in one go instead of unlinking node by node
+		uint32_t node = heads[list];
+		heads[list] = NIL;
+		occupied[level][(list % SLOT_COUNT) / 64] &= ~(1ull << (list % 64));
+
+		while (node != NIL)
+		{
+			const uint32_t next = nodes[node].next;
+			Place(node);
+			node = next;
+		}
+	}
+}
+
+int32_t TimerWheel::NextOccupied(uint32_t level, uint32_t slot) const noexcept
+{
+	constexpr uint32_t wordCount = SLOT_COUNT / 64;
+
+	for (uint32_t step = 0; step <= wordCount; step++)
+	{
+		const uint32_t word = (slot / 64 + step) % wordCount;
+		uint64_t bits = occupied[level][word];
+
+		//the first word is only looked at from slot on, the last lap only before it
+		if (step == 0)
+			bits &= ~0ull << (slot % 64);
+		else if (step == wordCount)
+			bits &= (slot % 64 == 0) ? 0 : ~0ull >> (64 - slot % 64);
+
+		if (bits != 0)
+		{
+			const uint32_t found = word * 64 + (uint32_t)std::countr_zero(bits);
+			return (int32_t)((found - slot) & SLOT_MASK);
+		}
+	}
+	return -1;
+}
+
+uint64_t TimerWheel::NextStop(uint64_t targetTick) const noexcept
+{
+	//the next cascade happens when the lowest level wraps
+	uint64_t stop = (currentTick | SLOT_MASK) + 1;
+
+	const int32_t distance = NextOccupied(0, (uint32_t)((currentTick + 1) & SLOT_MASK));
+	if (distance >= 0)
+		stop = std::min(stop, currentTick + 1 + distance);
+
+	return std::min(stop, targetTick);
+}
+
+int64_t TimerWheel::NextExpiry() const noexcept
+{
+	if (heads[DUE_LIST] != NIL)
+		return (int64_t)currentTick * resolution;
+
+	if (activeCount == 0)
+		return NO_DEADLINE;
+
+	uint64_t nextTick = ~0ull;
+
+	const int32_t distance = NextOccupied(0, (uint32_t)((currentTick + 1) & SLOT_MASK));
+	if (distance >= 0)
+		nextTick = currentTick + 1 + distance;
+
+	//anything higher up first has to be cascaded, which happens when its slot starts
+	for (uint32_t level = 1; level < LEVEL_COUNT; level++)
+	{
+		const uint32_t shift = SLOT_BITS * level;
+		const uint64_t levelTick = currentTick >> shift;
+
+		const int32_t levelDistance = NextOccupied(level, (uint32_t)((levelTick + 1) & SLOT_MASK));
+		if (levelDistance >= 0)
+			nextTick = std::min(nextTick, (levelTick + 1 + levelDistance) << shift);
+	}
+
+	return nextTick == ~0ull ? NO_DEADLINE : (int64_t)(nextTick * resolution);
+}
@@ -0,0 +1,140 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "SimonCore.h"
+
+//hierarchical timing wheel, 4 levels of 256 slots, one slot per resolution at the lowest level
+//schedule and cancel are O(1), timers are intrusive list nodes in a pool so nothing allocates
+//once the pool has grown, a timer never fires before its deadline and at most one resolution after it
+
+struct TimerHandle
+{
+	uint32_t index = ~0u;
+	uint32_t generation = 0;
+};
+
+class TimerWheel
+{
+public:
+	static constexpr uint32_t SLOT_BITS = 8;
+	static constexpr uint32_t SLOT_COUNT = 1 << SLOT_BITS;
+	static constexpr uint32_t LEVEL_COUNT = 4;
+
+	//resolution is in clock ticks, start is the clock's current time
+	TimerWheel(int64_t resolution, int64_t start) noexcept;
+
+	//payload is handed back to the callback when the timer fires
+	[[nodiscard]]
+	TimerHandle Schedule(int64_t deadline, uint64_t payload) noexcept;
+
+	//false if the timer already fired or was cancelled
+	bool Cancel(TimerHandle handle) noexcept;
+
+	//fires every timer whose deadline is at or before now, oldest slot first
+	//onExpired(payload) may schedule and cancel timers, including ones due in this call
+	template<typename Function>
+	void Advance(int64_t now, Function&& onExpired) noexcept
+	{
+		FireList(DUE_LIST, onExpired);
+
+		const uint64_t targetTick = now < 0 ? 0 : (uint64_t)(now / resolution);
+
+		while (currentTick < targetTick)
+		{
+			currentTick = NextStop(targetTick);
+
+			if ((currentTick & SLOT_MASK) == 0)
+				Cascade();
+
+			FireList(ListIndex(0, (uint32_t)(currentTick & SLOT_MASK)), onExpired);
+		}
+	}
+
+	//when Advance has something to do next, exact for timers in the lowest level and a lower bound for the
+	//rest, NO_DEADLINE when nothing is scheduled
+	[[nodiscard]]
+	int64_t NextExpiry() const noexcept;
+
+	[[nodiscard]]
+	uint32_t Size() const noexcept { return activeCount; }
+
+	//grows the node pool up front
+	void Reserve(uint32_t timerCount) noexcept { nodes.reserve(timerCount); }
+
+private:
+	static constexpr uint64_t SLOT_MASK = SLOT_COUNT - 1;
+	static constexpr uint32_t NIL = ~0u;
+	static constexpr uint32_t LIST_COUNT = LEVEL_COUNT * SLOT_COUNT + 1;
+	static constexpr uint32_t DUE_LIST = LIST_COUNT - 1;
+
+	struct TimerNode
+	{
+		uint64_t expiryTick;
+		uint64_t payload;
+		uint32_t next;
+		uint32_t previous;
+		uint32_t list;
+		uint32_t generation;
+	};
+
+	[[nodiscard]]
+	static constexpr uint32_t ListIndex(uint32_t level, uint32_t slot) noexcept { return level * SLOT_COUNT + slot; }
+
+	void Place(uint32_t node) noexcept;
+	void Link(uint32_t node, uint32_t list) noexcept;
+	void Unlink(uint32_t node) noexcept;
+	void Release(uint32_t node) noexcept;
+
+	//moves everything in the slots of the higher levels that start at currentTick one level down
+	void Cascade() noexcept;
+
+	//the next tick at or before targetTick that has a slot to fire or a cascade to run
+	[[nodiscard]]
+	uint64_t NextStop(uint64_t targetTick) const noexcept;
+
+	//distance from slot to the next occupied slot of the level, wrapping around, or -1
+	[[nodiscard]]
+	int32_t NextOccupied(uint32_t level, uint32_t slot) const noexcept;
+
+	template<typename Function>
+	void FireList(uint32_t list, Function& onExpired) noexcept
+	{
+		//one at a time, so the callback is free to change the list
+		while (heads[list] != NIL)
+		{
+			const uint32_t node = heads[list];
+
+			//clamped timers beyond the top level come back around before their time
+			if (nodes[node].expiryTick > currentTick)
+			{
+				Unlink(node);
+				Place(node);
+				continue;
+			}
+
+			const uint64_t payload = nodes[node].payload;
+			Unlink(node);
+			Release(node);
+			onExpired(payload);
+		}
+	}
+
+	int64_t resolution;
+	uint64_t currentTick;
+
+	std::vector<TimerNode> nodes;
+	uint32_t freeList = NIL;
+	uint32_t activeCount = 0;
+
+	uint32_t heads[LIST_COUNT];
+	//one bit per occupied slot, to skip empty stretches
+	uint64_t occupied[LEVEL_COUNT][SLOT_COUNT / 64] = {};
+};
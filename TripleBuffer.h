@@ -0,0 +1,64 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "SimonCore.h"
+
+//latest-value handoff from exactly one writer thread to exactly one reader thread, lock-free and wait-free
+//the writer fills a slot nobody else sees and swaps it into the middle, the reader swaps the middle out for
+//its own slot, so neither ever touches a slot the other is using and a value is never seen half written
+//the reader skips values it was too slow for, which is what a renderer wants
+template<typename T>
+class TripleBuffer
+{
+public:
+	//writer only, the slot the next Publish() hands over
+	[[nodiscard]]
+	T& WriteSlot() noexcept { return slots[backIndex].value; }
+
+	//writer only
+	void Publish() noexcept
+	{
+		const uint32_t previous = middle.exchange(backIndex | FRESH_BIT, std::memory_order_acq_rel);
+		backIndex = previous & INDEX_MASK;
+	}
+
+	//reader only, true if something newer than Read() was published
+	bool Update() noexcept
+	{
+		if (!(middle.load(std::memory_order_relaxed) & FRESH_BIT))
+			return false;
+
+		const uint32_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+		frontIndex = previous & INDEX_MASK;
+		return true;
+	}
+
+	//reader only, stays put until the next Update()
+	[[nodiscard]]
+	const T& Read() const noexcept { return slots[frontIndex].value; }
+
+private:
+	static constexpr uint32_t INDEX_MASK = 3;
+	static constexpr uint32_t FRESH_BIT = 4;
+
+	struct alignas(CACHE_LINE_SIZE) Slot
+	{
+		T value = {};
+	};
+
+	Slot slots[3];
+
+	//the slot in between, plus whether the writer put it there after the reader last looked
+	alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> middle = 1;
+
+	alignas(CACHE_LINE_SIZE) uint32_t backIndex = 0;
+	alignas(CACHE_LINE_SIZE) uint32_t frontIndex = 2;
+};
@@ -0,0 +1,186 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+namespace
+{
+	[[nodiscard]]
+	constexpr uint64_t PackRange(uint32_t begin, uint32_t end) noexcept
+	{
+		return (uint64_t)begin << 32 | end;
+	}
+
+	[[nodiscard]]
+	constexpr uint32_t RangeBegin(uint64_t range) noexcept
+	{
+		return (uint32_t)(range >> 32);
+	}
+
+	[[nodiscard]]
+	constexpr uint32_t RangeEnd(uint64_t range) noexcept
+	{
+		return (uint32_t)range;
+	}
+}
+
+WorkStealingPool::WorkStealingPool(uint32_t threadCount) noexcept :
+	slots(std::max(threadCount, 1u))
+{
+	threads.reserve(slots.size() - 1);
+	for (uint32_t worker = 1; worker < slots.size(); worker++)
+		threads.emplace_back([this, worker] { WorkerMain(worker); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	{
+		std::lock_guard lock(jobMutex);
+		bStopping = true;
+	}
+	jobStarted.notify_all();
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+uint64_t WorkStealingPool::StealCount() const noexcept
+{
+	uint64_t steals = 0;
+	for (const WorkerSlot& slot : slots)
+		steals += slot.stolenChunks;
+	return steals;
+}
+
+void WorkStealingPool::Run(uint32_t count, uint32_t grain, Invoke invoke, void* context) noexcept
+{
+	if (count == 0)
+		return;
+
+	const uint32_t workerCount = ThreadCount();
+
+	//even split up front, stealing only has to fix the imbalance
+	for (uint32_t worker = 0; worker < workerCount; worker++)
+	{
+		const uint32_t begin = (uint32_t)((uint64_t)count * worker / workerCount);
+		const uint32_t end = (uint32_t)((uint64_t)count * (worker + 1) / workerCount);
+		slots[worker].range.store(PackRange(begin, end), std::memory_order_relaxed);
+	}
+
+	pendingIndices.store(count, std::memory_order_relaxed);
+	activeWorkers.store(workerCount - 1, std::memory_order_relaxed);
+
+	{
+		std::lock_guard lock(jobMutex);
+		jobInvoke = invoke;
+		jobContext = context;
+		jobGrain = std::max(grain, 1u);
+		jobGeneration++;
+	}
+	jobStarted.notify_all();
+
+	RunJob(0);
+
+	std::unique_lock lock(jobMutex);
+	jobFinished.wait(lock, [this] { return activeWorkers.load(std::memory_order_acquire) == 0; });
+}
+
+void WorkStealingPool::WorkerMain(uint32_t worker) noexcept
+{
+	uint64_t seenGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock lock(jobMutex);
+			jobStarted.wait(lock, [&] { return bStopping || jobGeneration != seenGeneration; });
+
+			if (bStopping)
+				return;
+
+			seenGeneration = jobGeneration;
+		}
+
+		RunJob(worker);
+
+		if (activeWorkers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard lock(jobMutex);
+			jobFinished.notify_one();
+		}
+	}
+}
+
+void WorkStealingPool::RunJob(uint32_t worker) noexcept
+{
+	while (pendingIndices.load(std::memory_order_acquire) != 0)
+	{
+		uint32_t begin;
+		uint32_t end;
+
+		if (TakeOwn(worker, begin, end) || Steal(worker, begin, end))
+		{
+			jobInvoke(jobContext, begin, end, worker);
+			pendingIndices.fetch_sub(end - begin, std::memory_order_acq_rel);
+		}
+		else
+		{
+			//everything left is already running on other workers
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool WorkStealingPool::TakeOwn(uint32_t worker, uint32_t& begin, uint32_t& end) noexcept
+{
+	std::atomic<uint64_t>& range = slots[worker].range;
+	uint64_t current = range.load(std::memory_order_acquire);
+
+	while (RangeBegin(current) < RangeEnd(current))
+	{
+		begin = RangeBegin(current);
+		end = std::min(RangeEnd(current), begin + jobGrain);
+
+		if (range.compare_exchange_weak(current, PackRange(end, RangeEnd(current)), std::memory_order_acq_rel))
+			return true;
+	}
+	return false;
+}
+
+bool WorkStealingPool::Steal(uint32_t worker, uint32_t& begin, uint32_t& end) noexcept
+{
+	const uint32_t workerCount = ThreadCount();
+
+	for (uint32_t offset = 1; offset < workerCount; offset++)
+	{
+		std::atomic<uint64_t>& victim = slots[(worker + offset) % workerCount].range;
+		uint64_t current = victim.load(std::memory_order_acquire);
+
+		while (RangeBegin(current) < RangeEnd(current))
+		{
+			const uint32_t victimBegin = RangeBegin(current);
+			const uint32_t victimEnd = RangeEnd(current);
+
+			//small ranges go whole, bigger ones are halved and the back half becomes ours
+			const uint32_t split = victimEnd - victimBegin <= jobGrain ? victimBegin : victimBegin + (victimEnd - victimBegin) / 2;
+
+			if (!victim.compare_exchange_weak(current, PackRange(victimBegin, split), std::memory_order_acq_rel))
+				continue;
+
+			slots[worker].stolenChunks++;
+
+			begin = split;
+			end = std::min(victimEnd, split + jobGrain);
+
+			//our own range is empty, so nobody else can be changing it right now
+			slots[worker].range.store(PackRange(end, victimEnd), std::memory_order_release);
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,84 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SimonCore.h"
+
+//fixed set of threads that split index ranges between them
+//every worker owns a range packed into one atomic word, it takes chunks off the front
+//and when it runs dry it steals the back half of another worker's range, so no lock is held while working
+class WorkStealingPool
+{
+public:
+	//the calling thread is worker 0, so threadCount - 1 threads are started
+	explicit WorkStealingPool(uint32_t threadCount) noexcept;
+	~WorkStealingPool();
+
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	[[nodiscard]]
+	uint32_t ThreadCount() const noexcept { return (uint32_t)slots.size(); }
+
+	//chunks taken from another worker so far, only meaningful between jobs
+	[[nodiscard]]
+	uint64_t StealCount() const noexcept;
+
+	//calls function(begin, end, worker) on chunks of at most grain indices until [0, count) is covered,
+	//returns once every chunk has finished
+	template<typename Function>
+	void ParallelFor(uint32_t count, uint32_t grain, Function&& function) noexcept
+	{
+		Run(count, grain, [](void* context, uint32_t begin, uint32_t end, uint32_t worker)
+			{
+				(*(Function*)context)(begin, end, worker);
+			}, &function);
+	}
+
+private:
+	using Invoke = void(*)(void* context, uint32_t begin, uint32_t end, uint32_t worker);
+
+	struct alignas(CACHE_LINE_SIZE) WorkerSlot
+	{
+		//begin in the high half, end in the low half
+		std::atomic<uint64_t> range = 0;
+		uint64_t stolenChunks = 0;
+	};
+
+	void Run(uint32_t count, uint32_t grain, Invoke invoke, void* context) noexcept;
+	void WorkerMain(uint32_t worker) noexcept;
+	void RunJob(uint32_t worker) noexcept;
+
+	[[nodiscard]]
+	bool TakeOwn(uint32_t worker, uint32_t& begin, uint32_t& end) noexcept;
+
+	[[nodiscard]]
+	bool Steal(uint32_t worker, uint32_t& begin, uint32_t& end) noexcept;
+
+	std::vector<WorkerSlot> slots;
+	std::vector<std::thread> threads;
+
+	Invoke jobInvoke = nullptr;
+	void* jobContext = nullptr;
+	uint32_t jobGrain = 1;
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> pendingIndices = 0;
+	std::atomic<uint32_t> activeWorkers = 0;
+
+	//only taken to start and finish a job, never per chunk
+	std::mutex jobMutex;
+	std::condition_variable jobStarted;
+	std::condition_variable jobFinished;
+	uint64_t jobGeneration = 0;
+	bool bStopping = false;
+};
@@ -0,0 +1,145 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//counts every global operator new while the game ticks and renders steady-state frames,
+//exits non-zero if a single frame after warm-up allocated anything
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#include "SimonCore.h"
+#include "Scene.h"
+#include "SoftwareRenderer.h"
+
+namespace
+{
+	std::atomic<uint64_t> allocationCount = 0;
+
+	[[nodiscard]]
+	void* CountedAllocate(size_t size, size_t alignment)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+		if (size == 0)
+			size = 1;
+
+		//the aligned forms are always taken for the aligned operators, so their deletes know which free to call
+		void* memory;
+		if (alignment == 0)
+			memory = std::malloc(size);
+		else
+#if defined(_WIN32)
+			memory = _aligned_malloc(size, alignment);
+#else
+			memory = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+
+		if (memory == nullptr)
+			throw std::bad_alloc();
+
+		return memory;
+	}
+
+	void AlignedFree(void* memory) noexcept
+	{
+#if defined(_WIN32)
+		_aligned_free(memory);
+#else
+		std::free(memory);
+#endif
+	}
+}
+
+void* operator new(size_t size) { return CountedAllocate(size, 0); }
+void* operator new[](size_t size) { return CountedAllocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return CountedAllocate(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return CountedAllocate(size, (size_t)alignment); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	try { return CountedAllocate(size, 0); }
+	catch (...) { return nullptr; }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	try { return CountedAllocate(size, 0); }
+	catch (...) { return nullptr; }
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { AlignedFree(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { AlignedFree(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { AlignedFree(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { AlignedFree(memory); }
+
+int main(int argc, char** argv)
+{
+	const int frameCount = argc > 1 ? atoi(argv[1]) : 100'000;
+	constexpr uint32_t size = 576;
+
+	ManualClock clock;
+	GameCore game(GameTimings::FromFrequency(clock.Frequency()), clock.Now(), 1);
+	SoftwareRenderer renderer(size, size);
+	RetainedScene retainedScene;
+
+	auto RenderFrame = [&](MenuItem hoveredMenuItem, int hoveredButton)
+		{
+			const SceneState state = game.gameState == GAME_STATE_MENU ?
+				MenuSceneState(size, size, hoveredMenuItem) :
+				GameSceneState(size, size, game, game.DisplayedLitButton(hoveredButton));
+
+			(void)retainedScene.Draw(renderer, state);
+		};
+
+	//warm-up, every cache gets filled once
+	for (int i = 0; i < 3; i++)
+		RenderFrame((MenuItem)i, NO_BUTTON);
+	game.StartGame(clock.Now());
+	RenderFrame(MenuItem::None, NO_BUTTON);
+	(void)DrawScene(renderer, GameSceneState(size, size, game, 0));
+
+	const uint64_t allocationsBefore = allocationCount.load();
+	uint64_t worstFrame = 0;
+
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		const uint64_t frameStart = allocationCount.load(std::memory_order_relaxed);
+
+		clock.Advance(clock.Frequency() / 60);
+
+		//a player who always presses the right button
+		GameInput input = {};
+		if (game.gameState == GAME_STATE_INPUT && !game.bOutstandingTimer)
+		{
+			input.hoveredButton = game.ButtonAt(game.playbackLocation);
+			input.clicked = true;
+		}
+
+		game.Tick(clock.Now(), input);
+		RenderFrame(MenuItem::None, input.hoveredButton);
+
+		const uint64_t frameAllocations = allocationCount.load(std::memory_order_relaxed) - frameStart;
+		if (frameAllocations > worstFrame)
+			worstFrame = frameAllocations;
+	}
+
+	const uint64_t allocations = allocationCount.load() - allocationsBefore;
+
+	printf("frames,allocations,worst_frame,final_score\n");
+	printf("%d,%llu,%llu,%d\n", frameCount, (unsigned long long)allocations, (unsigned long long)worstFrame, game.bestScore);
+
+	return allocations == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
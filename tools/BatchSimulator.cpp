@@ -0,0 +1,72 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//plays millions of headless games with a probabilistic player on every thread count up to the
+//number of cores, then prints the score distribution for the given timings
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "BatchSimulator.h"
+#include "WorkStealingPool.h"
+
+int main(int argc, char** argv)
+{
+	const uint32_t gameCount = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 1'000'000;
+	const uint32_t maxThreads = argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : std::max(std::thread::hardware_concurrency(), 1u);
+	const double litSeconds = argc > 3 ? atof(argv[3]) / 1000 : .4;
+	const uint64_t seed = 1;
+
+	constexpr int64_t frequency = 1'000'000;
+	GameTimings timings = GameTimings::FromFrequency(frequency);
+	timings.ButtonLitTicks = (int64_t)(litSeconds * frequency);
+
+	const PlayerModel player;
+
+	SimulationStats stats;
+	double singleThreadRate = 0;
+
+	printf("threads,games_per_s,speedup,steals\n");
+
+	for (uint32_t threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+	{
+		WorkStealingPool pool(threadCount);
+
+		const auto start = std::chrono::steady_clock::now();
+		const SimulationStats runStats = SimulateGames(pool, timings, frequency, player, seed, gameCount);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		const double rate = gameCount / seconds;
+		if (threadCount == 1)
+		{
+			singleThreadRate = rate;
+			stats = runStats;
+		}
+		else if (runStats.totalScore != stats.totalScore)
+		{
+			//every game is a pure function of its index, so the thread count must not matter
+			fprintf(stderr, "results differ between 1 and %u threads\n", threadCount);
+			return EXIT_FAILURE;
+		}
+
+		printf("%u,%.0f,%.2f,%llu\n", threadCount, rate, rate / singleThreadRate, (unsigned long long)pool.StealCount());
+	}
+
+	printf("\nlit_ms,games,mean_score,p10,p50,p90,max_score,mean_game_s\n");
+	printf("%.0f,%llu,%.2f,%d,%d,%d,%d,%.1f\n",
+		litSeconds * 1000,
+		(unsigned long long)stats.games,
+		(double)stats.totalScore / stats.games,
+		stats.ScorePercentile(.1),
+		stats.ScorePercentile(.5),
+		stats.ScorePercentile(.9),
+		stats.maxScore,
+		(double)stats.totalDuration / stats.games / frequency);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//microbenchmarks of the hot paths, one csv row per benchmark so results can be diffed between releases
+//every benchmark is calibrated to run for at least MIN_REPETITION_SECONDS, then repeated and the
+//median, min and max of the repetitions are reported, the median is the number to compare
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "BoardGeometry.h"
+#include "CounterRng.h"
+#include "PackedSequence.h"
+#include "Scene.h"
+#include "SimonCore.h"
+#include "SoftwareRenderer.h"
+
+namespace
+{
+	constexpr double MIN_REPETITION_SECONDS = .02;
+
+	//keeps the compiler from deleting work whose result is never used
+	template<typename T>
+	void DoNotOptimize(const T& value) noexcept
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static const void* volatile sink;
+		sink = &value;
+#endif
+	}
+
+	struct BenchmarkResult
+	{
+		uint64_t iterations;
+		double medianNs;
+		double minNs;
+		double maxNs;
+	};
+
+	template<typename Function>
+	[[nodiscard]]
+	double SecondsFor(uint64_t iterations, Function& function) noexcept
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < iterations; i++)
+			function();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	template<typename Function>
+	[[nodiscard]]
+	BenchmarkResult Measure(int repetitions, Function function) noexcept
+	{
+		uint64_t iterations = 1;
+		while (SecondsFor(iterations, function) < MIN_REPETITION_SECONDS)
+			iterations *= 2;
+
+		std::vector<double> nsPerOp(repetitions);
+		for (double& ns : nsPerOp)
+			ns = SecondsFor(iterations, function) * 1e9 / iterations;
+
+		std::sort(nsPerOp.begin(), nsPerOp.end());
+
+		return
+		{
+			.iterations = iterations,
+			.medianNs = nsPerOp[nsPerOp.size() / 2],
+			.minNs = nsPerOp.front(),
+			.maxNs = nsPerOp.back()
+		};
+	}
+}
+
+int main(int argc, char** argv)
+{
+	//optional substring filter and repetition count
+	const char* filter = argc > 1 ? argv[1] : "";
+	const int repetitions = argc > 2 ? std::max(atoi(argv[2]), 1) : 9;
+
+	printf("benchmark,items_per_op,iterations,median_ns,min_ns,max_ns,median_ns_per_item\n");
+
+	auto Run = [&](const char* name, uint32_t itemsPerOp, auto function)
+		{
+			if (strstr(name, filter) == nullptr)
+				return;
+
+			const BenchmarkResult result = Measure(repetitions, function);
+			printf("%s,%u,%llu,%.2f,%.2f,%.2f,%.3f\n",
+				name,
+				itemsPerOp,
+				(unsigned long long)result.iterations,
+				result.medianNs,
+				result.minNs,
+				result.maxNs,
+				result.medianNs / itemsPerOp);
+		};
+
+	const BoardLayout layout = BoardLayout::FromClientSize(576, 576);
+
+	//the four wedge outlines DrawGame() used to compute with sin/cos on every frame
+	Run("geometry_build", BUTTON_COUNT, [&]
+		{
+			for (int i = 0; i < BUTTON_COUNT; i++)
+				DoNotOptimize(BuildWedgeOutline(layout, i));
+		});
+
+	{
+		GeometryCache<std::array<WedgeOutline, BUTTON_COUNT>> cache;
+		const GeometryKey key = { .width = 576, .height = 576, .dpi = 96 };
+
+		Run("geometry_cache_hit", 1, [&]
+			{
+				DoNotOptimize(cache.GetOrBuild(key, [&](std::array<WedgeOutline, BUTTON_COUNT>& outlines)
+					{
+						for (int i = 0; i < BUTTON_COUNT; i++)
+							outlines[i] = BuildWedgeOutline(layout, i);
+					}));
+			});
+	}
+
+	{
+		constexpr uint32_t pointCount = 4096;
+		std::vector<float> x(pointCount);
+		std::vector<float> y(pointCount);
+		std::vector<uint8_t> buttons(pointCount);
+
+		//a fixed grid over the board, so every run tests the same points
+		for (uint32_t i = 0; i < pointCount; i++)
+		{
+			x[i] = layout.centerX + layout.fullRadius * 1.05f * ((float)(i % 64) / 32 - 1);
+			y[i] = layout.centerY + layout.fullRadius * 1.05f * ((float)(i / 64) / 32 - 1);
+		}
+
+		Run("hit_test_scalar", pointCount, [&]
+			{
+				for (uint32_t i = 0; i < pointCount; i++)
+					buttons[i] = (uint8_t)HitTestButton(layout, x[i], y[i]);
+				DoNotOptimize(buttons.data());
+			});
+
+		Run("hit_test_batch", pointCount, [&]
+			{
+				HitTestButtons(layout, x.data(), y.data(), buttons.data(), pointCount);
+				DoNotOptimize(buttons.data());
+			});
+	}
+
+	{
+		//play back a 16 step sequence and repeat it, jumping straight to every deadline
+		constexpr int roundLength = 16;
+		const GameTimings timings = GameTimings::FromFrequency(1'000'000);
+		uint64_t seed = 0;
+
+		Run("state_machine_round", roundLength, [&]
+			{
+				GameCore game(timings, 0, seed++);
+				game.playbackLength = roundLength;
+
+				int64_t now = 0;
+				game.StartGame(now);
+
+				while (game.gameState != GAME_STATE_INPUT || game.bOutstandingTimer)
+				{
+					now = game.NextDeadline();
+					game.Tick(now, {});
+				}
+
+				for (int i = 0; i < roundLength; i++)
+					game.Tick(++now, { .hoveredButton = game.ButtonAt(game.playbackLocation), .clicked = true });
+
+				DoNotOptimize(game.playbackLength);
+			});
+	}
+
+	{
+		constexpr uint32_t stepCount = 1024;
+		uint64_t stream = 0;
+
+		Run("sequence_generate", stepCount, [&]
+			{
+				const CounterRng sequence = CounterRng::ForStream(1, stream++);
+				int sum = 0;
+				for (uint32_t i = 0; i < stepCount; i++)
+					sum += sequence.Button(i);
+				DoNotOptimize(sum);
+			});
+
+		PackedSequence packed;
+		packed.Reserve(stepCount);
+
+		Run("packed_sequence_set_get", stepCount, [&]
+			{
+				for (uint32_t i = 0; i < stepCount; i++)
+					packed.Set(i, (int)(i * 7 % BUTTON_COUNT));
+
+				int sum = 0;
+				for (uint32_t i = 0; i < stepCount; i++)
+					sum += packed.Get(i);
+				DoNotOptimize(sum);
+			});
+	}
+
+	{
+		constexpr uint32_t numberCount = 1024;
+		int value = 0;
+
+		Run("score_format", numberCount, [&]
+			{
+				wchar_t buffer[NUMBER_BUFFER_LENGTH];
+				uint32_t length = 0;
+				for (uint32_t i = 0; i < numberCount; i++)
+				{
+					length += FormatNumber(value, buffer);
+					value = (value + 7919) % 100'000;
+				}
+				DoNotOptimize(length);
+			});
+	}
+
+	{
+		SoftwareRenderer renderer(576, 576);
+		GameCore game(GameTimings::FromFrequency(1'000'000), 0, 1);
+		game.playbackLength = 12;
+
+		Run("game_frame_software", 1, [&]
+			{
+				DoNotOptimize(DrawScene(renderer, GameSceneState(576, 576, game, 2)));
+			});
+	}
+
+	return EXIT_SUCCESS;
+}
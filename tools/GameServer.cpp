@@ -0,0 +1,58 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//serves Simon sessions over a unix socket and optionally loopback tcp until interrupted
+//arguments: socket path (default /tmp/simon.sock), tcp port (default 0, no tcp)
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+
+#include "GameServer.h"
+
+namespace
+{
+	GameServer* runningServer = nullptr;
+
+	void StopOnSignal(int) noexcept
+	{
+		if (runningServer != nullptr)
+			runningServer->Stop();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char* socketPath = argc > 1 ? argv[1] : "/tmp/simon.sock";
+	const int tcpPort = argc > 2 ? atoi(argv[2]) : 0;
+
+	SteadyClock clock;
+	GameServer server(GameTimings::FromFrequency(clock.Frequency()), (uint64_t)clock.Now());
+
+	server.ListenUnix(socketPath);
+	if (tcpPort != 0)
+		server.ListenTcp((uint16_t)tcpPort);
+
+	runningServer = &server;
+	signal(SIGINT, StopOnSignal);
+	signal(SIGTERM, StopOnSignal);
+
+	server.Run();
+
+	const ServerStats& stats = server.Stats();
+	printf("sessions_accepted,sessions_refused,sessions_dropped,peak_sessions,messages_received,messages_sent,timer_ticks,wakeups\n");
+	printf("%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+		(unsigned long long)stats.sessionsAccepted,
+		(unsigned long long)stats.sessionsRefused,
+		(unsigned long long)stats.sessionsDropped,
+		(unsigned long long)stats.peakSessions,
+		(unsigned long long)stats.messagesReceived,
+		(unsigned long long)stats.messagesSent,
+		(unsigned long long)stats.timerTicks,
+		(unsigned long long)stats.wakeups);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,417 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//queries game history files
+//SimonHistory <history> [leaderboard size] prints score and reaction percentiles, error rates by step and the
+//leaderboard, SimonHistory --generate <path> [millions of games] writes simulated players, with no arguments or
+//--bench [millions of games] a bot's games are checked through GameCore, then a generated file is queried on
+//every thread count up to the number of cores and every answer compared with what the generator counted itself
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CounterRng.h"
+#include "GameHistory.h"
+#include "SimonCore.h"
+#include "WorkStealingPool.h"
+
+namespace
+{
+	constexpr uint64_t DEFAULT_MILLIONS = 10;
+	constexpr uint32_t DEFAULT_LEADERBOARD = 10;
+	constexpr double PERCENTILES[] = { .5, .9, .99, .999 };
+	//steps whose error rates are printed
+	constexpr size_t PRINTED_STEPS = 16;
+	constexpr int64_t FREQUENCY = 1'000'000;
+	constexpr int BOT_GAMES = 2'000;
+
+	//answers the generator keeps while writing, counted press by press without the reader's shortcuts
+	struct Expected
+	{
+		std::vector<uint64_t> scores;
+		std::vector<uint64_t> reactions = std::vector<uint64_t>(MAX_REACTION_MILLISECONDS + 1);
+		std::vector<PositionErrors> positions;
+		std::vector<LeaderboardEntry> leaderboard;
+		uint32_t leaderboardSize = DEFAULT_LEADERBOARD;
+		uint64_t games = 0;
+		uint64_t presses = 0;
+
+		void Count(const HistoryGame& game, uint64_t index) noexcept
+		{
+			const uint32_t score = game.playbackLength - 1;
+			if (scores.size() <= score)
+				scores.resize(score + 1);
+			scores[score]++;
+
+			if (positions.size() < game.playbackLength)
+				positions.resize(game.playbackLength);
+
+			//presses go round by round, step by step, so the step of each follows from where it is in the game
+			uint32_t round = 1;
+			uint32_t step = 0;
+			for (uint32_t i = 0; i < game.presses; i++)
+			{
+				reactions[game.reactionMilliseconds[i]]++;
+				positions[step].presses++;
+
+				if (++step == round)
+				{
+					round++;
+					step = 0;
+				}
+			}
+			if (game.failureStep != NO_FAILURE)
+				positions[(size_t)game.failureStep].errors++;
+
+			//games come in file order, so a tie never displaces an entry
+			if (leaderboard.size() < leaderboardSize || score > leaderboard.back().score)
+			{
+				const LeaderboardEntry entry = { .score = score, .seed = game.seed, .gameNumber = game.gameNumber, .index = index };
+				leaderboard.insert(std::upper_bound(leaderboard.begin(), leaderboard.end(), entry, [](const LeaderboardEntry& a, const LeaderboardEntry& b) { return a.score > b.score; }), entry);
+				if (leaderboard.size() > leaderboardSize)
+					leaderboard.pop_back();
+			}
+
+			games++;
+			presses += game.presses;
+		}
+	};
+
+	//a player who gets slower further into a round and misses more often, and sometimes leaves for the menu
+	[[nodiscard]]
+	bool Generate(const char* path, uint64_t gameCount, Expected* expected) noexcept
+	{
+		GameHistoryWriter writer;
+		if (!writer.Open(path, FREQUENCY))
+		{
+			fprintf(stderr, "%s cannot be written\n", path);
+			return false;
+		}
+
+		std::vector<uint16_t> reactions;
+		uint64_t random = 0;
+
+		for (uint64_t game = 0; game < gameCount; game++)
+		{
+			reactions.clear();
+
+			const uint64_t skill = SplitMix64(random++) % 40 + 10;
+			const bool bLeaves = SplitMix64(random++) % 10 == 0;
+			int32_t failureStep = NO_FAILURE;
+			uint32_t playbackLength = 1;
+
+			while (failureStep == NO_FAILURE)
+			{
+				if (bLeaves && SplitMix64(random++) % 8 == 0)
+					break;
+
+				for (uint32_t step = 0; step < playbackLength; step++)
+				{
+					const uint64_t roll = SplitMix64(random++);
+					reactions.push_back((uint16_t)std::min<uint64_t>(250 + roll % 500 + step * 25, MAX_REACTION_MILLISECONDS));
+
+					if ((roll >> 32) % (skill * 6) < step + 1)
+					{
+						failureStep = (int32_t)step;
+						break;
+					}
+				}
+
+				if (failureStep == NO_FAILURE)
+					playbackLength++;
+			}
+
+			const HistoryGame historyGame =
+			{
+				.seed = 7,
+				.gameNumber = game,
+				.playbackLength = playbackLength,
+				.failureStep = failureStep,
+				.buttonLitMicroseconds = 400'000,
+				.allButtonsOffMicroseconds = 100'000,
+				.gameStateChangedMicroseconds = 500'000,
+				.reactionMilliseconds = reactions.data(),
+				.presses = (uint32_t)reactions.size()
+			};
+
+			writer.Append(historyGame);
+			if (expected)
+				expected->Count(historyGame, game);
+		}
+
+		return writer.Close();
+	}
+
+	//a bot plays GameCore through the writer with known reaction times, every one has to come back from the file
+	[[nodiscard]]
+	bool CheckObserved(const char* path) noexcept
+	{
+		std::filesystem::remove(path);
+
+		const GameTimings timings = GameTimings::FromFrequency(FREQUENCY);
+		GameCore game(timings, 0, 1);
+		GameHistoryWriter writer;
+		if (!writer.Open(path, FREQUENCY))
+			return false;
+
+		std::vector<uint16_t> expectedReactions;
+		std::vector<int32_t> expectedFailures;
+		uint64_t random = 0;
+		int64_t now = 0;
+
+		game.StartGame(now);
+		writer.Observe(game);
+
+		while (game.finishedGames < BOT_GAMES)
+		{
+			now = game.NextDeadline() == NO_DEADLINE ? now : std::max(now, game.NextDeadline());
+			game.Tick(now, {});
+
+			if (game.gameState != GAME_STATE_INPUT || game.bOutstandingTimer)
+				continue;
+
+			const uint64_t roll = SplitMix64(random++);
+			const int64_t reactionMilliseconds = 100 + (int64_t)(roll % 900);
+			now += reactionMilliseconds * FREQUENCY / 1'000;
+
+			//one press in fifty is wrong, one game in a hundred is left for the menu instead
+			if (roll >> 40 & 1 && (roll >> 41) % 100 == 0)
+			{
+				game.ReturnToMenu(now);
+				expectedFailures.push_back(NO_FAILURE);
+				writer.Observe(game);
+				game.StartGame(now);
+				continue;
+			}
+
+			const int right = game.ButtonAt(game.playbackLocation);
+			const bool bWrong = (roll >> 48) % 50 == 0;
+			const int step = game.playbackLocation;
+
+			expectedReactions.push_back((uint16_t)reactionMilliseconds);
+			game.Tick(now, { .hoveredButton = bWrong ? (right + 1) % BUTTON_COUNT : right, .clicked = true });
+			if (bWrong)
+				expectedFailures.push_back(step);
+			writer.Observe(game);
+		}
+
+		//what a crash right now would leave, every game but those of one short segment is already in the file
+		{
+			GameHistoryReader crashed;
+			if (!crashed.Open(path) || crashed.Games() + GameHistoryWriter::LIVE_SEGMENT_GAMES < BOT_GAMES)
+				return false;
+		}
+
+		//the game in progress is not written, the presses expected past the last finished game are never looked at
+		if (!writer.Close())
+			return false;
+
+		GameHistoryReader reader;
+		if (!reader.Open(path) || reader.Games() != BOT_GAMES)
+			return false;
+
+		uint64_t press = 0;
+		uint64_t index = 0;
+		for (const HistorySegment& segment : reader.Segments())
+		{
+			for (uint32_t i = 0; i < segment.header->games; i++, index++)
+			{
+				if (segment.failureStep[i] != expectedFailures[index] || segment.gameNumber[i] != index)
+					return false;
+			}
+
+			for (uint64_t i = 0; i < segment.header->presses; i++, press++)
+			{
+				if (segment.reactionMilliseconds[i] != expectedReactions[press])
+					return false;
+			}
+
+			if (segment.header->buttonLitMicroseconds != 400'000 || segment.header->gameStateChangedMicroseconds != 500'000)
+				return false;
+		}
+
+		std::filesystem::remove(path);
+		return true;
+	}
+
+	void PrintReport(const GameHistoryReader& reader, WorkStealingPool& pool, uint32_t leaderboardSize) noexcept
+	{
+		const Histogram scores = reader.ScoreHistogram(pool);
+		const Histogram reactions = reader.ReactionHistogram(pool);
+		const std::vector<PositionErrors> positions = reader.PositionErrorRates(pool);
+		const std::vector<LeaderboardEntry> leaderboard = reader.TopScores(pool, leaderboardSize);
+
+		printf("games,%llu\npresses,%llu\nsegments,%zu\n\n", (unsigned long long)reader.Games(), (unsigned long long)reader.Presses(), reader.Segments().size());
+
+		printf("percentile,score,reaction_ms\n");
+		for (const double percentile : PERCENTILES)
+			printf("%g,%u,%u\n", percentile * 100, scores.Percentile(percentile), reactions.Percentile(percentile));
+
+		printf("\nstep,presses,errors,error_rate\n");
+		for (size_t step = 0; step < std::min(positions.size(), PRINTED_STEPS); step++)
+			printf("%zu,%llu,%llu,%.5f\n", step, (unsigned long long)positions[step].presses, (unsigned long long)positions[step].errors, positions[step].presses ? (double)positions[step].errors / positions[step].presses : 0);
+
+		printf("\nrank,score,seed,game_number,index\n");
+		for (size_t rank = 0; rank < leaderboard.size(); rank++)
+			printf("%zu,%u,%llu,%llu,%llu\n", rank + 1, leaderboard[rank].score, (unsigned long long)leaderboard[rank].seed, (unsigned long long)leaderboard[rank].gameNumber, (unsigned long long)leaderboard[rank].index);
+	}
+
+	template<typename Query>
+	[[nodiscard]]
+	double QuerySeconds(Query query) noexcept
+	{
+		const auto start = std::chrono::steady_clock::now();
+		query();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	[[nodiscard]]
+	bool Benchmark(uint64_t gameCount) noexcept
+	{
+		const std::string path = (std::filesystem::temp_directory_path() / ("simon_history_" + std::to_string(gameCount) + ".dat")).string();
+
+		if (!CheckObserved(path.c_str()))
+		{
+			fprintf(stderr, "games played through GameCore did not come back from the file as they were played\n");
+			return false;
+		}
+		printf("%i games played through GameCore came back with every reaction time and failure step\n\n", BOT_GAMES);
+
+		std::filesystem::remove(path);
+		Expected expected;
+
+		const auto writeStart = std::chrono::steady_clock::now();
+		if (!Generate(path.c_str(), gameCount, &expected))
+			return false;
+		const double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - writeStart).count();
+		const uint64_t fileBytes = std::filesystem::file_size(path);
+
+		printf("games,presses,file_mib,write_s\n%llu,%llu,%.0f,%.2f\n\n", (unsigned long long)expected.games, (unsigned long long)expected.presses, fileBytes / (double)(1 << 20), writeSeconds);
+		printf("threads,open_ms,scores_ms,reactions_ms,positions_ms,leaderboard_ms,games_per_s,reaction_gb_per_s\n");
+
+		const uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		bool bPassed = true;
+
+		for (uint32_t threadCount = 1; threadCount <= maxThreads && bPassed; threadCount *= 2)
+		{
+			WorkStealingPool pool(threadCount);
+			GameHistoryReader reader;
+
+			const double openSeconds = QuerySeconds([&] { bPassed &= reader.Open(path.c_str()); });
+			if (!bPassed || reader.Games() != expected.games || reader.Presses() != expected.presses)
+			{
+				fprintf(stderr, "the file holds %llu games, %llu were written\n", (unsigned long long)reader.Games(), (unsigned long long)expected.games);
+				return false;
+			}
+
+			Histogram scores;
+			Histogram reactions;
+			std::vector<PositionErrors> positions;
+			std::vector<LeaderboardEntry> leaderboard;
+
+			const double scoreSeconds = QuerySeconds([&] { scores = reader.ScoreHistogram(pool); });
+			const double reactionSeconds = QuerySeconds([&] { reactions = reader.ReactionHistogram(pool); });
+			const double positionSeconds = QuerySeconds([&] { positions = reader.PositionErrorRates(pool); });
+			const double leaderboardSeconds = QuerySeconds([&] { leaderboard = reader.TopScores(pool, expected.leaderboardSize); });
+
+			reactions.counts.resize(expected.reactions.size());
+			positions.resize(expected.positions.size());
+
+			const bool bLeaderboardMatches = std::equal(leaderboard.begin(), leaderboard.end(), expected.leaderboard.begin(), expected.leaderboard.end(), [](const LeaderboardEntry& a, const LeaderboardEntry& b)
+				{
+					return a.score == b.score && a.index == b.index && a.gameNumber == b.gameNumber;
+				});
+			const bool bPositionsMatch = std::equal(positions.begin(), positions.end(), expected.positions.begin(), [](const PositionErrors& a, const PositionErrors& b)
+				{
+					return a.presses == b.presses && a.errors == b.errors;
+				});
+
+			if (scores.counts != expected.scores || reactions.counts != expected.reactions || !bPositionsMatch || !bLeaderboardMatches)
+			{
+				fprintf(stderr, "on %u threads: scores %s, reactions %s, positions %s, leaderboard %s\n", threadCount,
+					scores.counts == expected.scores ? "ok" : "WRONG",
+					reactions.counts == expected.reactions ? "ok" : "WRONG",
+					bPositionsMatch ? "ok" : "WRONG",
+					bLeaderboardMatches ? "ok" : "WRONG");
+				return false;
+			}
+
+			printf("%u,%.2f,%.1f,%.1f,%.1f,%.1f,%.0f,%.2f\n",
+				threadCount,
+				openSeconds * 1e3,
+				scoreSeconds * 1e3,
+				reactionSeconds * 1e3,
+				positionSeconds * 1e3,
+				leaderboardSeconds * 1e3,
+				expected.games / scoreSeconds,
+				expected.presses * sizeof(uint16_t) / reactionSeconds / 1e9);
+
+			if (threadCount == maxThreads)
+			{
+				printf("\n");
+				PrintReport(reader, pool, expected.leaderboardSize);
+			}
+		}
+
+		//a segment cut short by a crash is dropped by the next writer and never seen by a reader
+		{
+			std::filesystem::resize_file(path, fileBytes - 100);
+
+			GameHistoryReader torn;
+			bPassed &= torn.Open(path.c_str()) && torn.Games() < expected.games;
+			const uint64_t intactGames = torn.Games();
+			torn.Close();
+
+			GameHistoryWriter writer;
+			bPassed &= writer.Open(path.c_str(), FREQUENCY) && writer.Close();
+
+			GameHistoryReader reopened;
+			bPassed &= reopened.Open(path.c_str()) && reopened.Games() == intactGames;
+			printf("\ntorn_segment,%s,%llu\n", bPassed ? "ok" : "FAILED", (unsigned long long)intactGames);
+		}
+
+		std::filesystem::remove(path);
+		return bPassed;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 2 && strcmp(argv[1], "--generate") == 0)
+	{
+		const uint64_t millions = argc > 3 ? strtoull(argv[3], nullptr, 10) : DEFAULT_MILLIONS;
+		return Generate(argv[2], millions * 1'000'000, nullptr) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+	{
+		const uint64_t millions = argc > 2 ? strtoull(argv[2], nullptr, 10) : DEFAULT_MILLIONS;
+		return Benchmark(millions * 1'000'000) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (argc > 1)
+	{
+		GameHistoryReader reader;
+		if (!reader.Open(argv[1]))
+		{
+			fprintf(stderr, "%s is not a history file\n", argv[1]);
+			return EXIT_FAILURE;
+		}
+
+		WorkStealingPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+		PrintReport(reader, pool, argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : DEFAULT_LEADERBOARD);
+		return EXIT_SUCCESS;
+	}
+
+	return Benchmark(DEFAULT_MILLIONS * 1'000'000) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
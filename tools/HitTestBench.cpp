@@ -0,0 +1,163 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//compares the analytic button hit test against a flattened-path reference,
+//both for speed and for how often the two disagree, on every board from 3 to 8 panels
+//fails if a batch disagrees with the scalar test, or a board disagrees with its reference by more than a little,
+//or RIM_BULGES no longer matches what MatchRimBulge() works out
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BoardGeometry.h"
+
+//the four panel board disagrees on about 0.7% of the square around it, where the rim beziers leave the circle,
+//the three panel one on about 1.6%, its rims span so much more of the circle that they dip further inside it
+constexpr double MAX_DISAGREEMENT_PERCENT = 2;
+
+//how far a rim in RIM_BULGES may peak from the four panel one, relative, about a float's precision
+constexpr double MAX_RIM_PEAK_ERROR = 1e-6;
+
+//every panel count's rims from RIM_BULGES against the four panel ones, false if any peaks elsewhere
+[[nodiscard]]
+bool CheckRimBulges() noexcept
+{
+	bool bPassed = true;
+	for (size_t i = 0; i < std::size(RIM_BULGES); i++)
+	{
+		const double wedgeDegrees = 360.0 / (RIM_BULGES_FIRST_PANEL_COUNT + (int)i);
+
+		struct Rim
+		{
+			const char* name;
+			double margin;
+			float bulge;
+			float referenceBulge;
+		};
+
+		for (const Rim& rim : {
+			Rim{ .name = "outer", .margin = OUTER_SLICE_MARGIN + OUTER_CIRCLE_BEVEL, .bulge = RIM_BULGES[i].full, .referenceBulge = 1.3f },
+			Rim{ .name = "inner", .margin = INNER_SLICE_MARGIN + INNER_CIRCLE_BEVEL, .bulge = RIM_BULGES[i].inner, .referenceBulge = 1.2f } })
+		{
+			const double target = RimPeak(rim.margin, 90 - rim.margin, rim.referenceBulge);
+			const double peak = RimPeak(rim.margin, wedgeDegrees - rim.margin, rim.bulge);
+			if (std::abs(peak - target) > target * MAX_RIM_PEAK_ERROR)
+			{
+				fprintf(stderr, "%i panels: the %s rim bulge in RIM_BULGES is %.9g, MatchRimBulge() gives %.9g\n",
+					RIM_BULGES_FIRST_PANEL_COUNT + (int)i,
+					rim.name,
+					rim.bulge,
+					MatchRimBulge(rim.margin, wedgeDegrees - rim.margin, rim.margin, 90 - rim.margin, rim.referenceBulge));
+				bPassed = false;
+			}
+		}
+	}
+	return bPassed;
+}
+
+template <typename Function>
+[[nodiscard]]
+double NanosecondsPerPoint(size_t pointCount, Function function) noexcept
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / pointCount;
+}
+
+//prints one row, false if the board fails
+template <int PanelCount>
+[[nodiscard]]
+bool RunBoard(const BoardLayout& layout, const std::vector<float>& x, const std::vector<float>& y) noexcept
+{
+	using Panels = Board<PanelCount>;
+
+	const size_t pointCount = x.size();
+
+	std::vector<std::vector<Point2>> polygons;
+	for (int i = 0; i < PanelCount; i++)
+		polygons.push_back(FlattenWedgeOutline(Panels::BuildWedgeOutline(layout, i), 32));
+
+	std::vector<uint8_t> reference(pointCount);
+	std::vector<uint8_t> scalar(pointCount);
+	std::vector<uint8_t> batch(pointCount);
+
+	const double referenceNs = NanosecondsPerPoint(pointCount, [&]
+		{
+			for (size_t i = 0; i < pointCount; i++)
+			{
+				reference[i] = NO_BUTTON;
+				for (int panel = 0; panel < PanelCount; panel++)
+				{
+					if (PolygonContainsPoint(polygons[panel], x[i], y[i]))
+					{
+						reference[i] = (uint8_t)panel;
+						break;
+					}
+				}
+			}
+		});
+
+	const double scalarNs = NanosecondsPerPoint(pointCount, [&]
+		{
+			for (size_t i = 0; i < pointCount; i++)
+				scalar[i] = (uint8_t)Panels::HitTest(layout, x[i], y[i]);
+		});
+
+	const double batchNs = NanosecondsPerPoint(pointCount, [&]
+		{
+			Panels::HitTestBatch(layout, x.data(), y.data(), batch.data(), pointCount);
+		});
+
+	size_t referenceMismatches = 0;
+	size_t batchMismatches = 0;
+	for (size_t i = 0; i < pointCount; i++)
+	{
+		referenceMismatches += scalar[i] != reference[i];
+		batchMismatches += batch[i] != scalar[i];
+	}
+
+	const double disagreement = referenceMismatches * 100.0 / pointCount;
+
+	printf("%i,%.3f,%.3f,%.3f,%.2f,%.2f,%.4f%%\n", PanelCount, referenceNs, scalarNs, batchNs, referenceNs / scalarNs, referenceNs / batchNs, disagreement);
+
+	//the batch path must classify exactly like the scalar one
+	return batchMismatches == 0 && disagreement <= MAX_DISAGREEMENT_PERCENT;
+}
+
+int main(int argc, char** argv)
+{
+	const size_t pointCount = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1'000'000;
+
+	const BoardLayout layout = BoardLayout::FromClientSize(576, 576);
+
+	std::vector<float> x(pointCount);
+	std::vector<float> y(pointCount);
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> distribution(-layout.fullRadius * 1.05f, layout.fullRadius * 1.05f);
+	for (size_t i = 0; i < pointCount; i++)
+	{
+		x[i] = layout.centerX + distribution(rng);
+		y[i] = layout.centerY + distribution(rng);
+	}
+
+	printf("panels,reference_ns_per_point,scalar_ns_per_point,batch_ns_per_point,scalar_speedup,batch_speedup,disagreement_vs_reference\n");
+
+	const bool bPassed = CheckRimBulges()
+		& RunBoard<3>(layout, x, y)
+		& RunBoard<4>(layout, x, y)
+		& RunBoard<5>(layout, x, y)
+		& RunBoard<6>(layout, x, y)
+		& RunBoard<7>(layout, x, y)
+		& RunBoard<8>(layout, x, y);
+
+	return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
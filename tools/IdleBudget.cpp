@@ -0,0 +1,87 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//drives the game core through the idle menu and a playback phase on the epoll event loop
+//and checks the process cpu time against a budget, exits non-zero when over budget
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <utility>
+
+#include "SimonCore.h"
+#include "EventLoop.h"
+
+struct PhaseResult
+{
+	double wallMs;
+	double cpuMs;
+	uint64_t wakeups;
+};
+
+template <typename Setup>
+[[nodiscard]]
+PhaseResult RunPhase(GameCore& game, SteadyClock& clock, int64_t duration, Setup setup) noexcept
+{
+	EpollEventLoop eventLoop;
+
+	const int64_t start = clock.Now();
+	const int64_t end = start + duration;
+	const std::clock_t cpuStart = std::clock();
+
+	setup(game, start);
+
+	int64_t now = start;
+	while (now < end)
+	{
+		const int64_t deadline = game.NextDeadline();
+		(void)eventLoop.WaitUntil(deadline < end ? deadline : end);
+
+		now = clock.Now();
+		game.Tick(now, {});
+	}
+
+	return
+	{
+		.wallMs = (clock.Now() - start) / 1e6,
+		.cpuMs = (std::clock() - cpuStart) * 1000.0 / CLOCKS_PER_SEC,
+		.wakeups = eventLoop.WakeupCount()
+	};
+}
+
+int main(int argc, char** argv)
+{
+	//percent of one core each phase may use
+	const double budgetPercent = argc > 1 ? atof(argv[1]) : 1.0;
+	const int64_t phaseDuration = (argc > 2 ? atoll(argv[2]) : 2000) * 1'000'000;
+
+	SteadyClock clock;
+	GameCore game(GameTimings::FromFrequency(clock.Frequency()), clock.Now(), 1);
+
+	const PhaseResult menu = RunPhase(game, clock, phaseDuration, [](GameCore&, int64_t) {});
+
+	const PhaseResult playback = RunPhase(game, clock, phaseDuration, [](GameCore& game, int64_t now)
+		{
+			//a sequence long enough to still be playing back when the phase ends
+			game.playbackLength = 255;
+			game.StartGame(now);
+		});
+
+	bool bWithinBudget = true;
+
+	printf("phase,wall_ms,cpu_ms,wakeups,cpu_percent,budget_percent\n");
+
+	for (const auto& [name, result] : { std::pair{ "menu", menu }, std::pair{ "playback", playback } })
+	{
+		const double cpuPercent = result.cpuMs * 100.0 / result.wallMs;
+		printf("%s,%.1f,%.3f,%llu,%.3f,%.3f\n", name, result.wallMs, result.cpuMs, (unsigned long long)result.wakeups, cpuPercent, budgetPercent);
+
+		if (cpuPercent > budgetPercent)
+			bWithinBudget = false;
+	}
+
+	return bWithinBudget ? EXIT_SUCCESS : EXIT_FAILURE;
+}
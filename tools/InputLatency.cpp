@@ -0,0 +1,205 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//pushes timestamped clicks from a producer thread through the input ring and checks that
+//every one arrives in order, then replays a whole round of clicks inside a single frame
+//to make sure none of them collapse into one, a miss followed by escape in one drain to make
+//sure the stats journal gets both games they end, and a game still running when the logic thread
+//stops to make sure it is journaled too
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "BoardGeometry.h"
+#include "InputQueue.h"
+#include "LogicThread.h"
+#include "StatsStore.h"
+
+namespace
+{
+	//somewhere well inside each button, found through the hit test itself
+	[[nodiscard]]
+	std::vector<Point2> ButtonCenters(const BoardLayout& layout) noexcept
+	{
+		std::vector<Point2> sums(BUTTON_COUNT, Point2{ 0, 0 });
+		std::vector<int> counts(BUTTON_COUNT, 0);
+
+		const float radius = (layout.fullRadius + layout.innerCircleRadius) * .5f;
+
+		for (int degree = 0; degree < 360; degree++)
+		{
+			const float angle = degree * 3.14159265f / 180;
+			const float x = layout.centerX + radius * std::cos(angle);
+			const float y = layout.centerY + radius * std::sin(angle);
+
+			const int button = HitTestButton(layout, x, y);
+			if (button == NO_BUTTON)
+				continue;
+
+			sums[button].x += x - layout.centerX;
+			sums[button].y += y - layout.centerY;
+			counts[button]++;
+		}
+
+		std::vector<Point2> centers(BUTTON_COUNT);
+		for (int i = 0; i < BUTTON_COUNT; i++)
+		{
+			const float length = std::hypot(sums[i].x, sums[i].y);
+			centers[i] = { layout.centerX + sums[i].x / length * radius, layout.centerY + sums[i].y / length * radius };
+		}
+		return centers;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint64_t eventCount = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1'000'000;
+
+	SteadyClock clock;
+	bool bPassed = true;
+
+	//threaded stress, the consumer checks order and measures queue latency
+	{
+		InputQueue queue;
+
+		std::thread producer([&]
+			{
+				SteadyClock producerClock;
+				for (uint64_t i = 0; i < eventCount; i++)
+				{
+					const InputEvent event =
+					{
+						.type = InputEventType::Click,
+						.x = (float)i,
+						.y = 0,
+						.timestamp = producerClock.Now()
+					};
+
+					while (!queue.TryPush(event))
+						std::this_thread::yield();
+				}
+			});
+
+		std::vector<int64_t> latencies;
+		latencies.reserve(eventCount);
+
+		const int64_t start = clock.Now();
+		uint64_t received = 0;
+		int64_t lastTimestamp = 0;
+		InputEvent event;
+
+		while (received < eventCount)
+		{
+			if (!queue.TryPop(event))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			const int64_t now = clock.Now();
+
+			if ((uint64_t)event.x != received || event.timestamp < lastTimestamp)
+				bPassed = false;
+
+			lastTimestamp = event.timestamp;
+			latencies.push_back(now - event.timestamp);
+			received++;
+		}
+
+		const int64_t elapsed = clock.Now() - start;
+		producer.join();
+
+		std::sort(latencies.begin(), latencies.end());
+
+		printf("events,million_events_per_s,p50_ns,p99_ns,max_ns\n");
+		printf("%llu,%.2f,%lld,%lld,%lld\n",
+			(unsigned long long)received,
+			received * 1e3 / elapsed,
+			(long long)latencies[latencies.size() / 2],
+			(long long)latencies[latencies.size() * 99 / 100],
+			(long long)latencies.back());
+	}
+
+	//a fast player repeats a whole round between two frames
+	{
+		constexpr float size = 576;
+		constexpr int roundLength = 32;
+
+		const std::vector<Point2> centers = ButtonCenters(BoardLayout::FromClientSize(size, size));
+
+		GameCore game(GameTimings::FromFrequency(clock.Frequency()), 0, 1);
+		game.gameState = GAME_STATE_INPUT;
+		game.playbackLength = roundLength;
+
+		InputQueue queue;
+		for (int i = 0; i < roundLength; i++)
+		{
+			const Point2 center = centers[game.ButtonAt(i)];
+			(void)queue.TryPush({ .type = InputEventType::Click, .x = center.x, .y = center.y, .timestamp = i + 1 });
+		}
+
+		InputLatency latency;
+		DrainInput(game, queue, size, size, roundLength + 1, latency);
+
+		const bool bRoundCompleted = game.playbackLength == roundLength + 1 && game.gameState == GAME_STATE_PLAYBACK;
+
+		printf("round_clicks,judged,round_completed\n");
+		printf("%d,%llu,%s\n", roundLength, (unsigned long long)latency.events, bRoundCompleted ? "yes" : "no");
+
+		if (!bRoundCompleted || latency.events != roundLength)
+			bPassed = false;
+	}
+
+	//two games end in one drain
+	{
+		constexpr float size = 576;
+		const std::vector<Point2> centers = ButtonCenters(BoardLayout::FromClientSize(size, size));
+
+		GameCore game(GameTimings::FromFrequency(clock.Frequency()), 0, 1);
+		game.gameState = GAME_STATE_INPUT;
+		game.playbackLength = 3;
+
+		InputQueue queue;
+		const Point2 wrong = centers[(game.ButtonAt(0) + 1) % BUTTON_COUNT];
+		(void)queue.TryPush({ .type = InputEventType::Click, .x = wrong.x, .y = wrong.y, .timestamp = 1 });
+		(void)queue.TryPush({ .type = InputEventType::Escape, .timestamp = 2 });
+
+		//in memory only, never opened
+		StatsStore statsStore;
+		InputLatency latency;
+		DrainInput(game, queue, size, size, 3, latency, nullptr, nullptr, &statsStore, clock.Frequency());
+
+		printf("\ngames_ended,games_journaled\n");
+		printf("%llu,%llu\n", (unsigned long long)game.finishedGames, (unsigned long long)statsStore.Summary().games);
+
+		if (game.finishedGames != 2 || statsStore.Summary().games != 2)
+			bPassed = false;
+	}
+
+	//the window closes in the middle of a game that beat the best score
+	{
+		GameCore game(GameTimings::FromFrequency(clock.Frequency()), clock.Now(), 1);
+		game.StartGame(clock.Now());
+		game.playbackLength = 6;
+		game.bestScore = 5;
+
+		StatsStore statsStore;
+		LogicThread logic(clock, game, nullptr, nullptr, nullptr, &statsStore);
+		logic.Stop();
+
+		printf("\ngames_at_stop,games_journaled,best_score_journaled\n");
+		printf("%llu,%llu,%i\n", (unsigned long long)logic.Game().finishedGames, (unsigned long long)statsStore.Summary().games, statsStore.Summary().bestScore);
+
+		if (logic.Game().gameState != GAME_STATE_MENU || statsStore.Summary().games != 1 || statsStore.Summary().bestScore != 5)
+			bPassed = false;
+	}
+
+	return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
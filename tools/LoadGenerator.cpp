@@ -0,0 +1,317 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//forks a game server on a unix socket and plays it from thousands of loopback connections at once,
+//every client repeats the sequence it was shown, then reports how many sessions one server core
+//carries and the press to verdict latency, one more client keeps pressing without ever reading and has
+//to be dropped by the server instead of having its verdicts queued without end
+//arguments: sessions (default 10000), seconds (default 5), button lit milliseconds (default 20)
+
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "FrameProfiler.h"
+#include "GameServer.h"
+
+namespace
+{
+	//clients go back to the menu after this many rounds, so playback does not grow without end
+	constexpr uint32_t ROUNDS_PER_GAME = 16;
+
+	GameServer* childServer = nullptr;
+
+	void StopOnSignal(int) noexcept
+	{
+		if (childServer != nullptr)
+			childServer->Stop();
+	}
+
+	struct Client
+	{
+		int fd = -1;
+		std::vector<uint8_t> sequence;
+		uint32_t nextPress = 0;
+		uint32_t readLength = 0;
+		uint8_t readBuffer[sizeof(WireMessage)];
+	};
+
+	struct LoadStats
+	{
+		uint64_t presses = 0;
+		uint64_t rounds = 0;
+		uint64_t errors = 0;
+		LatencyHistogram latency;
+	};
+
+	void SendMessage(Client& client, const WireMessage& message) noexcept
+	{
+		//16 bytes into an otherwise idle socket, a short write would mean the server stopped reading
+		const ssize_t sent = send(client.fd, &message, sizeof(message), MSG_NOSIGNAL);
+		if (sent != (ssize_t)sizeof(message))
+			FATAL_ON_ERRNO_IMPL("send", __LINE__);
+	}
+
+	void Press(Client& client, SteadyClock& clock, LoadStats& stats) noexcept
+	{
+		SendMessage(client, { .type = MessageType::Press, .button = client.sequence[client.nextPress], .tag = (uint64_t)clock.Now() });
+		stats.presses++;
+	}
+
+	void HandleMessage(Client& client, const WireMessage& message, SteadyClock& clock, LoadStats& stats) noexcept
+	{
+		switch (message.type)
+		{
+		case MessageType::Lit:
+			if (message.button != NO_BUTTON)
+				client.sequence.push_back(message.button);
+			break;
+		case MessageType::InputPhase:
+			if (client.sequence.size() != message.value)
+			{
+				stats.errors++;
+				client.sequence.clear();
+				SendMessage(client, { .type = MessageType::Menu });
+				SendMessage(client, { .type = MessageType::Start });
+				break;
+			}
+			client.nextPress = 0;
+			Press(client, clock, stats);
+			break;
+		case MessageType::Verdict:
+			stats.latency.Record((uint64_t)(clock.Now() - (int64_t)message.tag));
+
+			switch (message.verdict)
+			{
+			case Verdict::Correct:
+				client.nextPress++;
+				Press(client, clock, stats);
+				break;
+			case Verdict::RoundComplete:
+				stats.rounds++;
+				client.sequence.clear();
+				if (message.value >= ROUNDS_PER_GAME)
+				{
+					SendMessage(client, { .type = MessageType::Menu });
+					SendMessage(client, { .type = MessageType::Start });
+				}
+				break;
+			default:
+				stats.errors++;
+				client.sequence.clear();
+				break;
+			}
+			break;
+		default:
+			stats.errors++;
+			break;
+		}
+	}
+
+	[[nodiscard]]
+	int Connect(const char* path) noexcept
+	{
+		const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		FATAL_ON_NEGATIVE(fd);
+
+		sockaddr_un address = { .sun_family = AF_UNIX };
+		strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+		//blocking, so a full backlog just waits for the server to accept
+		FATAL_ON_NEGATIVE(connect(fd, (const sockaddr*)&address, sizeof(address)));
+		FATAL_ON_NEGATIVE(fcntl(fd, F_SETFL, O_NONBLOCK));
+		return fd;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t sessionCount = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 10'000;
+	const double seconds = argc > 2 ? atof(argv[2]) : 5;
+	const double litMilliseconds = argc > 3 ? atof(argv[3]) : 20;
+
+	//every client needs a descriptor here and one in the server
+	rlimit fileLimit;
+	FATAL_ON_NEGATIVE(getrlimit(RLIMIT_NOFILE, &fileLimit));
+	fileLimit.rlim_cur = fileLimit.rlim_max;
+	FATAL_ON_NEGATIVE(setrlimit(RLIMIT_NOFILE, &fileLimit));
+
+	if (sessionCount + 64 > fileLimit.rlim_cur)
+	{
+		fprintf(stderr, "%u sessions need a descriptor limit above %llu\n", sessionCount, (unsigned long long)fileLimit.rlim_cur);
+		return EXIT_FAILURE;
+	}
+
+	SteadyClock clock;
+	const int64_t frequency = clock.Frequency();
+
+	const GameTimings timings =
+	{
+		.ButtonLitTicks = (int64_t)(litMilliseconds * frequency / 1000),
+		.AllButtonsOffTicks = (int64_t)(litMilliseconds * frequency / 4000),
+		.GameStateChangedTicks = (int64_t)(litMilliseconds * frequency / 1000)
+	};
+
+	const std::string socketPath = "/tmp/simon_load_" + std::to_string(getpid()) + ".sock";
+
+	const int64_t launch = clock.Now();
+
+	int readyPipe[2];
+	FATAL_ON_NEGATIVE(pipe(readyPipe));
+
+	//the server gets its own process, so it has its own descriptor table and its cpu time can be read on its own
+	const pid_t serverPid = fork();
+	FATAL_ON_NEGATIVE(serverPid);
+
+	if (serverPid == 0)
+	{
+		GameServer server(timings, 1);
+		server.ListenUnix(socketPath.c_str());
+
+		childServer = &server;
+		signal(SIGTERM, StopOnSignal);
+
+		const char ready = 1;
+		FATAL_ON_NEGATIVE(write(readyPipe[1], &ready, 1));
+
+		server.Run();
+		unlink(socketPath.c_str());
+		_exit(EXIT_SUCCESS);
+	}
+
+	char ready;
+	FATAL_ON_NEGATIVE(read(readyPipe[0], &ready, 1));
+
+	const int epollFd = epoll_create1(EPOLL_CLOEXEC);
+	FATAL_ON_NEGATIVE(epollFd);
+
+	std::vector<Client> clients(sessionCount);
+	LoadStats stats;
+
+	for (uint32_t i = 0; i < sessionCount; i++)
+	{
+		clients[i].fd = Connect(socketPath.c_str());
+
+		epoll_event event =
+		{
+			.events = EPOLLIN,
+			.data = {.u32 = i }
+		};
+		FATAL_ON_NEGATIVE(epoll_ctl(epollFd, EPOLL_CTL_ADD, clients[i].fd, &event));
+
+		SendMessage(clients[i], { .type = MessageType::Start });
+	}
+
+	const int stalledFd = Connect(socketPath.c_str());
+	bool bStalledDropped = false;
+
+	const int64_t start = clock.Now();
+	const int64_t end = start + (int64_t)(seconds * frequency);
+
+	epoll_event events[256];
+
+	while (clock.Now() < end)
+	{
+		//presses outside the input phase still get a verdict each
+		for (int i = 0; i < 64 && !bStalledDropped; i++)
+		{
+			const WireMessage press = { .type = MessageType::Press, .button = 0 };
+			if (send(stalledFd, &press, sizeof(press), MSG_NOSIGNAL) >= 0)
+				continue;
+
+			if (errno == EPIPE || errno == ECONNRESET)
+				bStalledDropped = true;
+			else if (errno != EAGAIN && errno != EWOULDBLOCK)
+				FATAL_ON_ERRNO_IMPL("send", __LINE__);
+			break;
+		}
+
+		const int eventCount = epoll_wait(epollFd, events, 256, 10);
+		if (eventCount < 0 && errno == EINTR)
+			continue;
+		FATAL_ON_NEGATIVE(eventCount);
+
+		for (int i = 0; i < eventCount; i++)
+		{
+			Client& client = clients[events[i].data.u32];
+
+			uint8_t buffer[64 * sizeof(WireMessage)];
+			const ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+			if (received <= 0)
+			{
+				if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+				{
+					fprintf(stderr, "the server closed a session\n");
+					return EXIT_FAILURE;
+				}
+				continue;
+			}
+
+			for (ssize_t offset = 0; offset < received;)
+			{
+				const size_t copied = std::min((size_t)(received - offset), sizeof(WireMessage) - client.readLength);
+				memcpy(client.readBuffer + client.readLength, buffer + offset, copied);
+				client.readLength += (uint32_t)copied;
+				offset += copied;
+
+				if (client.readLength == sizeof(WireMessage))
+				{
+					WireMessage message;
+					memcpy(&message, client.readBuffer, sizeof(message));
+					client.readLength = 0;
+					HandleMessage(client, message, clock, stats);
+				}
+			}
+		}
+	}
+
+	const double wallSeconds = (double)(clock.Now() - start) / frequency;
+
+	FATAL_ON_NEGATIVE(kill(serverPid, SIGTERM));
+
+	int status;
+	rusage serverUsage;
+	FATAL_ON_NEGATIVE(wait4(serverPid, &status, 0, &serverUsage));
+
+	for (const Client& client : clients)
+		close(client.fd);
+	close(stalledFd);
+	close(epollFd);
+
+	//the server's cpu time includes accepting every connection, so it is spread over its whole lifetime
+	const double serverCpuSeconds =
+		serverUsage.ru_utime.tv_sec + serverUsage.ru_utime.tv_usec / 1e6 +
+		serverUsage.ru_stime.tv_sec + serverUsage.ru_stime.tv_usec / 1e6;
+	const double serverCores = serverCpuSeconds / ((double)(clock.Now() - launch) / frequency);
+
+	printf("sessions,seconds,presses_per_s,rounds,errors,server_cpu_s,sessions_per_core,p50_us,p99_us,max_us,stalled_dropped\n");
+	printf("%u,%.2f,%.0f,%llu,%llu,%.3f,%.0f,%.1f,%.1f,%.1f,%s\n",
+		sessionCount,
+		wallSeconds,
+		stats.presses / wallSeconds,
+		(unsigned long long)stats.rounds,
+		(unsigned long long)stats.errors,
+		serverCpuSeconds,
+		sessionCount / std::max(serverCores, 1e-9),
+		stats.latency.Percentile(.5) / 1e3,
+		stats.latency.Percentile(.99) / 1e3,
+		stats.latency.Max() / 1e3,
+		bStalledDropped ? "yes" : "no");
+
+	return stats.errors == 0 && bStalledDropped && WIFEXITED(status) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
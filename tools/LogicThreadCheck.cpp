@@ -0,0 +1,236 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//checks the handoff between the logic thread and the renderer
+//first a writer and a reader hammer a triple buffer and every value read is checked for tearing,
+//then the game runs on a LogicThread under renderers of different speeds, its tick rate must not follow
+//theirs, a game ticked from the frame loop the way it used to be is run next to it for comparison
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "CounterRng.h"
+#include "LogicThread.h"
+#include "SimonCore.h"
+#include "TripleBuffer.h"
+
+namespace
+{
+	constexpr uint64_t STRESS_VALUES = 2'000'000;
+	constexpr int64_t RUN_NANOSECONDS = 1'000'000'000;
+	constexpr int FRAME_MILLISECONDS[] = { 0, 16, 50 };
+	//threaded tick rates may differ by this much, scheduling noise on a loaded machine
+	constexpr double MAX_RATE_SPREAD = .15;
+
+	struct StressValue
+	{
+		uint64_t sequence;
+		uint64_t words[31];
+	};
+
+	struct StressResult
+	{
+		uint64_t reads;
+		uint64_t fresh;
+		uint64_t torn;
+		uint64_t backwards;
+	};
+
+	[[nodiscard]]
+	StressResult StressTripleBuffer() noexcept
+	{
+		TripleBuffer<StressValue> buffer;
+		std::atomic<bool> bWriterDone = false;
+
+		std::thread writer([&]
+			{
+				for (uint64_t sequence = 1; sequence <= STRESS_VALUES; sequence++)
+				{
+					StressValue& value = buffer.WriteSlot();
+					value.sequence = sequence;
+					for (int i = 0; i < 31; i++)
+						value.words[i] = SplitMix64(sequence * 31 + i);
+					buffer.Publish();
+
+					if (sequence % 16 == 0)
+						std::this_thread::yield();
+				}
+				bWriterDone.store(true, std::memory_order_release);
+			});
+
+		StressResult result = {};
+		uint64_t lastSequence = 0;
+
+		while (true)
+		{
+			const bool bDone = bWriterDone.load(std::memory_order_acquire);
+			const bool bFresh = buffer.Update();
+			const StressValue& value = buffer.Read();
+
+			result.reads++;
+			result.fresh += bFresh;
+			result.backwards += value.sequence < lastSequence;
+			lastSequence = value.sequence;
+
+			for (int i = 0; i < 31; i++)
+			{
+				if (value.sequence != 0 && value.words[i] != SplitMix64(value.sequence * 31 + i))
+				{
+					result.torn++;
+					break;
+				}
+			}
+
+			if (bDone && !bFresh)
+				break;
+
+			if (!bFresh)
+				std::this_thread::yield();
+		}
+
+		writer.join();
+
+		//the last value published has to come through
+		result.backwards += lastSequence != STRESS_VALUES;
+		return result;
+	}
+
+	struct RenderResult
+	{
+		uint64_t frames;
+		uint64_t snapshotsSeen;
+		uint64_t inconsistent;
+		double ticksPerSecond;
+	};
+
+	[[nodiscard]]
+	GameCore EndlessPlayback(SteadyClock& clock) noexcept
+	{
+		//short enough to tick hundreds of times a second, long enough that the playback never ends
+		const GameTimings timings =
+		{
+			.ButtonLitTicks = 2'000'000,
+			.AllButtonsOffTicks = 1'000'000,
+			.GameStateChangedTicks = 1'000'000
+		};
+
+		GameCore game(timings, clock.Now(), 1);
+		game.playbackLength = 1'000'000;
+		game.StartGame(clock.Now());
+		return game;
+	}
+
+	//stands in for drawing and presenting a frame of the given length
+	void RenderFrame(int frameMilliseconds) noexcept
+	{
+		if (frameMilliseconds == 0)
+			std::this_thread::yield();
+		else
+			std::this_thread::sleep_for(std::chrono::milliseconds(frameMilliseconds));
+	}
+
+	[[nodiscard]]
+	RenderResult RunThreaded(int frameMilliseconds) noexcept
+	{
+		SteadyClock clock;
+		LogicThread logic(clock, EndlessPlayback(clock), nullptr, nullptr);
+
+		RenderResult result = {};
+		uint64_t lastSequence = 0;
+
+		const int64_t start = clock.Now();
+		while (clock.Now() - start < RUN_NANOSECONDS)
+		{
+			const GameSnapshot& snapshot = logic.LatestSnapshot();
+
+			result.frames++;
+			result.snapshotsSeen += snapshot.sequence != lastSequence;
+			result.inconsistent += snapshot.sequence < lastSequence || snapshot.gameState != GAME_STATE_PLAYBACK || snapshot.litButton > NO_BUTTON || snapshot.litButton < 0;
+			lastSequence = snapshot.sequence;
+
+			RenderFrame(frameMilliseconds);
+		}
+
+		const int64_t elapsed = clock.Now() - start;
+		logic.Stop();
+
+		result.ticksPerSecond = logic.Stats().ticks * 1e9 / elapsed;
+		return result;
+	}
+
+	//the old arrangement, the game only advanced when a frame was drawn
+	[[nodiscard]]
+	RenderResult RunInFrameLoop(int frameMilliseconds) noexcept
+	{
+		SteadyClock clock;
+		GameCore game = EndlessPlayback(clock);
+
+		RenderResult result = {};
+		uint64_t ticks = 0;
+
+		const int64_t start = clock.Now();
+		while (clock.Now() - start < RUN_NANOSECONDS)
+		{
+			const int64_t now = clock.Now();
+			while (game.NextDeadline() <= now)
+			{
+				game.Tick(now, {});
+				ticks++;
+			}
+
+			result.frames++;
+			result.snapshotsSeen++;
+			RenderFrame(frameMilliseconds);
+		}
+
+		result.ticksPerSecond = ticks * 1e9 / (clock.Now() - start);
+		return result;
+	}
+}
+
+int main()
+{
+	bool bPassed = true;
+
+	const StressResult stress = StressTripleBuffer();
+	printf("triple_buffer_values,reads,fresh_reads,torn,out_of_order\n");
+	printf("%llu,%llu,%llu,%llu,%llu\n",
+		(unsigned long long)STRESS_VALUES,
+		(unsigned long long)stress.reads,
+		(unsigned long long)stress.fresh,
+		(unsigned long long)stress.torn,
+		(unsigned long long)stress.backwards);
+
+	bPassed &= stress.torn == 0 && stress.backwards == 0;
+
+	double minRate = 1e300;
+	double maxRate = 0;
+
+	printf("\nmodel,frame_ms,frames,snapshots_seen,inconsistent,logic_ticks_per_s\n");
+	for (int frameMilliseconds : FRAME_MILLISECONDS)
+	{
+		const RenderResult threaded = RunThreaded(frameMilliseconds);
+		printf("logic_thread,%i,%llu,%llu,%llu,%.1f\n", frameMilliseconds,
+			(unsigned long long)threaded.frames, (unsigned long long)threaded.snapshotsSeen, (unsigned long long)threaded.inconsistent, threaded.ticksPerSecond);
+
+		const RenderResult coupled = RunInFrameLoop(frameMilliseconds);
+		printf("frame_loop,%i,%llu,%llu,%llu,%.1f\n", frameMilliseconds,
+			(unsigned long long)coupled.frames, (unsigned long long)coupled.snapshotsSeen, (unsigned long long)coupled.inconsistent, coupled.ticksPerSecond);
+
+		bPassed &= threaded.inconsistent == 0;
+		minRate = std::min(minRate, threaded.ticksPerSecond);
+		maxRate = std::max(maxRate, threaded.ticksPerSecond);
+	}
+
+	const double spread = (maxRate - minRate) / maxRate;
+	printf("\nlogic_tick_rate_spread,%.3f\n", spread);
+	bPassed &= spread <= MAX_RATE_SPREAD;
+
+	return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
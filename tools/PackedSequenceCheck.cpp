@@ -0,0 +1,194 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//checks PackedSequence against a plain byte per step vector
+//random steps are written across many chunks in a scattered order, Reserve() is taken past the end,
+//a sequence is moved, and on linux a file backed one is reopened twice and must still hold every step
+//then one step per chunk is written to time how the chunk table grows
+//fails on the first step that reads back wrong
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include "CounterRng.h"
+#include "PackedSequence.h"
+
+namespace
+{
+	constexpr uint64_t MEMORY_CHUNK_STEPS = PackedSequence::MEMORY_CHUNK_BYTES * PackedSequence::STEPS_PER_BYTE;
+	constexpr uint64_t FILE_CHUNK_STEPS = PackedSequence::FILE_CHUNK_BYTES * PackedSequence::STEPS_PER_BYTE;
+	constexpr uint64_t GROWTH_CHUNKS = 1 << 16;
+
+	//writes steps [0, expected.size()) that are still 0 in expected in an order that jumps back and forth
+	//across chunks, so the sequence grows by several chunks at once and is written behind its end too
+	void WriteScattered(PackedSequence& sequence, std::vector<uint8_t>& expected, uint64_t from, uint64_t key) noexcept
+	{
+		const uint64_t count = expected.size() - from;
+		//odd, so stepping by it visits every index of a power of two sized range exactly once
+		const uint64_t stride = 2 * (count / 3) + 1;
+
+		uint64_t range = 1;
+		while (range < count)
+			range *= 2;
+
+		for (uint64_t i = 0, index = 0; i < range; i++, index = (index + stride) & (range - 1))
+		{
+			if (index >= count)
+				continue;
+
+			const uint8_t value = (uint8_t)(SplitMix64(key + from + index) >> 62);
+			sequence.Set(from + index, value);
+			expected[from + index] = value;
+		}
+	}
+
+	//every expected step, and 0 for a few past the end
+	[[nodiscard]]
+	bool Matches(const PackedSequence& sequence, const std::vector<uint8_t>& expected, const char* what) noexcept
+	{
+		for (uint64_t i = 0; i < expected.size() + 2 * MEMORY_CHUNK_STEPS; i++)
+		{
+			const int wanted = i < expected.size() ? expected[i] : 0;
+			if (sequence.Get(i) != wanted)
+			{
+				fprintf(stderr, "%s: step %llu reads %i instead of %i\n", what, (unsigned long long)i, sequence.Get(i), wanted);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	[[nodiscard]]
+	bool CheckMemory() noexcept
+	{
+		bool bPassed = true;
+
+		PackedSequence sequence;
+		std::vector<uint8_t> expected(10 * MEMORY_CHUNK_STEPS + 37);
+		WriteScattered(sequence, expected, 0, 1);
+		bPassed &= Matches(sequence, expected, "memory");
+
+		//overwriting in place keeps the neighbours in the same byte
+		for (uint64_t i = 0; i < expected.size(); i += 3)
+		{
+			expected[i] = (uint8_t)(3 - expected[i]);
+			sequence.Set(i, expected[i]);
+		}
+		bPassed &= Matches(sequence, expected, "memory overwritten");
+
+		//past the end, nothing already written moves and Set() below the reserve never grows
+		const uint64_t reserved = expected.size() + 5 * MEMORY_CHUNK_STEPS + 1;
+		sequence.Reserve(reserved);
+		const size_t bytesReserved = sequence.BytesReserved();
+		if (sequence.Capacity() < reserved)
+		{
+			fprintf(stderr, "reserve: capacity %llu is below %llu\n", (unsigned long long)sequence.Capacity(), (unsigned long long)reserved);
+			bPassed = false;
+		}
+
+		const uint64_t written = expected.size();
+		expected.resize(reserved);
+		WriteScattered(sequence, expected, written, 2);
+		if (sequence.BytesReserved() != bytesReserved)
+		{
+			fprintf(stderr, "reserve: writing below the reserve grew the sequence\n");
+			bPassed = false;
+		}
+		bPassed &= Matches(sequence, expected, "reserve");
+
+		//a smaller reserve does nothing
+		sequence.Reserve(1);
+		bPassed &= sequence.BytesReserved() == bytesReserved;
+
+		PackedSequence moved = std::move(sequence);
+		bPassed &= Matches(moved, expected, "moved");
+		bPassed &= sequence.Capacity() == 0 && sequence.Get(0) == 0;
+
+		printf("memory_steps,memory_chunks\n%llu,%llu\n", (unsigned long long)expected.size(), (unsigned long long)(moved.BytesReserved() / PackedSequence::MEMORY_CHUNK_BYTES));
+		return bPassed;
+	}
+
+#ifdef __linux__
+	[[nodiscard]]
+	bool CheckFile() noexcept
+	{
+		const std::string path = "/tmp/simon_packed_" + std::to_string(getpid()) + ".bin";
+		unlink(path.c_str());
+
+		bool bPassed = true;
+
+		//ends partway into a chunk, so the trailing partial chunk is reopened too
+		std::vector<uint8_t> expected(2 * FILE_CHUNK_STEPS + 1234);
+		{
+			PackedSequence sequence(path.c_str());
+			WriteScattered(sequence, expected, 0, 3);
+			bPassed &= Matches(sequence, expected, "file");
+		}
+
+		{
+			PackedSequence sequence(path.c_str());
+			bPassed &= Matches(sequence, expected, "file reopened");
+
+			//carried on past where the last run stopped
+			const uint64_t written = expected.size();
+			expected.resize(written + FILE_CHUNK_STEPS);
+			sequence.Reserve(expected.size());
+			WriteScattered(sequence, expected, written, 4);
+		}
+
+		uint64_t chunks = 0;
+		{
+			PackedSequence sequence(path.c_str());
+			bPassed &= Matches(sequence, expected, "file reopened again");
+			chunks = sequence.BytesReserved() / PackedSequence::FILE_CHUNK_BYTES;
+		}
+
+		unlink(path.c_str());
+
+		printf("\nfile_steps,file_chunks\n%llu,%llu\n", (unsigned long long)expected.size(), (unsigned long long)chunks);
+		return bPassed;
+	}
+#endif
+
+	//one step per chunk, so every Set() appends a chunk, this used to copy the whole chunk table each time
+	[[nodiscard]]
+	bool TimeGrowth() noexcept
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		PackedSequence sequence;
+		for (uint64_t chunk = 0; chunk < GROWTH_CHUNKS; chunk++)
+			sequence.Set(chunk * MEMORY_CHUNK_STEPS, (int)(chunk % 4));
+
+		const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		bool bPassed = true;
+		for (uint64_t chunk = 0; chunk < GROWTH_CHUNKS; chunk++)
+			bPassed &= sequence.Get(chunk * MEMORY_CHUNK_STEPS) == (int)(chunk % 4);
+
+		printf("\ngrowth_chunks,growth_ms\n%llu,%.2f\n", (unsigned long long)GROWTH_CHUNKS, milliseconds);
+		return bPassed;
+	}
+}
+
+int main()
+{
+	bool bPassed = CheckMemory();
+#ifdef __linux__
+	bPassed &= CheckFile();
+#endif
+	bPassed &= TimeGrowth();
+
+	return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,96 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//renders menu and game frames with the software rasterizer, reports frames per second
+//and writes the last frame of each scene, for golden-image comparisons, plus the
+//per-phase timings as csv and drawn over one more game frame
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "FrameProfiler.h"
+#include "SimonCore.h"
+#include "Scene.h"
+#include "SoftwareRenderer.h"
+
+int main(int argc, char** argv)
+{
+	const uint32_t size = argc > 1 ? (uint32_t)atoi(argv[1]) : 576;
+	const int frameCount = argc > 2 ? atoi(argv[2]) : 2000;
+	const std::string outputPrefix = argc > 3 ? argv[3] : "frame";
+
+	SoftwareRenderer renderer(size, size);
+
+	GameCore game(GameTimings::FromFrequency(1'000'000), 0, 1);
+	game.playbackLength = 12;
+	game.bestScore = 31;
+
+	struct SceneRun
+	{
+		const char* name;
+		bool bMenu;
+		bool bRetained;
+	};
+
+	printf("scene,size,frames,fps,pixels_per_frame,draw_calls_per_frame\n");
+
+	for (const SceneRun& scene :
+		{
+			SceneRun{ "menu", true, false },
+			SceneRun{ "game", false, false },
+			SceneRun{ "menu_retained", true, true },
+			SceneRun{ "game_retained", false, true }
+		})
+	{
+		RetainedScene retainedScene;
+		uint64_t pixels = 0;
+		uint64_t drawCalls = 0;
+
+		const auto start = std::chrono::steady_clock::now();
+
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			//the state changes every fourth frame, like a lit button during playback
+			const int step = frame / 4;
+
+			const SceneState state = scene.bMenu ?
+				MenuSceneState(size, size, (MenuItem)(step % 3)) :
+				GameSceneState(size, size, game, step % (BUTTON_COUNT + 1));
+
+			const FrameStats stats = scene.bRetained ? (retainedScene.Draw(renderer, state), retainedScene.LastFrame()) : DrawScene(renderer, state);
+
+			pixels += stats.pixels;
+			drawCalls += stats.drawCalls;
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("%s,%u,%d,%.0f,%.0f,%.2f\n", scene.name, size, frameCount, frameCount / seconds, (double)pixels / frameCount, (double)drawCalls / frameCount);
+
+		const std::string path = outputPrefix + "_" + scene.name + ".png";
+		if (!renderer.WritePng(path.c_str()))
+		{
+			fprintf(stderr, "unable to write %s\n", path.c_str());
+			return EXIT_FAILURE;
+		}
+	}
+
+	(void)DrawScene(renderer, GameSceneState(size, size, game, NO_BUTTON));
+	DrawProfileOverlay(renderer, (float)size, (float)size);
+
+	for (const std::string& path : { outputPrefix + "_overlay.png", outputPrefix + "_profile.csv" })
+	{
+		const bool bWritten = path.ends_with(".png") ? renderer.WritePng(path.c_str()) : WriteProfileReport(path.c_str());
+		if (!bWritten)
+		{
+			fprintf(stderr, "unable to write %s\n", path.c_str());
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//replays recordings headlessly and checks every checkpoint in them
+//SimonReplay <recording>... replays the given files, SimonReplay --generate <path> [events] records a bot
+//playing, with no arguments a generated recording is replayed repeatedly to measure throughput
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "CounterRng.h"
+#include "InputRecording.h"
+#include "SimonCore.h"
+
+namespace
+{
+	constexpr char SAMPLE_PATH[] = "SimonReplaySample.rec";
+	constexpr uint64_t DEFAULT_EVENTS = 20'000'000;
+	constexpr int THROUGHPUT_REPETITIONS = 5;
+
+	//a player clicking at random intervals, mostly right, sometimes into the menu, on a manual microsecond clock
+	[[nodiscard]]
+	bool GenerateRecording(const char* path, uint64_t eventCount) noexcept
+	{
+		ManualClock clock;
+		GameCore game(GameTimings::FromFrequency(clock.Frequency()), clock.Now(), 42);
+
+		InputRecorder recorder;
+		if (!recorder.Open(path, game, clock.Frequency(), clock.Now()))
+			return false;
+
+		uint64_t random = 0;
+		for (uint64_t event = 0; event < eventCount; event++)
+		{
+			clock.Advance((int64_t)(SplitMix64(random++) % 700'000));
+			const int64_t now = clock.Now();
+
+			//timers fire when they are due, like the logic thread's wakeups
+			while (game.NextDeadline() <= now)
+				recorder.Tick(game, game.NextDeadline(), {});
+
+			const uint64_t action = SplitMix64(random++) % 100;
+
+			if (game.gameState == GAME_STATE_MENU)
+				recorder.Tick(game, now, { .hoveredMenuItem = MenuItem::Play, .clicked = true });
+			else if (action < 1)
+				recorder.ReturnToMenu(game, now);
+			else if (action < 92)
+				recorder.Tick(game, now, { .hoveredButton = game.ButtonAt(game.playbackLocation), .clicked = true });
+			else
+				recorder.Tick(game, now, { .hoveredButton = (int)(action % (BUTTON_COUNT + 1)), .clicked = true });
+		}
+
+		return recorder.Close();
+	}
+
+	[[nodiscard]]
+	bool Passed(const ReplayResult& result) noexcept
+	{
+		return result.bValid && result.mismatches == 0;
+	}
+
+	void PrintResult(const char* name, size_t bytes, const ReplayResult& result, double seconds) noexcept
+	{
+		printf("%s,%zu,%s,%llu,%llu,%llu,%i,%i,%i,%.1f\n",
+			name,
+			bytes,
+			result.bValid ? "yes" : "no",
+			(unsigned long long)result.records,
+			(unsigned long long)result.checkpoints,
+			(unsigned long long)result.mismatches,
+			result.finalState,
+			result.finalScore,
+			result.bestScore,
+			bytes / seconds / 1e6);
+	}
+
+	[[nodiscard]]
+	bool ReplayFile(const char* path, int repetitions) noexcept
+	{
+		std::vector<uint8_t> data;
+		if (!ReadRecording(path, data))
+		{
+			fprintf(stderr, "could not read %s\n", path);
+			return false;
+		}
+
+		ReplayResult result = {};
+		double bestSeconds = 1e300;
+
+		for (int i = 0; i < repetitions; i++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			result = ReplayRecording(data.data(), data.size());
+			bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		PrintResult(path, data.size(), result, bestSeconds);
+		return Passed(result);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 2 && strcmp(argv[1], "--generate") == 0)
+	{
+		const uint64_t eventCount = argc > 3 ? strtoull(argv[3], nullptr, 10) : DEFAULT_EVENTS;
+		return GenerateRecording(argv[2], eventCount) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	printf("recording,bytes,valid,records,checkpoints,mismatches,final_state,final_score,best_score,mb_per_s\n");
+
+	if (argc > 1)
+	{
+		bool bPassed = true;
+		for (int i = 1; i < argc; i++)
+			bPassed &= ReplayFile(argv[i], 1);
+		return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (!GenerateRecording(SAMPLE_PATH, DEFAULT_EVENTS))
+	{
+		fprintf(stderr, "could not write %s\n", SAMPLE_PATH);
+		return EXIT_FAILURE;
+	}
+
+	return ReplayFile(SAMPLE_PATH, THROUGHPUT_REPETITIONS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,145 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//drives the resource policy through startup, monitor changes and a lost device against a mock
+//factory, fails if a resize or dpi change creates any brush, text format or render target
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "DeviceResources.h"
+
+namespace
+{
+	//counts what the policy asks for and checks it never uses a resource that does not exist
+	struct MockResourceFactory final : ResourceFactory
+	{
+		ResourceCounters created;
+		bool bRenderTarget = false;
+		uint32_t brushesAlive = 0;
+		bool bTextFormats[(size_t)TextStyle::Count] = {};
+		bool bMisused = false;
+
+		void CreateRenderTarget(uint32_t, uint32_t, uint32_t) noexcept override
+		{
+			bMisused |= bRenderTarget;
+			bRenderTarget = true;
+			created.renderTargetsCreated++;
+		}
+
+		void ResizeRenderTarget(uint32_t, uint32_t, uint32_t) noexcept override
+		{
+			bMisused |= !bRenderTarget;
+			created.renderTargetResizes++;
+		}
+
+		void CreateBrush(Paint) noexcept override
+		{
+			bMisused |= !bRenderTarget;
+			brushesAlive++;
+			created.brushesCreated++;
+		}
+
+		void CreateTextFormat(TextStyle style, float fontSize) noexcept override
+		{
+			bMisused |= fontSize <= 0;
+			bTextFormats[(size_t)style] = true;
+			created.textFormatsCreated++;
+		}
+
+		void ReleaseDeviceResources() noexcept override
+		{
+			bRenderTarget = false;
+			brushesAlive = 0;
+		}
+	};
+
+	struct Step
+	{
+		const char* name;
+		uint32_t pixelSize;
+		uint32_t dpi;
+		bool bDeviceLost;
+		//what this step is allowed to create
+		ResourceCounters expected;
+	};
+}
+
+int main()
+{
+	constexpr uint32_t brushCount = (uint32_t)Paint::Count;
+	constexpr uint32_t textFormatCount = (uint32_t)TextStyle::Count;
+
+	auto AllTextFormats = [](const MockResourceFactory& factory)
+		{
+			for (bool bTextFormat : factory.bTextFormats)
+				if (!bTextFormat)
+					return false;
+			return true;
+		};
+
+	//the window is always 6 inches, so its pixel size follows the dpi
+	constexpr Step steps[] =
+	{
+		{ "startup", 576, 96, false, { 1, 0, brushCount, textFormatCount } },
+		{ "repaint", 576, 96, false, {} },
+		{ "move_to_150_percent", 864, 144, false, { 0, 1, 0, 0 } },
+		{ "move_to_200_percent", 1152, 192, false, { 0, 1, 0, 0 } },
+		{ "move_back_to_100_percent", 576, 96, false, { 0, 1, 0, 0 } },
+		{ "move_to_125_percent", 720, 120, false, { 0, 1, 0, 0 } },
+		{ "device_lost", 720, 120, true, { 1, 0, brushCount, 0 } },
+		{ "move_back_after_device_lost", 576, 96, false, { 0, 1, 0, 0 } }
+	};
+
+	MockResourceFactory factory;
+	DeviceResources resources;
+	bool bPassed = true;
+
+	printf("step,render_targets,resizes,brushes,text_formats,scene_size,ok\n");
+
+	for (const Step& step : steps)
+	{
+		const ResourceCounters before = factory.created;
+
+		if (step.bDeviceLost)
+			resources.DeviceLost(factory);
+
+		resources.Update(factory, step.pixelSize, step.pixelSize, step.dpi);
+
+		const ResourceCounters delta =
+		{
+			.renderTargetsCreated = factory.created.renderTargetsCreated - before.renderTargetsCreated,
+			.renderTargetResizes = factory.created.renderTargetResizes - before.renderTargetResizes,
+			.brushesCreated = factory.created.brushesCreated - before.brushesCreated,
+			.textFormatsCreated = factory.created.textFormatsCreated - before.textFormatsCreated
+		};
+
+		//the scene is laid out in dips, so it must not change size with the dpi
+		const bool bOk =
+			delta == step.expected &&
+			resources.SceneWidth() == 576 &&
+			resources.SceneHeight() == 576 &&
+			factory.bRenderTarget &&
+			factory.brushesAlive == brushCount &&
+			AllTextFormats(factory);
+
+		printf("%s,%u,%u,%u,%u,%u,%s\n",
+			step.name,
+			delta.renderTargetsCreated,
+			delta.renderTargetResizes,
+			delta.brushesCreated,
+			delta.textFormatsCreated,
+			resources.SceneWidth(),
+			bOk ? "yes" : "no");
+
+		bPassed &= bOk;
+	}
+
+	//the policy's own counters have to agree with what actually reached the factory
+	bPassed &= resources.Counters() == factory.created && !factory.bMisused;
+
+	return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
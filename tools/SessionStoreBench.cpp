@@ -0,0 +1,255 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//checks the structure of arrays session store against one GameCore per session on random input,
+//then ticks stores of 1M to 16M sessions with the vector tick and with one session at a time,
+//on every thread count up to the number of cores, next to just reading one word per session, which is
+//as fast as a tick that has to look at every session can get
+//arguments: largest store in millions of sessions (default 16), simulated ticks per run (default 200)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "CounterRng.h"
+#include "SessionStore.h"
+#include "WorkStealingPool.h"
+
+namespace
+{
+	//the store runs on a millisecond clock
+	constexpr int64_t FREQUENCY = 1'000;
+	constexpr uint32_t CHECKED_SESSIONS = 2'000;
+	constexpr int CHECKED_STEPS = 2'000;
+	//ticks are this far apart, a player answers every BOT_INTERVAL ticks
+	constexpr int32_t TICK_MILLISECONDS = 5;
+	constexpr int BOT_INTERVAL = 10;
+	constexpr uint32_t TICK_GRAIN_GROUPS = 1024;
+
+	[[nodiscard]]
+	bool SameState(const SessionStore& store, SessionId session, const GameCore& core) noexcept
+	{
+		const bool bTimed = core.gameState == GAME_STATE_PLAYBACK || (core.gameState != GAME_STATE_MENU && core.bOutstandingTimer);
+
+		return
+			store.State(session) == core.gameState &&
+			store.LitButton(session) == core.currentLitButton &&
+			store.PlaybackLength(session) == core.playbackLength &&
+			store.PlaybackLocation(session) == core.playbackLocation &&
+			store.BestScore(session) == core.bestScore &&
+			//GameCore keeps a stale outstanding timer in the menu
+			(core.gameState == GAME_STATE_MENU || store.OutstandingTimer(session) == core.bOutstandingTimer) &&
+			(!bTimed || store.Deadline(session) == core.CurrentTimerFinished);
+	}
+
+	//-1 if the store and GameCore agreed on every step, otherwise the step they first differed on
+	[[nodiscard]]
+	int CompareWithGameCore() noexcept
+	{
+		const GameTimings timings = GameTimings::FromFrequency(FREQUENCY);
+		SessionStore store(timings, CHECKED_SESSIONS, 7);
+		std::vector<GameCore> cores;
+
+		for (uint32_t i = 0; i < CHECKED_SESSIONS; i++)
+		{
+			const SessionId session = store.Allocate();
+			cores.emplace_back(timings, 0, 0);
+			cores.back().sequence.key = store.SequenceKey(session);
+		}
+
+		uint64_t random = 0;
+		int32_t now = 0;
+
+		for (int step = 0; step < CHECKED_STEPS; step++)
+		{
+			now += (int32_t)(SplitMix64(random++) % 150);
+
+			(void)store.Tick(now);
+
+			for (SessionId session = 0; session < CHECKED_SESSIONS; session++)
+			{
+				GameCore& core = cores[session];
+				core.Tick(now, {});
+
+				const uint64_t action = SplitMix64(random++) % 100;
+
+				if (core.gameState == GAME_STATE_MENU)
+				{
+					if (action < 20)
+					{
+						core.StartGame(now);
+						store.StartGame(session, now);
+					}
+				}
+				else if (action < 2)
+				{
+					core.ReturnToMenu(now);
+					store.ReturnToMenu(session);
+				}
+				else if (action < 60)
+				{
+					//mostly right, so sequences get long enough to cross vector lanes at different points
+					const int button = action < 55 ? core.ButtonAt(core.playbackLocation) : (int)(action % BUTTON_COUNT);
+					core.Tick(now, { .hoveredButton = button, .clicked = true });
+					(void)store.Press(session, button, now);
+				}
+
+				//both draw a new stream for every game, from different counters
+				core.sequence.key = store.SequenceKey(session);
+
+				if (!SameState(store, session, core))
+					return step;
+			}
+		}
+
+		return -1;
+	}
+
+	//every session plays, started at staggered times, and whoever waits for input repeats the sequence
+	void StartAll(SessionStore& store) noexcept
+	{
+		for (uint32_t i = 0; i < store.Capacity(); i++)
+			store.StartGame(store.Allocate(), (int32_t)(i % 1'000));
+	}
+
+	void AnswerAll(SessionStore& store, int32_t now) noexcept
+	{
+		for (SessionId session = 0; session < store.Capacity(); session++)
+		{
+			if (!store.AwaitingInput(session))
+				continue;
+
+			const int length = store.PlaybackLength(session);
+			for (int step = 0; step < length; step++)
+				(void)store.Press(session, store.ButtonAt(session, (uint32_t)step), now);
+		}
+	}
+
+	struct TickResult
+	{
+		double nsPerSession;
+		uint64_t changed;
+	};
+
+	template<typename TickFunction>
+	[[nodiscard]]
+	TickResult RunTicks(SessionStore& store, WorkStealingPool& pool, int ticks, TickFunction tick) noexcept
+	{
+		std::atomic<uint64_t> changed = 0;
+		double seconds = 0;
+		int32_t now = 0;
+
+		for (int i = 0; i < ticks; i++)
+		{
+			now += TICK_MILLISECONDS;
+
+			const auto start = std::chrono::steady_clock::now();
+			pool.ParallelFor(store.Capacity() / SessionStore::SESSION_ALIGNMENT, TICK_GRAIN_GROUPS, [&](uint32_t begin, uint32_t end, uint32_t)
+				{
+					changed.fetch_add(tick(store, now, begin * SessionStore::SESSION_ALIGNMENT, end * SessionStore::SESSION_ALIGNMENT), std::memory_order_relaxed);
+				});
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			if (i % BOT_INTERVAL == 0)
+				AnswerAll(store, now);
+		}
+
+		return { .nsPerSession = seconds * 1e9 / ((double)store.Capacity() * ticks), .changed = changed.load() };
+	}
+
+	//summing one int32 per session on the same threads, the most a tick that reads every deadline can reach
+	[[nodiscard]]
+	double ReadNsPerSession(uint32_t sessionCount, WorkStealingPool& pool, int repetitions) noexcept
+	{
+		const std::vector<int32_t> words(sessionCount, 1);
+		std::atomic<int64_t> sum = 0;
+
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < repetitions; i++)
+		{
+			pool.ParallelFor(sessionCount / SessionStore::SESSION_ALIGNMENT, TICK_GRAIN_GROUPS, [&](uint32_t begin, uint32_t end, uint32_t)
+				{
+					int64_t partial = 0;
+					for (uint32_t j = begin * SessionStore::SESSION_ALIGNMENT; j < end * SessionStore::SESSION_ALIGNMENT; j++)
+						partial += words[j];
+					sum.fetch_add(partial, std::memory_order_relaxed);
+				});
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		return sum.load() == (int64_t)sessionCount * repetitions ? seconds * 1e9 / ((double)sessionCount * repetitions) : -1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t maxMillions = argc > 1 ? std::max((uint32_t)strtoul(argv[1], nullptr, 10), 1u) : 16;
+	const int ticks = argc > 2 ? std::max(atoi(argv[2]), 1) : 200;
+	const uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	const int mismatchStep = CompareWithGameCore();
+	if (mismatchStep >= 0)
+	{
+		fprintf(stderr, "the store and GameCore differ at step %i\n", mismatchStep);
+		return EXIT_FAILURE;
+	}
+	printf("compared %u sessions over %i steps with GameCore, no differences\n\n", CHECKED_SESSIONS, CHECKED_STEPS);
+
+	const GameTimings timings = GameTimings::FromFrequency(FREQUENCY);
+
+	printf("sessions,threads,arena_mb,vector_ns_per_session,scalar_ns_per_session,speedup,read_ns_per_session,vector_gb_per_s,changed_per_tick\n");
+
+	for (uint32_t millions = 1; millions <= maxMillions; millions *= 4)
+	{
+		const uint32_t sessionCount = millions * 1'000'000;
+
+		for (uint32_t threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+		{
+			WorkStealingPool pool(threadCount);
+
+			SessionStore vectorStore(timings, sessionCount, 1);
+			SessionStore scalarStore(timings, sessionCount, 1);
+			StartAll(vectorStore);
+			StartAll(scalarStore);
+
+			const TickResult vector = RunTicks(vectorStore, pool, ticks, [](SessionStore& store, int32_t now, uint32_t begin, uint32_t end)
+				{
+					return store.Tick(now, begin, end);
+				});
+			const TickResult scalar = RunTicks(scalarStore, pool, ticks, [](SessionStore& store, int32_t now, uint32_t begin, uint32_t end)
+				{
+					return store.TickScalar(now, begin, end);
+				});
+
+			//both played the same games, so they must have made the same transitions
+			if (vector.changed != scalar.changed)
+			{
+				fprintf(stderr, "vector and scalar ticks differ at %u sessions\n", sessionCount);
+				return EXIT_FAILURE;
+			}
+
+			const double readNs = ReadNsPerSession(sessionCount, pool, ticks);
+
+			//every deadline is read, a due session reads and writes more
+			printf("%u,%u,%.0f,%.3f,%.3f,%.1f,%.3f,%.2f,%.0f\n",
+				sessionCount,
+				threadCount,
+				(double)vectorStore.Capacity() * SessionStore::BYTES_PER_SESSION / (1 << 20),
+				vector.nsPerSession,
+				scalar.nsPerSession,
+				scalar.nsPerSession / vector.nsPerSession,
+				readNs,
+				sizeof(int32_t) / vector.nsPerSession,
+				(double)vector.changed / ticks);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
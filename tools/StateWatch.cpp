@@ -0,0 +1,352 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//reads the game state a running game exports to shared memory
+//SimonStateWatch [segment name] [poll milliseconds] prints a line whenever the state changes, through the game
+//closing and the next one starting, --stress [readers] [seconds] times a publish and a read, then has a bot's game published at
+//10 kHz while every reader thread maps the segment itself and polls it flat out, every copy a reader keeps is
+//compared with what was published under its count, fails if any was torn or went back in time
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "CounterRng.h"
+#include "SimonCore.h"
+#include "StateExport.h"
+
+namespace
+{
+	constexpr int DEFAULT_POLL_MILLISECONDS = 10;
+	constexpr int DEFAULT_READERS = 16;
+	constexpr int DEFAULT_SECONDS = 5;
+	constexpr int PUBLISH_HZ = 10'000;
+	constexpr int64_t FREQUENCY = 1'000'000;
+	constexpr int TIMED_OPERATIONS = 1'000'000;
+
+	[[nodiscard]]
+	const char* StateName(int gameState) noexcept
+	{
+		switch (gameState)
+		{
+		case GAME_STATE_MENU:
+			return "menu";
+		case GAME_STATE_PLAYBACK:
+			return "playback";
+		case GAME_STATE_INPUT:
+			return "input";
+		default:
+			return "?";
+		}
+	}
+
+	[[nodiscard]]
+	int64_t SteadyNanoseconds() noexcept
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void Watch(const char* name, int pollMilliseconds) noexcept
+	{
+		StateExportReader reader;
+		while (!reader.Open(name))
+		{
+			fprintf(stderr, "waiting for a game to export %s\n", name);
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+		}
+
+		uint64_t lastPublish = 0;
+		while (true)
+		{
+			ExportedState state;
+			if (reader.Read(state) && state.publishCount != lastPublish)
+			{
+				lastPublish = state.publishCount;
+
+				//the game's clock is this process's steady clock when it runs on SteadyClock
+				char timer[32] = "-";
+				if (state.timerDeadline != NO_DEADLINE && !state.bClosed)
+				{
+					const int64_t now = SteadyNanoseconds() / 1'000 * state.frequency / 1'000'000;
+					snprintf(timer, sizeof(timer), "%lld ms", (long long)((state.timerDeadline - now) * 1'000 / state.frequency));
+				}
+
+				char lit[8] = "-";
+				if (state.currentLitButton != NO_BUTTON)
+					snprintf(lit, sizeof(lit), "%i", state.currentLitButton);
+
+				printf("%llu %s lit %s step %i/%i score %i best %i last %i games %llu timer %s%s\n",
+					(unsigned long long)state.publishCount,
+					StateName(state.gameState),
+					lit,
+					state.playbackLocation,
+					state.playbackLength,
+					state.score,
+					state.bestScore,
+					state.lastScore,
+					(unsigned long long)state.finishedGames,
+					timer,
+					state.bClosed ? " closed" : "");
+				fflush(stdout);
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(pollMilliseconds));
+		}
+	}
+
+	//a bot playing at real time pace, one press every 150 to 600 ms, one in eight wrong
+	struct Bot
+	{
+		GameCore game;
+		uint64_t random = 1;
+		int64_t nextPress = 0;
+
+		Bot() noexcept :
+			game(GameTimings::FromFrequency(FREQUENCY), 0, 42)
+		{
+		}
+
+		void Advance(int64_t now) noexcept
+		{
+			if (game.gameState == GAME_STATE_MENU)
+				game.StartGame(now);
+
+			while (game.NextDeadline() <= now)
+				game.Tick(now, {});
+
+			if (game.gameState != GAME_STATE_INPUT || game.bOutstandingTimer)
+			{
+				nextPress = 0;
+				return;
+			}
+
+			const uint64_t roll = SplitMix64(random++);
+			if (nextPress == 0)
+				nextPress = now + 150'000 + (int64_t)(roll % 450'000);
+
+			if (now < nextPress)
+				return;
+
+			const int right = game.ButtonAt(game.playbackLocation);
+			game.Tick(now, { .hoveredButton = (roll >> 32) % 8 == 0 ? (right + 1) % BUTTON_COUNT : right, .clicked = true });
+			nextPress = 0;
+		}
+	};
+
+	struct alignas(CACHE_LINE_SIZE) ReaderResult
+	{
+		uint64_t reads;
+		uint64_t statesSeen;
+		uint64_t retries;
+		uint64_t torn;
+		uint64_t backwards;
+		double seconds;
+		bool bSawClose;
+	};
+
+	//states[i] is what publish i wrote, filled in before it is published
+	void ReadUntilClosed(const char* name, const ExportedState* states, const std::atomic<bool>& bStart, ReaderResult& result) noexcept
+	{
+		result = {};
+
+		StateExportReader reader;
+		if (!reader.Open(name))
+			return;
+
+		while (!bStart.load(std::memory_order_acquire))
+			std::this_thread::yield();
+
+		const auto start = std::chrono::steady_clock::now();
+
+		uint64_t lastPublish = 0;
+		while (true)
+		{
+			ExportedState state;
+			if (!reader.Read(state))
+				continue;
+			result.reads++;
+
+			if (state.publishCount < lastPublish)
+				result.backwards++;
+			if (memcmp(&state, &states[state.publishCount], sizeof(state)) != 0)
+				result.torn++;
+
+			if (state.publishCount != lastPublish)
+				result.statesSeen++;
+			lastPublish = state.publishCount;
+
+			if (state.bClosed)
+			{
+				result.bSawClose = true;
+				break;
+			}
+		}
+
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.retries = reader.Retries();
+	}
+
+	[[nodiscard]]
+	bool Stress(int readerCount, int seconds) noexcept
+	{
+		const std::string name = "/SimonStateStress" + std::to_string(getpid());
+
+		//a publish and a read with nobody else on the segment
+		{
+			StateExporter exporter;
+			StateExportReader reader;
+			if (!exporter.Open(name.c_str(), FREQUENCY) || !reader.Open(name.c_str()))
+			{
+				fprintf(stderr, "cannot set up %s\n", name.c_str());
+				return false;
+			}
+
+			Bot bot;
+			ExportedState state = ExportState(bot.game, 0, FREQUENCY);
+
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < TIMED_OPERATIONS; i++)
+			{
+				state.publishTime = i;
+				exporter.Publish(state);
+			}
+			const double publishNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / TIMED_OPERATIONS;
+
+			uint64_t sum = 0;
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < TIMED_OPERATIONS; i++)
+			{
+				if (reader.Read(state))
+					sum += state.publishCount;
+			}
+			const double readNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / TIMED_OPERATIONS;
+
+			if (sum != (uint64_t)TIMED_OPERATIONS * TIMED_OPERATIONS)
+			{
+				fprintf(stderr, "uncontended reads came back wrong\n");
+				return false;
+			}
+
+			printf("uncontended_publish_ns,uncontended_read_ns\n%.1f,%.1f\n\n", publishNs, readNs);
+		}
+
+		//the stress run starts over on a fresh segment
+		(void)shm_unlink(name.c_str());
+
+		StateExporter exporter;
+		if (!exporter.Open(name.c_str(), FREQUENCY))
+		{
+			fprintf(stderr, "cannot set up %s\n", name.c_str());
+			return false;
+		}
+
+		const uint64_t publishes = (uint64_t)seconds * PUBLISH_HZ;
+		//one more for the close, and index 0 that is never published
+		std::vector<ExportedState> states(publishes + 2);
+
+		Bot bot;
+		ExportedState first = ExportState(bot.game, 0, FREQUENCY);
+		first.publishCount = 1;
+		states[1] = first;
+		exporter.Publish(first);
+
+		std::atomic<bool> bStart = false;
+		std::vector<ReaderResult> results(readerCount);
+		std::vector<std::thread> readers;
+		for (int i = 0; i < readerCount; i++)
+			readers.emplace_back(ReadUntilClosed, name.c_str(), states.data(), std::cref(bStart), std::ref(results[i]));
+
+		//readers open the segment before the clock starts
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		bStart.store(true, std::memory_order_release);
+
+		//paced by deadline, a late publish is caught up right away so the rate holds on average
+		const int64_t periodNs = 1'000'000'000 / PUBLISH_HZ;
+		const int64_t start = SteadyNanoseconds();
+		int64_t maxLateNs = 0;
+		for (uint64_t i = 2; i <= publishes; i++)
+		{
+			const int64_t deadline = start + (int64_t)(i - 1) * periodNs;
+			if (SteadyNanoseconds() < deadline)
+				std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline)));
+			maxLateNs = std::max(maxLateNs, SteadyNanoseconds() - deadline);
+
+			const int64_t now = (int64_t)(i - 1) * (FREQUENCY / PUBLISH_HZ);
+			bot.Advance(now);
+
+			ExportedState state = ExportState(bot.game, now, FREQUENCY);
+			state.publishCount = i;
+			states[i] = state;
+			exporter.Publish(state);
+		}
+		const double writerSeconds = (SteadyNanoseconds() - start) / 1e9;
+
+		ExportedState closing = states[publishes];
+		closing.publishCount = publishes + 1;
+		closing.bClosed = 1;
+		states[publishes + 1] = closing;
+		exporter.Close();
+
+		for (std::thread& reader : readers)
+			reader.join();
+		(void)shm_unlink(name.c_str());
+
+		ReaderResult total = {};
+		bool bAllClosed = true;
+		double readerSeconds = 0;
+		for (const ReaderResult& result : results)
+		{
+			total.reads += result.reads;
+			total.statesSeen += result.statesSeen;
+			total.retries += result.retries;
+			total.torn += result.torn;
+			total.backwards += result.backwards;
+			readerSeconds += result.seconds;
+			bAllClosed &= result.bSawClose;
+		}
+
+		printf("readers,publishes,publish_hz,max_late_us,reads,reads_per_s,wall_ns_per_read,retry_percent,states_seen_percent,torn,backwards\n");
+		printf("%i,%llu,%.0f,%.0f,%llu,%.0f,%.1f,%.4f,%.1f,%llu,%llu\n",
+			readerCount,
+			(unsigned long long)publishes,
+			publishes / writerSeconds,
+			maxLateNs / 1e3,
+			(unsigned long long)total.reads,
+			total.reads / writerSeconds,
+			readerSeconds * 1e9 / std::max(total.reads, (uint64_t)1),
+			total.retries * 100.0 / std::max(total.reads + total.retries, (uint64_t)1),
+			total.statesSeen * 100.0 / ((publishes + 1) * (uint64_t)readerCount),
+			(unsigned long long)total.torn,
+			(unsigned long long)total.backwards);
+
+		if (!bAllClosed)
+			fprintf(stderr, "a reader never saw the segment close\n");
+
+		return bAllClosed && total.torn == 0 && total.backwards == 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && strcmp(argv[1], "--stress") == 0)
+	{
+		const int readers = argc > 2 ? std::max(atoi(argv[2]), 1) : DEFAULT_READERS;
+		const int seconds = argc > 3 ? std::max(atoi(argv[3]), 1) : DEFAULT_SECONDS;
+		return Stress(readers, seconds) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	Watch(argc > 1 ? argv[1] : DEFAULT_STATE_EXPORT_NAME, argc > 2 ? std::max(atoi(argv[2]), 1) : DEFAULT_POLL_MILLISECONDS);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,321 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//crash recovery and startup cost of the stats store
+//first a forked writer journals games until it is killed at a random moment, every reopened file must hold
+//each game the writer finished and at most the one it was in the middle of, with a summary matching them,
+//then summary copies and entries are torn by hand, then Open() is timed on journals from 1k to 1M games
+//next to reading the whole file, which is what startup would cost without the summary
+//arguments: crash rounds (default 50)
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "CounterRng.h"
+#include "StatsStore.h"
+
+namespace
+{
+	constexpr int64_t FREQUENCY = 1'000'000;
+	//each writer stops here and waits to be killed, so the journal stays a few megabytes
+	constexpr uint64_t GAMES_PER_LIFE = 20'000;
+	constexpr uint64_t MAX_KILL_MICROSECONDS = 1'000;
+	constexpr uint64_t TIMED_GAMES[] = { 1'000, 100'000, 1'000'000 };
+	constexpr int OPEN_REPETITIONS = 101;
+	constexpr uint64_t TORN_GAMES = 5'000;
+	constexpr uint64_t ALL_ENTRIES = UINT64_MAX;
+
+	//game i of every journal, so any prefix of it can be summarized again independently of the store
+	[[nodiscard]]
+	FinishedGame ResultFor(uint64_t i) noexcept
+	{
+		return
+		{
+			.seed = SplitMix64(i),
+			.gameNumber = i,
+			.playbackLength = (int)(SplitMix64(i + 1) % 40) + 1,
+			.startTime = 0,
+			.endTime = (int64_t)(SplitMix64(i + 2) % 600'000'000)
+		};
+	}
+
+	[[nodiscard]]
+	bool SummaryMatches(const StatsSummary& summary) noexcept
+	{
+		uint64_t rounds = 0;
+		int64_t microseconds = 0;
+		int bestScore = 0;
+
+		for (uint64_t i = 0; i < summary.games; i++)
+		{
+			const FinishedGame result = ResultFor(i);
+			rounds += (uint64_t)(result.playbackLength - 1);
+			microseconds += result.endTime;
+			bestScore = std::max(bestScore, result.playbackLength - 1);
+		}
+
+		return summary.rounds == rounds && summary.microseconds == microseconds && summary.bestScore == bestScore;
+	}
+
+	[[noreturn]]
+	void RunWriter(const char* path, std::atomic<uint64_t>& finished) noexcept
+	{
+		StatsStore store;
+		if (!store.Open(path))
+			_exit(EXIT_FAILURE);
+
+		const uint64_t first = store.Summary().games;
+		for (uint64_t i = first; i < first + GAMES_PER_LIFE; i++)
+		{
+			store.Append(ResultFor(i), FREQUENCY);
+			finished.store(i + 1, std::memory_order_release);
+		}
+
+		while (true)
+			pause();
+	}
+
+	//false on the first round whose file does not hold what the writer finished
+	[[nodiscard]]
+	bool CrashRounds(const char* path, int rounds) noexcept
+	{
+		auto* finished = (std::atomic<uint64_t>*)mmap(nullptr, sizeof(std::atomic<uint64_t>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (finished == MAP_FAILED)
+			FATAL_ON_ERRNO_IMPL("mmap", __LINE__);
+
+		uint64_t recovered = 0;
+		uint64_t random = 0;
+
+		for (int round = 0; round < rounds; round++)
+		{
+			finished->store(0, std::memory_order_relaxed);
+
+			const pid_t writer = fork();
+			FATAL_ON_NEGATIVE(writer);
+
+			if (writer == 0)
+				RunWriter(path, *finished);
+
+			usleep((useconds_t)(SplitMix64(random++) % MAX_KILL_MICROSECONDS));
+			FATAL_ON_NEGATIVE(kill(writer, SIGKILL));
+
+			int status;
+			FATAL_ON_NEGATIVE(waitpid(writer, &status, 0));
+
+			StatsStore store;
+			if (!store.Open(path))
+			{
+				fprintf(stderr, "round %i: the file did not open\n", round);
+				return false;
+			}
+
+			//a writer killed before its first append has nothing to check against
+			const uint64_t writerFinished = finished->load(std::memory_order_acquire);
+			const uint64_t games = store.Summary().games;
+
+			if ((writerFinished != 0 && games != writerFinished && games != writerFinished + 1) || !SummaryMatches(store.Summary()))
+			{
+				fprintf(stderr, "round %i: writer finished %llu games, store holds %llu\n", round, (unsigned long long)writerFinished, (unsigned long long)games);
+				return false;
+			}
+
+			recovered += store.RecoveredEntries();
+		}
+
+		printf("crash_rounds,%i\nrecovered_entries,%llu\n", rounds, (unsigned long long)recovered);
+		munmap(finished, sizeof(std::atomic<uint64_t>));
+		return true;
+	}
+
+	void Overwrite(const char* path, uint64_t offset, const void* data, size_t size) noexcept
+	{
+		const int fd = open(path, O_WRONLY | O_CLOEXEC);
+		FATAL_ON_NEGATIVE(fd);
+		FATAL_ON_NEGATIVE(pwrite(fd, data, size, (off_t)offset));
+		close(fd);
+	}
+
+	[[nodiscard]]
+	uint64_t SummaryOffset(uint64_t games) noexcept
+	{
+		return offsetof(StatsHeader, summaries) + games % 2 * sizeof(StatsSummary);
+	}
+
+	[[nodiscard]]
+	uint64_t EntryOffset(uint64_t index) noexcept
+	{
+		return sizeof(StatsHeader) + index * sizeof(StatsEntry);
+	}
+
+	struct TornCase
+	{
+		const char* name;
+		//what is broken after the journal got its last game
+		void(*tear)(const char* path, uint64_t games) noexcept;
+		//entries Open() should fold back in, ALL_ENTRIES for every one
+		uint64_t expectedRecovered;
+		//games lost to the tear
+		uint64_t expectedLoss;
+	};
+
+	//false if any hand made crash leaves the store with the wrong games or summary
+	[[nodiscard]]
+	bool TornCases(const char* path, uint64_t games) noexcept
+	{
+		static const uint8_t garbage[sizeof(StatsEntry)] = { 0xA5, 0x5A, 0xA5, 0x5A, 0xA5, 0x5A, 0xA5, 0x5A, 0xA5, 0x5A, 0xA5, 0x5A, 0xA5, 0x5A, 0xA5, 0x5A };
+
+		const TornCase cases[] =
+		{
+			//the newer copy was half written, the older one and the last entry rebuild it
+			{ "newer_summary_torn", [](const char* path, uint64_t games) noexcept { Overwrite(path, SummaryOffset(games) + 8, garbage, 8); }, 1, 0 },
+			//both copies lost, the whole journal is folded again
+			{ "both_summaries_torn", [](const char* path, uint64_t games) noexcept
+				{
+					Overwrite(path, SummaryOffset(games), garbage, sizeof(StatsSummary));
+					Overwrite(path, SummaryOffset(games + 1), garbage, sizeof(StatsSummary));
+				}, ALL_ENTRIES, 0 },
+			//the last entry was half written and its summary never was, the game is lost and nothing else
+			{ "last_entry_torn", [](const char* path, uint64_t games) noexcept
+				{
+					Overwrite(path, SummaryOffset(games), garbage, sizeof(StatsSummary));
+					Overwrite(path, EntryOffset(games - 1) + 8, garbage, 8);
+				}, 0, 1 },
+			//garbage past the end of the journal is not a game
+			{ "garbage_after_end", [](const char* path, uint64_t games) noexcept { Overwrite(path, EntryOffset(games), garbage, sizeof(garbage)); }, 0, 0 }
+		};
+
+		for (const TornCase& tornCase : cases)
+		{
+			unlink(path);
+
+			{
+				StatsStore store;
+				if (!store.Open(path))
+					return false;
+				for (uint64_t i = 0; i < games; i++)
+					store.Append(ResultFor(i), FREQUENCY);
+			}
+
+			tornCase.tear(path, games);
+
+			StatsStore store;
+			const bool bOpened = store.Open(path);
+			const uint64_t expectedGames = games - tornCase.expectedLoss;
+			const uint64_t expectedRecovered = tornCase.expectedRecovered == ALL_ENTRIES ? games : tornCase.expectedRecovered;
+
+			const bool bPassed =
+				bOpened &&
+				store.Summary().games == expectedGames &&
+				store.RecoveredEntries() == expectedRecovered &&
+				SummaryMatches(store.Summary());
+
+			printf("%s,%s,%llu,%llu\n", tornCase.name, bPassed ? "ok" : "FAILED", (unsigned long long)store.Summary().games, (unsigned long long)store.RecoveredEntries());
+
+			if (!bPassed)
+				return false;
+		}
+
+		return true;
+	}
+
+	[[nodiscard]]
+	double MedianOpenMicroseconds(const char* path) noexcept
+	{
+		std::vector<double> microseconds(OPEN_REPETITIONS);
+
+		for (double& sample : microseconds)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			{
+				StatsStore store;
+				if (!store.Open(path) || store.RecoveredEntries() != 0)
+					return -1;
+			}
+			sample = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		std::sort(microseconds.begin(), microseconds.end());
+		return microseconds[microseconds.size() / 2];
+	}
+
+	//reads every byte of the file, the least a startup that parses the journal has to do
+	[[nodiscard]]
+	double FullReadMicroseconds(const char* path) noexcept
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		FILE* file = fopen(path, "rb");
+		FATAL_ON_NULL(file);
+
+		static uint8_t buffer[1 << 16];
+		uint64_t sum = 0;
+		size_t bytesRead;
+		while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) != 0)
+			sum += buffer[bytesRead - 1];
+		fclose(file);
+
+		const double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		return sum == UINT64_MAX ? 0 : microseconds;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int rounds = argc > 1 ? std::max(atoi(argv[1]), 1) : 50;
+	const std::string path = "/tmp/simon_stats_" + std::to_string(getpid()) + ".dat";
+
+	unlink(path.c_str());
+	const bool bCrashesPassed = CrashRounds(path.c_str(), rounds);
+
+	printf("case,result,games,recovered\n");
+	const bool bTornPassed = bCrashesPassed && TornCases(path.c_str(), TORN_GAMES);
+
+	bool bOpenPassed = bTornPassed;
+	if (bTornPassed)
+	{
+		printf("games,file_kib,append_ns,open_us,full_read_us\n");
+
+		for (const uint64_t games : TIMED_GAMES)
+		{
+			unlink(path.c_str());
+
+			const auto start = std::chrono::steady_clock::now();
+			{
+				StatsStore store;
+				if (!store.Open(path.c_str()))
+					return EXIT_FAILURE;
+				for (uint64_t i = 0; i < games; i++)
+					store.Append(ResultFor(i), FREQUENCY);
+			}
+			const double appendNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / games;
+
+			const double openMicroseconds = MedianOpenMicroseconds(path.c_str());
+			bOpenPassed &= openMicroseconds >= 0;
+
+			printf("%llu,%llu,%.1f,%.1f,%.1f\n",
+				(unsigned long long)games,
+				(unsigned long long)(EntryOffset(games) + StatsStore::FILE_CHUNK_BYTES - 1) / StatsStore::FILE_CHUNK_BYTES * 64,
+				appendNs,
+				openMicroseconds,
+				FullReadMicroseconds(path.c_str()));
+		}
+	}
+
+	unlink(path.c_str());
+	return bOpenPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
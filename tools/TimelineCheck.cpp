@@ -0,0 +1,209 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//plays GameTimeline and GameCore side by side on random input and fails on the first observable difference,
+//then interleaves many timelines on one thread and reports what a resume costs next to polling every frame
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "CounterRng.h"
+#include "GameTimeline.h"
+#include "SimonCore.h"
+
+namespace
+{
+	//millisecond ticks keep the wheel's resolution at one tick without walking millions of empty slots
+	constexpr int64_t FREQUENCY = 1000;
+	constexpr GameTimings TIMINGS = GameTimings::FromFrequency(FREQUENCY);
+	constexpr int EVENTS_PER_GAME = 2000;
+	constexpr int POLLING_HZ = 60;
+
+	class Random
+	{
+	public:
+		explicit Random(uint64_t seed) noexcept : state(seed) {}
+
+		[[nodiscard]]
+		uint64_t Below(uint64_t bound) noexcept { return SplitMix64(state++) % bound; }
+
+	private:
+		uint64_t state;
+	};
+
+	//the verdict the server used to derive from a GameCore before and after the press
+	[[nodiscard]]
+	Verdict CoreVerdict(GameCore& core, int64_t now, int button) noexcept
+	{
+		const bool bAwaitingInput = core.gameState == GAME_STATE_INPUT && !core.bOutstandingTimer;
+		const int lengthBefore = core.playbackLength;
+		const int locationBefore = core.playbackLocation;
+
+		core.Tick(now, { .hoveredButton = button, .clicked = true });
+
+		if (!bAwaitingInput)
+			return Verdict::Ignored;
+		if (core.playbackLength > lengthBefore)
+			return Verdict::RoundComplete;
+		if (core.playbackLength < lengthBefore || core.bOutstandingTimer)
+			return Verdict::Wrong;
+		if (core.playbackLocation != locationBefore)
+			return Verdict::Correct;
+		return Verdict::Ignored;
+	}
+
+	[[nodiscard]]
+	bool SameState(const GameCore& core, const GameTimeline& timeline) noexcept
+	{
+		//GameCore leaves its timer flag behind when returning to the menu, where nothing reads it
+		return core.gameState == timeline.State()
+			&& core.DisplayedLitButton(NO_BUTTON) == timeline.LitButton()
+			&& (core.gameState == GAME_STATE_MENU || core.bOutstandingTimer == timeline.InTransition())
+			&& core.playbackLength == timeline.PlaybackLength()
+			&& core.bestScore == timeline.BestScore();
+	}
+
+	//returns the event index of the first difference, or -1
+	[[nodiscard]]
+	int CompareGame(uint64_t seed) noexcept
+	{
+		Random random(seed * 0x9E3779B97F4A7C15ull);
+
+		GameCore core(TIMINGS, 0, seed);
+		TimelineScheduler scheduler(1, 0);
+		GameTimeline timeline(scheduler, TIMINGS, seed, 0);
+
+		int64_t now = 0;
+		int64_t coreTime = 0;
+
+		for (int event = 0; event < EVENTS_PER_GAME; event++)
+		{
+			now += (int64_t)random.Below(FREQUENCY * 7 / 10);
+
+			//both sides catch up on their own timers first, each at the time it was due
+			while (core.NextDeadline() <= now)
+			{
+				coreTime = std::max(coreTime, core.NextDeadline());
+				core.Tick(coreTime, {});
+			}
+
+			while (scheduler.NextExpiry() <= now)
+				scheduler.Advance(scheduler.NextExpiry(), [](uint64_t) {});
+			scheduler.Advance(now, [](uint64_t) {});
+
+			if (!SameState(core, timeline))
+				return event;
+
+			const uint64_t action = random.Below(100);
+			if (action < 3)
+			{
+				core.ReturnToMenu(now);
+				timeline.ReturnToMenu();
+			}
+			else if (action < 10)
+			{
+				if (core.gameState == GAME_STATE_MENU)
+					core.StartGame(now);
+				timeline.Start(now);
+			}
+			else
+			{
+				//mostly right, so games get long enough to be interesting
+				const int button = action < 90 ? core.ButtonAt(core.playbackLocation) : (int)random.Below(BUTTON_COUNT + 1);
+				const Verdict coreVerdict = CoreVerdict(core, now, button);
+				const Verdict timelineVerdict = timeline.Press(button, now);
+
+				if (coreVerdict != timelineVerdict)
+					return event;
+			}
+
+			coreTime = now;
+
+			if (!SameState(core, timeline))
+				return event;
+		}
+
+		//leaving mid-sleep must take the pending timer with it
+		timeline.ReturnToMenu();
+		return scheduler.SleepingCount() == 0 ? -1 : EVENTS_PER_GAME;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t timelineCount = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 100'000;
+	const int64_t seconds = argc > 2 ? strtoll(argv[2], nullptr, 10) : 60;
+	const uint64_t comparedGames = argc > 3 ? strtoull(argv[3], nullptr, 10) : 500;
+
+	for (uint64_t seed = 1; seed <= comparedGames; seed++)
+	{
+		const int difference = CompareGame(seed);
+		if (difference >= 0)
+		{
+			fprintf(stderr, "timeline and core disagree on seed %llu at event %i\n", (unsigned long long)seed, difference);
+			return EXIT_FAILURE;
+		}
+	}
+	printf("compared %llu games of %i events, no differences\n", (unsigned long long)comparedGames, EVENTS_PER_GAME);
+
+	TimelineScheduler scheduler(1, 0);
+	scheduler.Reserve(timelineCount);
+
+	std::vector<std::unique_ptr<GameTimeline>> timelines;
+	timelines.reserve(timelineCount);
+
+	Random random(1);
+	for (uint32_t i = 0; i < timelineCount; i++)
+	{
+		timelines.push_back(std::make_unique<GameTimeline>(scheduler, TIMINGS, i, i));
+		timelines.back()->Start((int64_t)random.Below(FREQUENCY));
+	}
+
+	uint64_t resumes = 0;
+	uint64_t presses = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (int64_t now = 0; now <= seconds * FREQUENCY; now++)
+	{
+		scheduler.Advance(now, [&](uint64_t context)
+			{
+				resumes++;
+
+				GameTimeline& timeline = *timelines[context];
+				if (!(timeline.TakeChanges() & TIMELINE_CHANGE_INPUT_PHASE))
+					return;
+
+				//an instant player that slips about once every fifty presses
+				for (int step = 0; step < timeline.PlaybackLength() && timeline.State() == GAME_STATE_INPUT; step++)
+				{
+					const int button = random.Below(50) == 0 ? (timeline.ButtonAt(step) + 1) % BUTTON_COUNT : timeline.ButtonAt(step);
+					(void)timeline.Press(button, now);
+					presses++;
+				}
+			});
+	}
+
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const double polledTicks = (double)timelineCount * seconds * POLLING_HZ;
+
+	printf("timelines,simulated_s,resumes,presses,ns_per_resume,wall_ms_per_simulated_s,polled_ticks_at_60hz,resumes_vs_polled\n");
+	printf("%u,%lld,%llu,%llu,%.1f,%.3f,%.0f,%.4f\n",
+		timelineCount,
+		(long long)seconds,
+		(unsigned long long)resumes,
+		(unsigned long long)presses,
+		elapsed * 1e9 / std::max(resumes + presses, (uint64_t)1),
+		elapsed * 1000 / seconds,
+		polledTicks,
+		resumes / polledTicks);
+
+	return EXIT_SUCCESS;
+}
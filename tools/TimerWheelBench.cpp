@@ -0,0 +1,192 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//per-timer cost of the timing wheel against a binary heap with lazy cancellation, at growing
+//numbers of outstanding timers, the wheel's columns should stay flat while the heap's grow with log n
+//every fired timer reschedules itself like a session does, and the wheel is checked to never fire
+//early and never more than one resolution late
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <vector>
+
+#include "CounterRng.h"
+#include "TimerWheel.h"
+
+namespace
+{
+	constexpr int64_t RESOLUTION = 1'000'000;
+	//a second of deadlines, about the spread of lit and off times across sessions
+	constexpr int64_t HORIZON = 1'000'000'000;
+	constexpr uint64_t CHURN_FIRES = 2'000'000;
+
+	struct BenchResult
+	{
+		double scheduleNs;
+		double rescheduleNs;
+		double fireNs;
+		bool bCorrect;
+	};
+
+	class DeadlineSource
+	{
+	public:
+		[[nodiscard]]
+		int64_t After(int64_t now) noexcept { return now + 1 + (int64_t)(SplitMix64(counter++) % HORIZON); }
+
+	private:
+		uint64_t counter = 0;
+	};
+
+	template<typename Function>
+	[[nodiscard]]
+	double NanosecondsPer(uint64_t count, Function function) noexcept
+	{
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		const auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count() / count;
+	}
+
+	[[nodiscard]]
+	BenchResult RunWheel(uint32_t outstanding) noexcept
+	{
+		TimerWheel wheel(RESOLUTION, 0);
+		wheel.Reserve(outstanding);
+
+		DeadlineSource source;
+		std::vector<int64_t> deadlines(outstanding);
+		std::vector<TimerHandle> handles(outstanding);
+		BenchResult result = { .bCorrect = true };
+
+		result.scheduleNs = NanosecondsPer(outstanding, [&]
+			{
+				for (uint32_t i = 0; i < outstanding; i++)
+				{
+					deadlines[i] = source.After(0);
+					handles[i] = wheel.Schedule(deadlines[i], i);
+				}
+			});
+
+		//what a button press does, cancel the pending deadline and set a new one
+		result.rescheduleNs = NanosecondsPer(outstanding, [&]
+			{
+				for (uint32_t i = 0; i < outstanding; i++)
+				{
+					result.bCorrect &= wheel.Cancel(handles[i]);
+					deadlines[i] = source.After(0);
+					handles[i] = wheel.Schedule(deadlines[i], i);
+				}
+			});
+
+		uint64_t fired = 0;
+		int64_t now = 0;
+		result.fireNs = NanosecondsPer(CHURN_FIRES, [&]
+			{
+				while (fired < CHURN_FIRES)
+				{
+					now += RESOLUTION;
+					wheel.Advance(now, [&](uint64_t timer)
+						{
+							result.bCorrect &= deadlines[timer] <= now && now - deadlines[timer] < 2 * RESOLUTION;
+							deadlines[timer] = source.After(now);
+							handles[timer] = wheel.Schedule(deadlines[timer], timer);
+							fired++;
+						});
+				}
+			});
+
+		result.bCorrect &= wheel.Size() == outstanding;
+		return result;
+	}
+
+	[[nodiscard]]
+	BenchResult RunHeap(uint32_t outstanding) noexcept
+	{
+		struct HeapEntry
+		{
+			int64_t deadline;
+			uint32_t timer;
+			uint32_t generation;
+
+			bool operator>(const HeapEntry& other) const noexcept { return deadline > other.deadline; }
+		};
+
+		std::vector<HeapEntry> storage;
+		storage.reserve(outstanding * 3ull);
+		std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap({}, std::move(storage));
+
+		DeadlineSource source;
+		std::vector<uint32_t> generations(outstanding);
+		BenchResult result = { .bCorrect = true };
+
+		result.scheduleNs = NanosecondsPer(outstanding, [&]
+			{
+				for (uint32_t i = 0; i < outstanding; i++)
+					heap.push({ .deadline = source.After(0), .timer = i, .generation = generations[i] });
+			});
+
+		//cancelling is a generation bump, the stale entry is skipped when it surfaces
+		result.rescheduleNs = NanosecondsPer(outstanding, [&]
+			{
+				for (uint32_t i = 0; i < outstanding; i++)
+				{
+					generations[i]++;
+					heap.push({ .deadline = source.After(0), .timer = i, .generation = generations[i] });
+				}
+			});
+
+		uint64_t fired = 0;
+		int64_t now = 0;
+		result.fireNs = NanosecondsPer(CHURN_FIRES, [&]
+			{
+				while (fired < CHURN_FIRES)
+				{
+					now += RESOLUTION;
+					while (!heap.empty() && heap.top().deadline <= now)
+					{
+						const HeapEntry entry = heap.top();
+						heap.pop();
+
+						if (entry.generation != generations[entry.timer])
+							continue;
+
+						heap.push({ .deadline = source.After(now), .timer = entry.timer, .generation = entry.generation });
+						fired++;
+					}
+				}
+			});
+
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t maxOutstanding = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 1'000'000;
+
+	bool bCorrect = true;
+
+	printf("structure,outstanding,schedule_ns,reschedule_ns,fire_ns\n");
+	for (uint32_t outstanding = 1'000; outstanding <= maxOutstanding; outstanding *= 10)
+	{
+		const BenchResult wheel = RunWheel(outstanding);
+		const BenchResult heap = RunHeap(outstanding);
+
+		printf("wheel,%u,%.1f,%.1f,%.1f\n", outstanding, wheel.scheduleNs, wheel.rescheduleNs, wheel.fireNs);
+		printf("heap,%u,%.1f,%.1f,%.1f\n", outstanding, heap.scheduleNs, heap.rescheduleNs, heap.fireNs);
+
+		if (!wheel.bCorrect)
+		{
+			fprintf(stderr, "timing wheel fired a timer outside its window at %u outstanding\n", outstanding);
+			bCorrect = false;
+		}
+	}
+
+	return bCorrect ? EXIT_SUCCESS : EXIT_FAILURE;
+}
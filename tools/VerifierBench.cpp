@@ -0,0 +1,290 @@
+/*
+* (C) 2023 badasahog. All Rights Reserved
+* The above copyright notice shall be included in
+* all copies or substantial portions of the Software.
+*/
+
+//checks the packed sequence verifier against the scalar compare and against mismatches put in on purpose,
+//then times both on one long stream and verifies a leaderboard archive of honest and tampered submissions,
+//each next to summing every word of the same bytes, which is as fast as anything that reads them can get
+//arguments: archive size in MiB (default 1024), most rounds a submission plays (default 400)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "SequenceVerifier.h"
+
+namespace
+{
+	constexpr int CHECKED_STREAMS = 200'000;
+	constexpr uint64_t MAX_CHECKED_STEPS = 2'000;
+	//one stream that stays in L1, where the compare is the limit, and one far larger than the caches, where memory is
+	constexpr size_t STREAM_BYTES[] = { 16 << 10, 256 << 20 };
+	//every stream is compared until this much of it was read
+	constexpr size_t STREAM_PASS_BYTES = (size_t)1 << 30;
+	//one submission in this many is tampered with
+	constexpr uint64_t TAMPER_INTERVAL = 8;
+
+	void SetStep(uint8_t* packed, uint64_t step, uint32_t button) noexcept
+	{
+		const uint32_t shift = (uint32_t)(step % 4 * 2);
+		packed[step / 4] = (uint8_t)((packed[step / 4] & ~(3u << shift)) | button << shift);
+	}
+
+	[[nodiscard]]
+	uint32_t GetStep(const uint8_t* packed, uint64_t step) noexcept
+	{
+		return packed[step / 4] >> (step % 4 * 2) & 3;
+	}
+
+	//false if either compare misses a difference put in, finds one that is not there or looks past the last step
+	[[nodiscard]]
+	bool CheckMismatches() noexcept
+	{
+		std::vector<uint8_t> expected(RoundBytes(MAX_CHECKED_STEPS));
+		std::vector<uint8_t> presses(expected.size());
+		uint64_t random = 0;
+
+		for (int i = 0; i < CHECKED_STREAMS; i++)
+		{
+			const uint64_t steps = SplitMix64(random++) % MAX_CHECKED_STEPS + 1;
+			PackSequence(CounterRng::ForStream(7, (uint64_t)i), steps, expected.data());
+			memcpy(presses.data(), expected.data(), RoundBytes(steps));
+
+			//a quarter of the streams agree, the rest differ at one step and maybe at a later one too
+			uint64_t mismatch = steps;
+			if (i % 4 != 0)
+			{
+				mismatch = SplitMix64(random++) % steps;
+				SetStep(presses.data(), mismatch, (GetStep(presses.data(), mismatch) + 1 + (uint32_t)(i % 3)) % 4);
+				if (mismatch + 1 < steps)
+				{
+					const uint64_t later = mismatch + 1 + SplitMix64(random++) % (steps - mismatch - 1);
+					SetStep(presses.data(), later, (uint32_t)SplitMix64(random++) % 4);
+				}
+			}
+
+			//steps past the end of the stream are not compared
+			if (steps % 4 != 0)
+				presses[steps / 4] ^= (uint8_t)(0xFF << (steps % 4 * 2));
+
+			if (FirstMismatch(presses.data(), expected.data(), steps) != mismatch || FirstMismatchScalar(presses.data(), expected.data(), steps) != mismatch)
+			{
+				fprintf(stderr, "stream %i of %llu steps: expected a mismatch at %llu, vector found %llu, scalar %llu\n", i,
+					(unsigned long long)steps,
+					(unsigned long long)mismatch,
+					(unsigned long long)FirstMismatch(presses.data(), expected.data(), steps),
+					(unsigned long long)FirstMismatchScalar(presses.data(), expected.data(), steps));
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	//summing every word of the buffers, the most any pass over them can reach
+	[[nodiscard]]
+	double ReadSeconds(const uint8_t* first, const uint8_t* second, size_t size) noexcept
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		uint64_t sum = 0;
+		for (size_t i = 0; i + 8 <= size; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, first + i, sizeof(word));
+			sum += word;
+			if (second != nullptr)
+			{
+				memcpy(&word, second + i, sizeof(word));
+				sum += word;
+			}
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return sum == 1 ? 0 : seconds;
+	}
+
+	//seconds per compare of the whole stream
+	template<typename Compare>
+	[[nodiscard]]
+	double StreamSeconds(const std::vector<uint8_t>& presses, const std::vector<uint8_t>& expected, Compare compare) noexcept
+	{
+		const size_t repetitions = std::max(STREAM_PASS_BYTES / presses.size(), (size_t)1);
+
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < repetitions; i++)
+		{
+			if (compare(presses.data(), expected.data(), (uint64_t)presses.size() * 4) != (uint64_t)presses.size() * 4 - 1)
+				return -1;
+		}
+
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repetitions;
+	}
+
+	struct Archive
+	{
+		std::vector<uint8_t> bytes;
+		uint64_t submissions = 0;
+		uint64_t tampered = 0;
+		uint64_t firstTampered = UINT64_MAX;
+	};
+
+	//honest games either complete their last round or miss its last press, every TAMPER_INTERVAL-th one
+	//instead misses in an earlier round, claims a round more than it played or leaves garbage in the padding
+	[[nodiscard]]
+	Archive BuildArchive(size_t targetBytes, uint32_t maxRounds) noexcept
+	{
+		Archive archive;
+		archive.bytes.reserve(targetBytes + sizeof(SubmissionHeader) + SubmissionPressBytes(maxRounds, maxRounds));
+
+		std::vector<uint8_t> sequence(RoundBytes(maxRounds));
+		uint64_t random = 1;
+
+		while (archive.bytes.size() < targetBytes)
+		{
+			const uint64_t index = archive.submissions++;
+			const uint32_t rounds = (uint32_t)(SplitMix64(random++) % maxRounds) + 1;
+			const bool bMissed = SplitMix64(random++) % 2 == 0;
+
+			SubmissionHeader header =
+			{
+				.seed = 99,
+				.gameNumber = index,
+				.rounds = rounds,
+				.finalPresses = bMissed ? (uint32_t)(SplitMix64(random++) % rounds) + 1 : rounds,
+				.claimedScore = bMissed ? (int32_t)rounds - 1 : (int32_t)rounds,
+				.reserved = 0
+			};
+
+			const uint64_t tamper = index % TAMPER_INTERVAL == TAMPER_INTERVAL - 1 ? index / TAMPER_INTERVAL % 3 + 1 : 0;
+			if (tamper == 2)
+				header.claimedScore++;
+
+			const size_t headerOffset = archive.bytes.size();
+			archive.bytes.resize(headerOffset + sizeof(header) + SubmissionPressBytes(header.rounds, header.finalPresses));
+			memcpy(archive.bytes.data() + headerOffset, &header, sizeof(header));
+
+			PackSequence(CounterRng::ForStream(header.seed, header.gameNumber), rounds, sequence.data());
+
+			uint8_t* out = archive.bytes.data() + headerOffset + sizeof(header);
+			for (uint32_t round = 1; round <= rounds; round++)
+			{
+				const uint32_t steps = round == rounds ? header.finalPresses : round;
+				for (uint32_t step = 0; step < steps; step++)
+					SetStep(out, step, GetStep(sequence.data(), step));
+
+				if (round == rounds && bMissed)
+					SetStep(out, steps - 1, (GetStep(sequence.data(), steps - 1) + 1) % 4);
+
+				//a wrong press in the first round ends the game there, however many rounds are claimed
+				if (round == 1 && tamper == 1 && rounds > 1)
+					SetStep(out, 0, 3);
+
+				if (round == rounds && tamper == 3)
+					out[RoundBytes(steps) - 1] |= steps % 4 == 0 ? 0 : 0x80;
+
+				out += RoundBytes(steps);
+			}
+
+			//a single round game has no earlier round to miss in, and a last round of whole bytes has no padding
+			const bool bTampered = (tamper == 1 && rounds > 1) || tamper == 2 || (tamper == 3 && header.finalPresses % 4 != 0);
+			if (bTampered)
+			{
+				if (archive.tampered == 0)
+					archive.firstTampered = index;
+				archive.tampered++;
+			}
+		}
+
+		return archive;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t archiveMiB = argc > 1 ? std::max((size_t)strtoull(argv[1], nullptr, 10), (size_t)1) : 1024;
+	const uint32_t maxRounds = argc > 2 ? std::clamp((uint32_t)strtoul(argv[2], nullptr, 10), 1u, MAX_SUBMISSION_ROUNDS) : 400;
+
+	if (!CheckMismatches())
+		return EXIT_FAILURE;
+	printf("compared %i streams of up to %llu steps with vector and scalar, every mismatch found\n\n", CHECKED_STREAMS, (unsigned long long)MAX_CHECKED_STEPS);
+
+	//streams that differ only at their very last step, so both compares read all of them,
+	//both streams are read and the rates are of presses checked
+	printf("stream_kib,vector_gb_per_s,scalar_gb_per_s,speedup,read_gb_per_s\n");
+
+	for (const size_t streamBytes : STREAM_BYTES)
+	{
+		std::vector<uint8_t> expected(streamBytes);
+		for (size_t i = 0; i < streamBytes; i += 8)
+		{
+			const uint64_t word = SplitMix64(i);
+			memcpy(expected.data() + i, &word, sizeof(word));
+		}
+		std::vector<uint8_t> presses = expected;
+		presses.back() ^= 0xC0;
+
+		const double vectorSeconds = StreamSeconds(presses, expected, FirstMismatch);
+		const double scalarSeconds = StreamSeconds(presses, expected, FirstMismatchScalar);
+		if (vectorSeconds < 0 || scalarSeconds < 0)
+		{
+			fprintf(stderr, "the stream compare missed its last step\n");
+			return EXIT_FAILURE;
+		}
+
+		const size_t repetitions = std::max(STREAM_PASS_BYTES / streamBytes, (size_t)1);
+		double readSeconds = 0;
+		for (size_t i = 0; i < repetitions; i++)
+			readSeconds += ReadSeconds(presses.data(), expected.data(), streamBytes);
+		readSeconds /= repetitions;
+
+		printf("%zu,%.2f,%.2f,%.1f,%.2f\n",
+			streamBytes >> 10,
+			streamBytes / vectorSeconds / 1e9,
+			streamBytes / scalarSeconds / 1e9,
+			scalarSeconds / vectorSeconds,
+			streamBytes / readSeconds / 1e9);
+	}
+	printf("\n");
+
+	const Archive archive = BuildArchive(archiveMiB << 20, maxRounds);
+
+	const auto start = std::chrono::steady_clock::now();
+	const ArchiveResult result = VerifyArchive(archive.bytes.data(), archive.bytes.size());
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (!result.bWellFormed || result.submissions != archive.submissions || result.rejected != archive.tampered || result.firstRejected != archive.firstTampered)
+	{
+		fprintf(stderr, "the archive of %llu submissions with %llu tampered came back as %llu with %llu rejected\n",
+			(unsigned long long)archive.submissions,
+			(unsigned long long)archive.tampered,
+			(unsigned long long)result.submissions,
+			(unsigned long long)result.rejected);
+		return EXIT_FAILURE;
+	}
+
+	//an archive cut short anywhere but between submissions is not well formed
+	if (VerifyArchive(archive.bytes.data(), archive.bytes.size() - 1).bWellFormed)
+	{
+		fprintf(stderr, "a truncated archive was taken as well formed\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("archive_mib,max_rounds,submissions,rejected,presses,seconds,gb_per_s,read_gb_per_s\n");
+	printf("%.0f,%u,%llu,%llu,%llu,%.3f,%.2f,%.2f\n",
+		archive.bytes.size() / (double)(1 << 20),
+		maxRounds,
+		(unsigned long long)result.submissions,
+		(unsigned long long)result.rejected,
+		(unsigned long long)result.pressesChecked,
+		seconds,
+		archive.bytes.size() / seconds / 1e9,
+		archive.bytes.size() / ReadSeconds(archive.bytes.data(), nullptr, archive.bytes.size()) / 1e9);
+
+	return EXIT_SUCCESS;
+}